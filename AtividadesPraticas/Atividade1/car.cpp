@@ -3,12 +3,12 @@
 #include <cppitertools/itertools.hpp>
 #include <glm/gtx/fast_trigonometry.hpp>
 
-void Car::initializeGL(GLuint program, int quantity) {
+void Car::initializeGL(GLuint program, int quantity,
+                       std::default_random_engine::result_type seed) {
   terminateGL();
 
   // Start pseudo-random number generator
-  m_randomEngine.seed(
-      std::chrono::steady_clock::now().time_since_epoch().count());
+  m_randomEngine.seed(seed);
 
   m_program = program;
   m_colorLoc = abcg::glGetUniformLocation(m_program, "color");
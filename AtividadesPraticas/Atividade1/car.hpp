@@ -12,7 +12,8 @@ class OpenGLWindow;
 
 class Car {
  public:
-  void initializeGL(GLuint program, int quantity);
+  void initializeGL(GLuint program, int quantity,
+                    std::default_random_engine::result_type seed);
   void paintGL();
   void terminateGL();
 
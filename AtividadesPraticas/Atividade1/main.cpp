@@ -8,7 +8,12 @@ int main(int argc, char **argv) {
     abcg::Application app(argc, argv);
 
     auto window{std::make_unique<OpenGLWindow>()};
-    window->setOpenGLSettings({.samples = 4});
+    // Objects are not interpolated between updates, so faster frames would
+    // be identical
+    window->setOpenGLSettings({.samples = 4,
+                               .vsync = true,
+                               .adaptiveVsync = true,
+                               .maxFrameRate = 60});
     window->setWindowSettings({.width = 600,
                                .height = 600,
                                .showFPS = false,
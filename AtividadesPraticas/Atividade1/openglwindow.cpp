@@ -40,9 +40,12 @@ void OpenGLWindow::initializeGL() {
   abcg::glEnable(GL_PROGRAM_POINT_SIZE);
 #endif
 
-  // Start pseudo-random number generator
+  // Start pseudo-random number generator. Replays use a fixed seed, so that
+  // they draw the same cars in each run
   m_randomEngine.seed(
-      std::chrono::steady_clock::now().time_since_epoch().count());
+      getInput().isReplaying()
+          ? 0
+          : std::chrono::steady_clock::now().time_since_epoch().count());
 
   restart();
 }
@@ -51,13 +54,13 @@ void OpenGLWindow::restart() {
   m_gameData.m_state = State::Playing;
 
   m_frog.initializeGL(m_objectsProgram);
-  m_car.initializeGL(m_objectsProgram, 3);
+  m_car.initializeGL(m_objectsProgram, 3, m_randomEngine());
   m_finish.initializeGL(m_objectsProgram);
   m_background.initializeGL(m_objectsProgram);
 }
 
-void OpenGLWindow::update() {
-  float deltaTime{static_cast<float>(getDeltaTime())};
+void OpenGLWindow::update(double deltaTime) {
+  const auto step{static_cast<float>(deltaTime)};
 
   // Wait 5 seconds before restarting
   if (m_gameData.m_state != State::Playing &&
@@ -70,14 +73,12 @@ void OpenGLWindow::update() {
   checkCollisions();
   }
 
-  m_frog.update(m_gameData, deltaTime);
-  m_car.update(m_frog, deltaTime);
-  m_finish.update(m_frog, deltaTime);
+  m_frog.update(m_gameData, step);
+  m_car.update(m_frog, step);
+  m_finish.update(m_frog, step);
 }
 
 void OpenGLWindow::paintGL() {
-  update();
-
   abcg::glClear(GL_COLOR_BUFFER_BIT);
   abcg::glViewport(0, 0, m_viewportWidth, m_viewportHeight);
 
@@ -19,6 +19,7 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   void paintUI() override;
   void resizeGL(int width, int height) override;
   void terminateGL() override;
+  void update(double deltaTime) override;
   void checkCollisions();
 
  private:
@@ -45,7 +46,6 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   
   
   void restart();
-  void update();
 };
 
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "camera.hpp"
 
+#include <glm/common.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 void Camera::computeProjectionMatrix(int width, int height) {
@@ -12,6 +13,13 @@ void Camera::computeViewMatrix() {
   m_viewMatrix = glm::lookAt(m_eye, m_at, m_up);
 }
 
+// View matrix of a camera between the previous camera (alpha = 0) and this
+// one (alpha = 1)
+void Camera::computeViewMatrix(const Camera& previous, float alpha) {
+  m_viewMatrix = glm::lookAt(glm::mix(previous.m_eye, m_eye, alpha),
+                             glm::mix(previous.m_at, m_at, alpha), m_up);
+}
+
 void Camera::dolly(float speed) {
   // Compute forward vector (view direction)
   const glm::vec3 forward{glm::normalize(m_at - m_eye)};
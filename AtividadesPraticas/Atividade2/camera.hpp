@@ -9,6 +9,7 @@ class OpenGLWindow;
 class Camera {
  public:
   void computeViewMatrix();
+  void computeViewMatrix(const Camera& previous, float alpha);
   void computeProjectionMatrix(int width, int height);
 
   void fire();
@@ -198,7 +198,8 @@ void OpenGLWindow::loadModelFromFile(std::string_view path) {
 }
 
 void OpenGLWindow::paintGL() {
-  update();
+  m_camera.computeViewMatrix(m_previousCamera,
+                             static_cast<float>(getUpdateAlpha()));
 
   // Clear color buffer and depth buffer
   abcg::glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -361,12 +362,13 @@ void OpenGLWindow::terminateGL() {
   abcg::glDeleteVertexArrays(1, &m_VAO);
 }
 
-void OpenGLWindow::update() {
-  const float deltaTime{static_cast<float>(getDeltaTime())};
+void OpenGLWindow::update(double deltaTime) {
+  const auto step{static_cast<float>(deltaTime)};
 
   // Update LookAt camera
-  m_camera.dolly(m_dollySpeed * deltaTime);
-  m_camera.truck(m_truckSpeed * deltaTime);
-  m_camera.pan(m_panSpeed * deltaTime);
-  m_camera.rotatex(m_vertSpeed * deltaTime);
+  m_previousCamera = m_camera;
+  m_camera.dolly(m_dollySpeed * step);
+  m_camera.truck(m_truckSpeed * step);
+  m_camera.pan(m_panSpeed * step);
+  m_camera.rotatex(m_vertSpeed * step);
 }
\ No newline at end of file
@@ -25,6 +25,7 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   void paintUI() override;
   void resizeGL(int width, int height) override;
   void terminateGL() override;
+  void update(double deltaTime) override;
   void fire();
 
  private:
@@ -38,6 +39,8 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   int upright = 1;
 
   Camera m_camera;
+  // Camera before the last update, to interpolate between updates
+  Camera m_previousCamera;
   float m_dollySpeed{0.0f};
   float m_truckSpeed{0.0f};
   float m_panSpeed{0.0f};
@@ -55,7 +58,6 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   ImFont* m_font{};
 
   void loadModelFromFile(std::string_view path);
-  void update();
 };
 
 #endif
\ No newline at end of file
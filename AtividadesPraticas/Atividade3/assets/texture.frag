@@ -6,6 +6,9 @@ in vec3 fragV;
 in vec2 fragTexCoord;
 in vec3 fragPObj;
 in vec3 fragNObj;
+in vec4 fragT;
+in vec3 fragPWorld;
+in float fragViewDistance;
 
 // Light properties
 uniform vec4 Ia, Id, Is;
@@ -17,11 +20,59 @@ uniform float shininess;
 // Diffuse texture sampler
 uniform sampler2D diffuseTex;
 
+// Tangent-space normal map
+uniform sampler2D normalTex;
+uniform int normalMapping;
+
 // Mapping mode
 uniform int mappingMode;
 
+// Cascaded shadow map of the light (see abcg::CascadedShadowMap)
+uniform mediump sampler2DArrayShadow shadowMap;
+uniform mat4 shadowMatrices[4];
+uniform vec4 cascadeSplits;
+uniform int cascadeCount;
+uniform int shadowFilterRadius;
+
 out vec4 outColor;
 
+// Perturbs N with the normal map, following the MikkTSpace convention: the
+// bitangent is rebuilt per fragment from the unnormalized interpolated
+// vectors
+vec3 NormalMapping(vec3 N, vec2 texCoord) {
+  vec3 B = fragT.w * cross(N, fragT.xyz);
+  vec3 mapN = texture(normalTex, texCoord).xyz * 2.0 - 1.0;
+  return mapN.x * fragT.xyz + mapN.y * B + mapN.z * N;
+}
+
+// Fraction of the light that reaches the fragment, averaged over a
+// (2r+1)x(2r+1) kernel of bilinear comparisons
+float ShadowVisibility() {
+  int cascade = 0;
+  while (cascade < cascadeCount - 1 &&
+         fragViewDistance > cascadeSplits[cascade]) {
+    ++cascade;
+  }
+  if (fragViewDistance > cascadeSplits[cascade]) return 1.0;
+
+  vec3 coord = (shadowMatrices[cascade] * vec4(fragPWorld, 1.0)).xyz;
+  if (any(lessThan(coord, vec3(0.0))) || any(greaterThan(coord, vec3(1.0)))) {
+    return 1.0;
+  }
+
+  vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+  float visibility = 0.0;
+  for (int y = -shadowFilterRadius; y <= shadowFilterRadius; ++y) {
+    for (int x = -shadowFilterRadius; x <= shadowFilterRadius; ++x) {
+      vec2 offset = vec2(x, y) * texelSize;
+      visibility += texture(shadowMap,
+                            vec4(coord.xy + offset, float(cascade), coord.z));
+    }
+  }
+  float width = float(2 * shadowFilterRadius + 1);
+  return visibility / (width * width);
+}
+
 // Blinn-Phong reflection model
 vec4 BlinnPhong(vec3 N, vec3 L, vec3 V, vec2 texCoord) {
   N = normalize(N);
@@ -42,8 +93,11 @@ vec4 BlinnPhong(vec3 N, vec3 L, vec3 V, vec2 texCoord) {
   vec4 map_Kd = texture(diffuseTex, texCoord);
   vec4 map_Ka = map_Kd;
 
-  vec4 diffuseColor = map_Kd * Kd * Id * lambertian;
-  vec4 specularColor = Ks * Is * specular;
+  // Shadows block the light, not the ambient term
+  float visibility = lambertian > 0.0 ? ShadowVisibility() : 1.0;
+
+  vec4 diffuseColor = map_Kd * Kd * Id * lambertian * visibility;
+  vec4 specularColor = Ks * Is * specular * visibility;
   vec4 ambientColor = map_Ka * Ka * Ia;
 
   return ambientColor + diffuseColor + specularColor;
@@ -57,7 +111,11 @@ void main() {
     // From mesh
     texCoord = fragTexCoord;
   }
-  color = BlinnPhong(fragN, fragL, fragV, texCoord);
+  vec3 N = fragN;
+  if (normalMapping == 1 && mappingMode == 3) {
+    N = NormalMapping(N, texCoord);
+  }
+  color = BlinnPhong(N, fragL, fragV, texCoord);
   
 
   if (gl_FrontFacing) {
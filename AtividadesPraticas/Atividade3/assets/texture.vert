@@ -1,8 +1,9 @@
 #version 410
 
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
+layout(location = 1) in vec2 inNormal;  // Octahedral encoding
 layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in vec4 inTangent;
 
 uniform mat4 modelMatrix;
 uniform mat4 viewMatrix;
@@ -17,10 +18,24 @@ out vec3 fragN;
 out vec2 fragTexCoord;
 out vec3 fragPObj;
 out vec3 fragNObj;
+out vec4 fragT;
+out vec3 fragPWorld;
+out float fragViewDistance;
+
+vec3 decodeOctahedral(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
 
 void main() {
-  vec3 P = (viewMatrix * modelMatrix * vec4(inPosition, 1.0)).xyz;
-  vec3 N = normalMatrix * inNormal;
+  vec3 normal = decodeOctahedral(inNormal);
+
+  vec4 PWorld = modelMatrix * vec4(inPosition, 1.0);
+  vec3 P = (viewMatrix * PWorld).xyz;
+  vec3 N = normalMatrix * normal;
   vec3 L = -(viewMatrix * lightDirWorldSpace).xyz;
 
   fragL = L;
@@ -28,7 +43,11 @@ void main() {
   fragN = N;
   fragTexCoord = inTexCoord;
   fragPObj = inPosition;
-  fragNObj = inNormal;
+  fragNObj = normal;
+  fragPWorld = PWorld.xyz;
+  fragViewDistance = -P.z;
+  // Same space as N, without the dequantization scale of modelMatrix
+  fragT = vec4(normalize(normalMatrix * inTangent.xyz), inTangent.w);
 
   gl_Position = projMatrix * vec4(P, 1.0);
 }
@@ -3,12 +3,16 @@
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
+#include <span>
+
+#include "abcg_mesh.hpp"
 
 class OpenGLWindow;
 
 class Camera {
  public:
   void computeViewMatrix();
+  void computeViewMatrix(const Camera& previous, float alpha);
   void computeProjectionMatrix(int width, int height);
 
   void fire();
@@ -17,6 +21,10 @@ class Camera {
   void truck(float speed);
   void pan(float speed);
   void rotatex(float speed);
+
+  [[nodiscard]] std::size_t selectLOD(std::span<const abcg::MeshLOD> lods,
+                                      const glm::vec3& position, float scale,
+                                      int viewportHeight) const;
   float m_FOV{70.0f};
 
  private:
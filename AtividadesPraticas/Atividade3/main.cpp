@@ -8,7 +8,7 @@ int main(int argc, char **argv) {
     abcg::Application app(argc, argv);
 
     auto window{std::make_unique<OpenGLWindow>()};
-    window->setOpenGLSettings({.samples = 4});
+    window->setOpenGLSettings({.dynamicResolution = true});
     window->setWindowSettings(
         {.width = 800, .height = 800, .showFPS = false, .showFullscreenButton = false, .title = "ShootingRange2.0"});
 
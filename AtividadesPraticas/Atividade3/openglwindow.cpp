@@ -2,30 +2,14 @@
 
 #include <fmt/core.h>
 #include <imgui.h>
-#include <tiny_obj_loader.h>
 
 #include <cppitertools/itertools.hpp>
 #include <glm/gtx/fast_trigonometry.hpp>
-#include <glm/gtx/hash.hpp>
-#include <unordered_map>
 #include <glm/gtc/matrix_inverse.hpp>
 
 
 #include "camera.hpp"
 
-// Explicit specialization of std::hash for Vertex
-namespace std {
-template <>
-struct hash<Vertex> {
-  size_t operator()(Vertex const& vertex) const noexcept {
-    const std::size_t h1{std::hash<glm::vec3>()(vertex.position)};
-    const std::size_t h2{std::hash<glm::vec3>()(vertex.normal)};
-    return h1 ^ h2;
-  }
-};
-}  // namespace std
-
-
 void OpenGLWindow::handleEvent(SDL_Event& ev) {
   SDL_SetRelativeMouseMode(SDL_TRUE);
 
@@ -68,15 +52,6 @@ void OpenGLWindow::handleEvent(SDL_Event& ev) {
     if (ev.key.keysym.sym == SDLK_RIGHT && m_truckSpeed > 0) m_truckSpeed = 0.0f;
   }
 
-  //movimento relativo do mouse para controle da câmera
-  if (ev.type == SDL_MOUSEMOTION) {
-    if (ev.motion.xrel){
-      m_panSpeed = ev.motion.xrel / 2; //dividido por 2 para menor sensitividade
-    }
-    if (ev.motion.yrel){
-      m_vertSpeed = ev.motion.yrel / 2;
-    }
-  }
   //Botão direito do mouse muda o FOV para efeito de zoom
   if (ev.type == SDL_MOUSEBUTTONDOWN) {
     if(ev.button.button == SDL_BUTTON_RIGHT){
@@ -107,258 +82,156 @@ void OpenGLWindow::initializeGL() {
   abcg::glEnable(GL_DEPTH_TEST);
 
   // Create program
-  m_program = createProgramFromFile(getAssetsPath() + "texture.vert",
-                                    getAssetsPath() + "texture.frag");
+  m_program = getResourceManager().loadProgram(
+      getAssetsPath() + "texture.vert", getAssetsPath() + "texture.frag");
 
-  m_ground.initializeGL(m_program);
-  m_wall.initializeGL(m_program);
+  m_ground.initializeGL(*m_program);
+  m_wall.initializeGL(*m_program);
   initializeSkybox();
 
   // Load model
-  loadModelFromFile(getAssetsPath() + "target.obj");
+  m_model = getResourceManager().loadModel(getAssetsPath() + "target.obj");
+  m_model->setupVAO(*m_program);
+  m_trianglesToDraw = m_model->getNumTriangles();
+
   //load cube
   loadCubeTexture(getAssetsPath() + "cube/");
 
-  // Generate VBO
-  abcg::glGenBuffers(1, &m_VBO);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-  abcg::glBufferData(GL_ARRAY_BUFFER, sizeof(m_vertices[0]) * m_vertices.size(),
-                     m_vertices.data(), GL_STATIC_DRAW);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // Generate EBO
-  abcg::glGenBuffers(1, &m_EBO);
-  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-  abcg::glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     sizeof(m_indices[0]) * m_indices.size(), m_indices.data(),
-                     GL_STATIC_DRAW);
-  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
- // Release previous VAO
-  abcg::glDeleteVertexArrays(1, &m_VAO);
-
-  // Create VAO
-  abcg::glGenVertexArrays(1, &m_VAO);
-  abcg::glBindVertexArray(m_VAO);
-
-  // Bind EBO and VBO
-  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-
-  // Bind vertex attributes
-  const GLint positionAttribute{
-      abcg::glGetAttribLocation(m_program, "inPosition")};
-  if (positionAttribute >= 0) {
-    abcg::glEnableVertexAttribArray(positionAttribute);
-    abcg::glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE,
-                                sizeof(Vertex), nullptr);
-  }
-
-  const GLint normalAttribute{abcg::glGetAttribLocation(m_program, "inNormal")};
-  if (normalAttribute >= 0) {
-    abcg::glEnableVertexAttribArray(normalAttribute);
-    GLsizei offset{sizeof(glm::vec3)};
-    abcg::glVertexAttribPointer(normalAttribute, 3, GL_FLOAT, GL_FALSE,
-                                sizeof(Vertex),
-                                reinterpret_cast<void*>(offset));
-  }
-
-  const GLint texCoordAttribute{
-      abcg::glGetAttribLocation(m_program, "inTexCoord")};
-  if (texCoordAttribute >= 0) {
-    abcg::glEnableVertexAttribArray(texCoordAttribute);
-    GLsizei offset{sizeof(glm::vec3) + sizeof(glm::vec3)};
-    abcg::glVertexAttribPointer(texCoordAttribute, 2, GL_FLOAT, GL_FALSE,
-                                sizeof(Vertex),
-                                reinterpret_cast<void*>(offset));
-  }
-
-  // End of binding
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-  abcg::glBindVertexArray(0);
-}
-
-void OpenGLWindow::loadDiffuseTexture(std::string_view path) {
-  if (!std::filesystem::exists(path)) return;
-
-  abcg::glDeleteTextures(1, &m_diffuseTexture);
-  m_diffuseTexture = abcg::opengl::loadTexture(path);
+  // Depth-only program of the shadow casters
+  m_shadowMap.create(createProgramFromString(
+                         abcg::CascadedShadowMap::getDepthVertexShader(),
+                         abcg::CascadedShadowMap::getDepthFragmentShader()),
+                     {.filter = abcg::ShadowFilter::PCF3x3});
+
+  // Antialiasing with FXAA instead of MSAA, which is costly at full
+  // resolution
+  getPostProcess().addPass(
+      {.program = createProgramFromString(
+           abcg::PostProcess::getVertexShader(),
+           abcg::PostProcess::getFXAAShader())});
 }
 
 void OpenGLWindow::loadCubeTexture(const std::string& path) {
   if (!std::filesystem::exists(path)) return;
 
-  abcg::glDeleteTextures(1, &m_cubeTexture);
-  m_cubeTexture = abcg::opengl::loadCubemap(
+  m_cubeTexture = getResourceManager().loadCubemap(
       {path + "Cement.jpg", path + "Cement.jpg", path + "Cement.jpg",
        path + "Cement.jpg", path + "Cement.jpg", path + "Cement.jpg"});
 }
 
-void OpenGLWindow::render(int numTriangles) const {
-  abcg::glBindVertexArray(m_VAO);
-
-  abcg::glActiveTexture(GL_TEXTURE0);
-  abcg::glBindTexture(GL_TEXTURE_2D, m_diffuseTexture);
-
-  abcg::glActiveTexture(GL_TEXTURE2);
-  abcg::glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubeTexture);
-
-
-  // Set minification and magnification parameters
-  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-  // Set texture wrapping parameters
-  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-  const auto numIndices{(numTriangles < 0) ? m_indices.size()
-                                           : numTriangles * 3};
-
-  abcg::glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(numIndices),
-                       GL_UNSIGNED_INT, nullptr);
-
-  abcg::glBindVertexArray(0);
+// Coarsest level of detail whose error projects to less than a pixel
+std::size_t OpenGLWindow::selectTargetLOD(std::span<const abcg::MeshLOD> lods,
+                                          const Target& target) const {
+  return m_camera.selectLOD(lods, glm::vec3{target.modelMatrix[3]},
+                            target.scale, getRenderHeight());
 }
 
-void OpenGLWindow::loadModelFromFile(std::string_view path) {
-  const auto basePath{std::filesystem::path{path}.parent_path().string() + "/"};
-  tinyobj::ObjReaderConfig readerConfig;
-  readerConfig.mtl_search_path = basePath;  // Path to material files
+void OpenGLWindow::renderTarget(const Target& target, GLint modelMatrixLoc,
+                                GLint normalMatrixLoc) const {
+  // Positions are quantized relative to the bounding box of the mesh
+  const auto dequantizedModel{target.modelMatrix *
+                              m_model->getDequantizationMatrix()};
+  abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE,
+                           &dequantizedModel[0][0]);
+
+  // Normals and tangents are not quantized, so the normal matrix leaves out
+  // the dequantization scale. It takes them to view space, as the light
+  const auto modelViewMatrix{
+      glm::mat3(m_camera.m_viewMatrix * target.modelMatrix)};
+  const glm::mat3 normalMatrix{glm::inverseTranspose(modelViewMatrix)};
+  abcg::glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
 
-  tinyobj::ObjReader reader;
+  m_model->render([&](std::span<const abcg::MeshLOD> lods) {
+    return selectTargetLOD(lods, target);
+  });
+}
 
-  if (!reader.ParseFromFile(path.data())) {
-    if (!reader.Error().empty()) {
-      throw abcg::Exception{abcg::Exception::Runtime(
-          fmt::format("Failed to load model {} ({})", path, reader.Error()))};
-    }
-    throw abcg::Exception{
-        abcg::Exception::Runtime(fmt::format("Failed to load model {}", path))};
+void OpenGLWindow::renderShadows(std::span<const Target> targets) {
+  // Bounding spheres of the targets, from the box of the quantized mesh
+  const auto dequantization{m_model->getDequantizationMatrix()};
+  const glm::vec3 boxCenter{dequantization * glm::vec4{0.5f, 0.5f, 0.5f, 1}};
+  const auto boxRadius{0.5f * glm::length(glm::vec3{dequantization[0][0],
+                                                    dequantization[1][1],
+                                                    dequantization[2][2]})};
+  std::vector<abcg::BoundingSphere> spheres;
+  glm::vec3 center{0.0f};
+  for (const auto& target : targets) {
+    spheres.push_back(
+        {.center = glm::vec3{target.modelMatrix * glm::vec4{boxCenter, 1}},
+         .radius = boxRadius * target.scale});
+    center += spheres.back().center / static_cast<float>(targets.size());
   }
-
-  if (!reader.Warning().empty()) {
-    fmt::print("Warning: {}\n", reader.Warning());
+  abcg::BoundingSphere casterBounds{.center = center};
+  for (const auto& sphere : spheres) {
+    casterBounds.radius =
+        std::max(casterBounds.radius,
+                 glm::distance(center, sphere.center) + sphere.radius);
   }
 
-  const auto& attrib{reader.GetAttrib()};
-  const auto& shapes{reader.GetShapes()};
-  const auto& materials{reader.GetMaterials()};
-
-  m_vertices.clear();
-  m_indices.clear();
-
-  m_hasNormals = false;
-  m_trianglesToDraw = getNumTriangles();
-
-  // A key:value map with key=Vertex and value=index
-  std::unordered_map<Vertex, GLuint> hash{};
-
-  // Loop over shapes
-  for (const auto& shape : shapes) {
-    // Loop over indices
-    for (const auto offset : iter::range(shape.mesh.indices.size())) {
-      // Access to vertex
-      const tinyobj::index_t index{shape.mesh.indices.at(offset)};
-
-      // Vertex position
-      const std::size_t startIndex{static_cast<size_t>(3 * index.vertex_index)};
-      const float vx{attrib.vertices.at(startIndex + 0)};
-      const float vy{attrib.vertices.at(startIndex + 1)};
-      const float vz{attrib.vertices.at(startIndex + 2)};
-
-      // Vertex normal
-      float nx{};
-      float ny{};
-      float nz{};
-      if (index.normal_index >= 0) {
-        m_hasNormals = true;
-        const int normalStartIndex{3 * index.normal_index};
-        nx = attrib.normals.at(normalStartIndex + 0);
-        ny = attrib.normals.at(normalStartIndex + 1);
-        nz = attrib.normals.at(normalStartIndex + 2);
-      }
-      // Vertex texture coordinates
-      float tu{};
-      float tv{};
-      if (index.texcoord_index >= 0) {
-        m_hasTexCoords = true;
-        const int texCoordsStartIndex{2 * index.texcoord_index};
-        tu = attrib.texcoords.at(texCoordsStartIndex + 0);
-        tv = attrib.texcoords.at(texCoordsStartIndex + 1);
-      }
-
-      Vertex vertex{};
-      vertex.position = {vx, vy, vz};
-      vertex.normal = {nx, ny, nz};
-      vertex.texCoord = {tu, tv};
-
-      // If hash doesn't contain this vertex
-      if (hash.count(vertex) == 0) {
-        // Add this index (size of m_vertices)
-        hash[vertex] = m_vertices.size();
-        // Add this vertex
-        m_vertices.push_back(vertex);
-      }
-
-      m_indices.push_back(hash[vertex]);
+  m_shadowMap.update(m_camera.m_viewMatrix, m_camera.m_projMatrix,
+                     glm::vec3{m_lightDir}, casterBounds);
+  m_shadowMap.render([&](std::size_t cascade, GLint modelMatrixLoc) {
+    for (const auto index : iter::range(targets.size())) {
+      if (!m_shadowMap.isVisible(cascade, spheres.at(index))) continue;
+
+      const auto& target{targets[index]};
+      const auto dequantizedModel{target.modelMatrix * dequantization};
+      abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE,
+                               &dequantizedModel[0][0]);
+      m_model->renderGeometry([&](std::span<const abcg::MeshLOD> lods) {
+        return selectTargetLOD(lods, target);
+      });
     }
-  }
-
-  // Use properties of first material, if available
-  if (!materials.empty()) {
-    const auto& mat{materials.at(0)};  // First material
-    m_Ka = glm::vec4(mat.ambient[0], mat.ambient[1], mat.ambient[2], 1);
-    m_Kd = glm::vec4(mat.diffuse[0], mat.diffuse[1], mat.diffuse[2], 1);
-    m_Ks = glm::vec4(mat.specular[0], mat.specular[1], mat.specular[2], 1);
-    m_shininess = mat.shininess;
-
-    if (!mat.diffuse_texname.empty())
-      loadDiffuseTexture(basePath + mat.diffuse_texname);
-  } else {
-    // Default values
-    m_Ka = {0.1f, 0.1f, 0.1f, 1.0f};
-    m_Kd = {0.7f, 0.7f, 0.7f, 1.0f};
-    m_Ks = {1.0f, 1.0f, 1.0f, 1.0f};
-    m_shininess = 25.0f;
-  }
-  
-  if (!m_hasNormals) {
-    computeNormals();
-  }
+  });
 }
 
 void OpenGLWindow::paintGL() {
-  update();
+  // Mouse look uses the motion received up to now, right before the view
+  // matrix is built. Both cameras turn, so that the interpolation between
+  // updates only moves the eye
+  auto& input{getInput()};
+  input.sample();
+  if (const auto motion{input.consumeMouseMotion()}; motion != glm::vec2{}) {
+    for (auto* camera : {&m_camera, &m_previousCamera}) {
+      camera->pan(motion.x * m_mouseSensitivity);
+      camera->rotatex(motion.y * m_mouseSensitivity);
+    }
+  }
+  m_camera.computeViewMatrix(m_previousCamera,
+                             static_cast<float>(getUpdateAlpha()));
 
   // Clear color buffer and depth buffer
   abcg::glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  abcg::glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+  // The scene is rendered at a resolution scaled to hold the frame rate
+  abcg::glViewport(0, 0, getRenderWidth(), getRenderHeight());
+
+  // Resources are released when Esc is pressed
+  if (!m_program) return;
+
+  const auto targets{computeTargets()};
+  renderShadows(targets);
 
-  abcg::glUseProgram(m_program);
+  abcg::glUseProgram(*m_program);
 
   // Get location of uniform variables (could be precomputed)
   const GLint viewMatrixLoc{
-      abcg::glGetUniformLocation(m_program, "viewMatrix")};
+      abcg::glGetUniformLocation(*m_program, "viewMatrix")};
   const GLint projMatrixLoc{
-      abcg::glGetUniformLocation(m_program, "projMatrix")};
+      abcg::glGetUniformLocation(*m_program, "projMatrix")};
   const GLint modelMatrixLoc{
-      abcg::glGetUniformLocation(m_program, "modelMatrix")};
+      abcg::glGetUniformLocation(*m_program, "modelMatrix")};
   const GLint normalMatrixLoc{
-      abcg::glGetUniformLocation(m_program, "normalMatrix")};
+      abcg::glGetUniformLocation(*m_program, "normalMatrix")};
   const GLint lightDirLoc{
-      abcg::glGetUniformLocation(m_program, "lightDirWorldSpace")};
-  const GLint shininessLoc{abcg::glGetUniformLocation(m_program, "shininess")};
-  const GLint IaLoc{abcg::glGetUniformLocation(m_program, "Ia")};
-  const GLint IdLoc{abcg::glGetUniformLocation(m_program, "Id")};
-  const GLint IsLoc{abcg::glGetUniformLocation(m_program, "Is")};
-  const GLint KaLoc{abcg::glGetUniformLocation(m_program, "Ka")};
-  const GLint KdLoc{abcg::glGetUniformLocation(m_program, "Kd")};
-  const GLint KsLoc{abcg::glGetUniformLocation(m_program, "Ks")};
-  const GLint diffuseTexLoc{abcg::glGetUniformLocation(m_program, "diffuseTex")};
-  const GLint mappingModeLoc{abcg::glGetUniformLocation(m_program, "mappingMode")};
-  const GLint cubeTexLoc{abcg::glGetUniformLocation(m_program, "cubeTex")};
+      abcg::glGetUniformLocation(*m_program, "lightDirWorldSpace")};
+  const GLint IaLoc{abcg::glGetUniformLocation(*m_program, "Ia")};
+  const GLint IdLoc{abcg::glGetUniformLocation(*m_program, "Id")};
+  const GLint IsLoc{abcg::glGetUniformLocation(*m_program, "Is")};
+  const GLint mappingModeLoc{abcg::glGetUniformLocation(*m_program, "mappingMode")};
+  const GLint cubeTexLoc{abcg::glGetUniformLocation(*m_program, "cubeTex")};
+  const GLint normalMappingLoc{
+      abcg::glGetUniformLocation(*m_program, "normalMapping")};
   
 
   // Set uniform variables for viewMatrix and projMatrix
@@ -368,7 +241,6 @@ void OpenGLWindow::paintGL() {
   abcg::glUniformMatrix4fv(projMatrixLoc, 1, GL_FALSE,
                            &m_camera.m_projMatrix[0][0]);
 
-  abcg::glUniform1i(diffuseTexLoc, 0);
   abcg::glUniform1i(mappingModeLoc, m_mappingMode);
   abcg::glUniform1i(cubeTexLoc, 2);
 
@@ -378,21 +250,49 @@ void OpenGLWindow::paintGL() {
   abcg::glUniform4fv(IdLoc, 1, &m_Id.x);
   abcg::glUniform4fv(IsLoc, 1, &m_Is.x);
 
-  const auto modelViewMatrix{glm::mat3(m_viewMatrix * m_modelMatrix)};
+  // Positions are quantized relative to the bounding box of the mesh
+  const auto dequantizedModel{m_modelMatrix *
+                              m_model->getDequantizationMatrix()};
+  abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE,
+                           &dequantizedModel[0][0]);
+
+  // As in renderTarget(), the normal matrix leaves out the dequantization
+  const auto modelViewMatrix{
+      glm::mat3(m_camera.m_viewMatrix * m_modelMatrix)};
   const glm::mat3 normalMatrix{glm::inverseTranspose(modelViewMatrix)};
   abcg::glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
 
-  abcg::glUniform1f(shininessLoc, m_shininess);
-  abcg::glUniform4fv(KaLoc, 1, &m_Ka.x);
-  abcg::glUniform4fv(KdLoc, 1, &m_Kd.x);
-  abcg::glUniform4fv(KsLoc, 1, &m_Ks.x);
+  abcg::glActiveTexture(GL_TEXTURE2);
+  abcg::glBindTexture(GL_TEXTURE_CUBE_MAP, getCubeTexture());
 
-  render(m_trianglesToDraw);
+  m_shadowMap.bindTexture(*m_program, 3);
 
-  abcg::glBindVertexArray(m_VAO);
+  // Material uniforms and textures are set by the model
+  m_model->render(m_trianglesToDraw);
 
   abcg::glFrontFace(GL_CCW);
 
+  for (const auto& target : targets) {
+    renderTarget(target, modelMatrixLoc, normalMatrixLoc);
+  }
+
+  abcg::glBindVertexArray(0);
+
+  //chao e parede de fundo
+  
+  abcg::glUniform1i(normalMappingLoc, 0);
+  abcg::glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
+  m_ground.paintGL();
+  m_wall.paintGL();
+
+  abcg::glUseProgram(0);
+
+  renderSkybox();
+}
+
+std::array<OpenGLWindow::Target, 8> OpenGLWindow::computeTargets() {
+  std::array<Target, 8> targets;
+
   //modo 1: vermelhos para cima e azuis deitados
   if (upright == 1){
     rotatefront = 0.0f;
@@ -423,77 +323,36 @@ void OpenGLWindow::paintGL() {
   }
 
   // Alvos na frente
-  glm::mat4 model{1.0f};
-  model = glm::translate(model, glm::vec3(-1.0f, yposfront, 0.2f));
-  model = glm::rotate(model, glm::radians(rotatefront), glm::vec3(-1, 0, 0));
-  model = glm::scale(model, glm::vec3(0.08f));
-  abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &model[0][0]);
-  abcg::glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, nullptr);
-
-  model = glm::mat4(1.0);
-  model = glm::translate(model, glm::vec3(0.0f, yposfront, 0.2f));
-  model = glm::rotate(model, glm::radians(rotatefront), glm::vec3(-1, 0, 0));
-  model = glm::scale(model, glm::vec3(0.08f));
-  abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &model[0][0]);
-  abcg::glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, nullptr);
-
-  model = glm::mat4(1.0);
-  model = glm::translate(model, glm::vec3(1.0f, yposfront, 0.2f));
-  model = glm::rotate(model, glm::radians(rotatefront), glm::vec3(-1, 0, 0));
-  model = glm::scale(model, glm::vec3(0.08f));
-  abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &model[0][0]);
-  abcg::glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, nullptr);
-  
-  
+  for (const auto index : iter::range(3)) {
+    glm::mat4 model{1.0f};
+    model = glm::translate(
+        model, glm::vec3(static_cast<float>(index) - 1.0f, yposfront, 0.2f));
+    model = glm::rotate(model, glm::radians(rotatefront), glm::vec3(-1, 0, 0));
+    model = glm::scale(model, glm::vec3(0.08f));
+    targets.at(index) = {model, 0.08f};
+  }
+
   // Alvos de trás
-  model = glm::mat4(1.0);
-  model = glm::translate(model, glm::vec3(-1.5f, yposback, -0.5f));
-  model = glm::rotate(model, glm::radians(rotateback), glm::vec3(-1, 0, 0));
-  model = glm::scale(model, glm::vec3(0.08f));
-  abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &model[0][0]);
-  abcg::glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, nullptr);
-  
-  model = glm::mat4(1.0);
-  model = glm::translate(model, glm::vec3(-0.5f, yposback, -0.5f));
-  model = glm::rotate(model, glm::radians(rotateback), glm::vec3(-1, 0, 0));
-  model = glm::scale(model, glm::vec3(0.08f));
-  abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &model[0][0]);
-  abcg::glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, nullptr);
-
-  model = glm::mat4(1.0);
-  model = glm::translate(model, glm::vec3(0.5f, yposback, -0.5f));
-  model = glm::rotate(model, glm::radians(rotateback), glm::vec3(-1, 0, 0));
-  model = glm::scale(model, glm::vec3(0.08f));
-  abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &model[0][0]);
-  abcg::glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, nullptr);
-
-  model = glm::mat4(1.0);
-  model = glm::translate(model, glm::vec3(1.5f, yposback, -0.5f));
-  model = glm::rotate(model, glm::radians(rotateback), glm::vec3(-1, 0, 0));
-  model = glm::scale(model, glm::vec3(0.08f));
-  abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &model[0][0]);
-  abcg::glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, nullptr);
-  
-  //Alvo pequeno
-  model = glm::mat4(1.0);
-  model = glm::translate(model, glm::vec3(smallpos, 1.4f, -1.7f));
-  model = glm::scale(model, glm::vec3(0.05f));
-  abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &model[0][0]);
-  abcg::glDrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, nullptr);
+  for (const auto index : iter::range(4)) {
+    glm::mat4 model{1.0f};
+    model = glm::translate(
+        model, glm::vec3(static_cast<float>(index) - 1.5f, yposback, -0.5f));
+    model = glm::rotate(model, glm::radians(rotateback), glm::vec3(-1, 0, 0));
+    model = glm::scale(model, glm::vec3(0.08f));
+    targets.at(3 + index) = {model, 0.08f};
+  }
+
   //Wrap-Around
   if(smallpos > 1.7f) smallpos = -1.7f;
   if(smallpos < -1.7f) smallpos = 1.7f;
 
-  abcg::glBindVertexArray(0);
-
-  //chao e parede de fundo
-  
-  m_ground.paintGL();
-  m_wall.paintGL();
-
-  abcg::glUseProgram(0);
+  //Alvo pequeno
+  glm::mat4 model{1.0f};
+  model = glm::translate(model, glm::vec3(smallpos, 1.4f, -1.7f));
+  model = glm::scale(model, glm::vec3(0.05f));
+  targets.at(7) = {model, 0.05f};
 
-  renderSkybox();
+  return targets;
 }
 
 void OpenGLWindow::paintUI() { abcg::OpenGLWindow::paintUI(); 
@@ -521,65 +380,40 @@ void OpenGLWindow::resizeGL(int width, int height) {
   m_viewportHeight = height;
 
   m_camera.computeProjectionMatrix(width, height);
+
+  // Shadow texels follow the pixels of the window. The budget does not
+  // follow the dynamic resolution, which would reallocate the shadow map
+  // whenever the scale changes
+  auto shadowSettings{m_shadowMap.getSettings()};
+  shadowSettings.texelBudget = 2 * width * height;
+  m_shadowMap.setSettings(shadowSettings);
 }
 
 void OpenGLWindow::terminateGL() {
+  m_shadowMap.destroy();
   m_ground.terminateGL();
   m_wall.terminateGL();
   terminateSkybox();
 
-  abcg::glDeleteProgram(m_program);
-  abcg::glDeleteBuffers(1, &m_EBO);
-  abcg::glDeleteBuffers(1, &m_VBO);
-  abcg::glDeleteVertexArrays(1, &m_VAO);
+  m_program.reset();
+  m_model.reset();
+  m_cubeTexture.reset();
 }
 
-void OpenGLWindow::update() {
-  const float deltaTime{static_cast<float>(getDeltaTime())};
+void OpenGLWindow::update(double deltaTime) {
+  const auto step{static_cast<float>(deltaTime)};
 
   // Update LookAt camera
-  m_camera.dolly(m_dollySpeed * deltaTime);
-  m_camera.truck(m_truckSpeed * deltaTime);
-  m_camera.pan(m_panSpeed * deltaTime);
-  m_camera.rotatex(m_vertSpeed * deltaTime);
-}
-
-void OpenGLWindow::computeNormals() {
-  // Clear previous vertex normals
-  for (auto& vertex : m_vertices) {
-    vertex.normal = glm::zero<glm::vec3>();
-  }
-
-  // Compute face normals
-  for (const auto offset : iter::range<int>(0, m_indices.size(), 3)) {
-    // Get face vertices
-    Vertex& a{m_vertices.at(m_indices.at(offset + 0))};
-    Vertex& b{m_vertices.at(m_indices.at(offset + 1))};
-    Vertex& c{m_vertices.at(m_indices.at(offset + 2))};
-
-    // Compute normal
-    const auto edge1{b.position - a.position};
-    const auto edge2{c.position - b.position};
-    const glm::vec3 normal{glm::cross(edge1, edge2)};
-
-    // Accumulate on vertices
-    a.normal += normal;
-    b.normal += normal;
-    c.normal += normal;
-  }
-
-  // Normalize
-  for (auto& vertex : m_vertices) {
-    vertex.normal = glm::normalize(vertex.normal);
-  }
-
-  m_hasNormals = true;
+  m_previousCamera = m_camera;
+  m_camera.dolly(m_dollySpeed * step);
+  m_camera.truck(m_truckSpeed * step);
 }
 
 void OpenGLWindow::initializeSkybox() {
   // Create skybox program
   const auto path{getAssetsPath() +  m_skyShaderName};
-  m_skyProgram = createProgramFromFile(path + ".vert", path + ".frag");
+  m_skyProgram =
+      getResourceManager().loadProgram(path + ".vert", path + ".frag");
 
   // Generate VBO
   abcg::glGenBuffers(1, &m_skyVBO);
@@ -590,7 +424,7 @@ void OpenGLWindow::initializeSkybox() {
 
   // Get location of attributes in the program
   const GLint positionAttribute{
-      abcg::glGetAttribLocation(m_skyProgram, "inPosition")};
+      abcg::glGetAttribLocation(*m_skyProgram, "inPosition")};
 
   // Create VAO
   abcg::glGenVertexArrays(1, &m_skyVAO);
@@ -609,14 +443,14 @@ void OpenGLWindow::initializeSkybox() {
 }
 
 void OpenGLWindow::renderSkybox() {
-  abcg::glUseProgram(m_skyProgram);
+  abcg::glUseProgram(*m_skyProgram);
 
   // Get location of uniform variables
   const GLint viewMatrixLoc{
-      abcg::glGetUniformLocation(m_skyProgram, "viewMatrix")};
+      abcg::glGetUniformLocation(*m_skyProgram, "viewMatrix")};
   const GLint projMatrixLoc{
-      abcg::glGetUniformLocation(m_skyProgram, "projMatrix")};
-  const GLint skyTexLoc{abcg::glGetUniformLocation(m_skyProgram, "skyTex")};
+      abcg::glGetUniformLocation(*m_skyProgram, "projMatrix")};
+  const GLint skyTexLoc{abcg::glGetUniformLocation(*m_skyProgram, "skyTex")};
 
   // Set uniform variables
   const auto viewMatrix{m_camera.m_projMatrix};
@@ -640,7 +474,7 @@ void OpenGLWindow::renderSkybox() {
 }
 
 void OpenGLWindow::terminateSkybox() {
-  abcg::glDeleteProgram(m_skyProgram);
+  m_skyProgram.reset();
   abcg::glDeleteBuffers(1, &m_skyVBO);
   abcg::glDeleteVertexArrays(1, &m_skyVAO);
 }
\ No newline at end of file
@@ -1,28 +1,17 @@
 #ifndef OPENGLWINDOW_HPP_
 #define OPENGLWINDOW_HPP_
 
+#include <array>
 #include <vector>
 #include <imgui.h>
 #include <filesystem>
+#include <span>
 
 #include "abcg.hpp"
 #include "camera.hpp"
 #include "ground.hpp"
 #include "wall.hpp"
 
-struct Vertex {
-  glm::vec3 position{};
-  glm::vec3 normal{};
-  glm::vec2 texCoord{};
-
-  bool operator==(const Vertex& other) const noexcept {
-    static const auto epsilon{std::numeric_limits<float>::epsilon()};
-    return glm::all(glm::epsilonEqual(position, other.position, epsilon)) &&
-           glm::all(glm::epsilonEqual(normal, other.normal, epsilon));
-           glm::all(glm::epsilonEqual(texCoord, other.texCoord, epsilon));
-  }
-};
-
 class OpenGLWindow : public abcg::OpenGLWindow {
  protected:
   void handleEvent(SDL_Event& ev) override;
@@ -31,12 +20,10 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   void paintUI() override;
   void resizeGL(int width, int height) override;
   void terminateGL() override;
+  void update(double deltaTime) override;
 
  private:
-  GLuint m_VAO{};
-  GLuint m_VBO{};
-  GLuint m_EBO{};
-  GLuint m_program{};
+  abcg::ProgramHandle m_program;
 
   int m_viewportWidth{};
   int m_viewportHeight{};
@@ -45,10 +32,12 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   int m_mappingMode = 3;
 
   Camera m_camera;
+  // Camera before the last update, to interpolate between updates
+  Camera m_previousCamera;
   float m_dollySpeed{0.0f};
   float m_truckSpeed{0.0f};
-  float m_panSpeed{0.0f};
-  float m_vertSpeed{0.0f};
+  // Radians per pixel of mouse motion
+  float m_mouseSensitivity{0.004f};
   float rotatefront{0.0f};
   float rotateback{0.0f};
   float smallpos{0.0f};
@@ -58,8 +47,16 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   Ground m_ground;
   Wall m_wall;
 
-  std::vector<Vertex> m_vertices;
-  std::vector<GLuint> m_indices;
+  abcg::ModelHandle m_model;
+
+  // Shadows of the directional light. Targets cast shadows; the ground and
+  // the wall only receive them
+  abcg::CascadedShadowMap m_shadowMap;
+
+  struct Target {
+    glm::mat4 modelMatrix{1.0f};
+    float scale{};
+  };
 
   ImFont* m_font{};
   
@@ -70,38 +67,23 @@ class OpenGLWindow : public abcg::OpenGLWindow {
   glm::vec4 m_Ia{1.0f};
   glm::vec4 m_Id{1.0f};
   glm::vec4 m_Is{1.0f};
-  glm::vec4 m_Ka;
-  glm::vec4 m_Kd;
-  glm::vec4 m_Ks;
-  float m_shininess;
-  GLuint m_diffuseTexture{};
-  GLuint m_cubeTexture{};
+  abcg::TextureHandle m_cubeTexture;
   const std::string m_skyShaderName{"skybox"};
   GLuint m_skyVAO{};
   GLuint m_skyVBO{};
-  GLuint m_skyProgram{};
-
-  bool m_hasNormals{false};
-  bool m_hasTexCoords{false};
+  abcg::ProgramHandle m_skyProgram;
 
-  [[nodiscard]] int getNumTriangles() const {
-    return static_cast<int>(m_indices.size()) / 3;
+  [[nodiscard]] GLuint getCubeTexture() const {
+    return m_cubeTexture ? *m_cubeTexture : 0;
   }
 
-  [[nodiscard]] glm::vec4 getKa() const { return m_Ka; }
-  [[nodiscard]] glm::vec4 getKd() const { return m_Kd; }
-  [[nodiscard]] glm::vec4 getKs() const { return m_Ks; }
-  [[nodiscard]] float getShininess() const { return m_shininess; }
-
-  [[nodiscard]] bool isUVMapped() const { return m_hasTexCoords; }
-  [[nodiscard]] GLuint getCubeTexture() const { return m_cubeTexture; }
-
-  void computeNormals();
-  void loadModelFromFile(std::string_view path);
-  void update();
-  void loadDiffuseTexture(std::string_view path);
   void loadCubeTexture(const std::string& path);
-  void render(int numTriangles = -1) const;
+  [[nodiscard]] std::array<Target, 8> computeTargets();
+  [[nodiscard]] std::size_t selectTargetLOD(
+      std::span<const abcg::MeshLOD> lods, const Target& target) const;
+  void renderShadows(std::span<const Target> targets);
+  void renderTarget(const Target& target, GLint modelMatrixLoc,
+                    GLint normalMatrixLoc) const;
   void initializeSkybox();
   void terminateSkybox();
   void renderSkybox();
@@ -11,9 +11,30 @@
 #define ABCG_HPP_
 
 #include "abcg_application.hpp"
+#include "abcg_capture.hpp"
+#include "abcg_gputimer.hpp"
 #include "abcg_image.hpp"
+#include "abcg_imagediff.hpp"
+#include "abcg_input.hpp"
+#include "abcg_jobsystem.hpp"
+#include "abcg_mesh.hpp"
+#include "abcg_meshlet.hpp"
+#include "abcg_meshnormals.hpp"
+#include "abcg_meshoptimizer.hpp"
+#include "abcg_model.hpp"
+#include "abcg_objstream.hpp"
 #include "abcg_openglwindow.hpp"
+#include "abcg_pack.hpp"
+#include "abcg_postprocess.hpp"
+#include "abcg_readback.hpp"
+#include "abcg_rendertarget.hpp"
+#include "abcg_resolutionscaler.hpp"
+#include "abcg_replay.hpp"
+#include "abcg_resourcemanager.hpp"
+#include "abcg_shadowmap.hpp"
+#include "abcg_simulation.hpp"
 #include "abcg_string.hpp"
 #include "abcg_trackball.hpp"
+#include "abcg_vertexlayout.hpp"
 
 #endif
\ No newline at end of file
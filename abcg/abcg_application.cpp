@@ -10,13 +10,90 @@
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <cppitertools/itertools.hpp>
+#include <numeric>
+#include <optional>
 #include <span>
+#include <thread>
 
 #include "SDL_image.h"
 #include "abcg_exception.hpp"
+#include "abcg_input.hpp"
 #include "abcg_openglwindow.hpp"
 #include "tiny_obj_loader.h"
 
+namespace {
+// Returns the ID of the window an event is meant for, or 0 if the event is
+// meant for all windows
+Uint32 getEventWindowID(const SDL_Event &event) {
+  if (event.type >= SDL_USEREVENT) return event.user.windowID;
+  switch (event.type) {
+    case SDL_WINDOWEVENT:
+      return event.window.windowID;
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+      return event.key.windowID;
+    case SDL_TEXTEDITING:
+      return event.edit.windowID;
+    case SDL_TEXTINPUT:
+      return event.text.windowID;
+    case SDL_MOUSEMOTION:
+      return event.motion.windowID;
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+      return event.button.windowID;
+    case SDL_MOUSEWHEEL:
+      return event.wheel.windowID;
+    case SDL_DROPFILE:
+    case SDL_DROPTEXT:
+    case SDL_DROPBEGIN:
+    case SDL_DROPCOMPLETE:
+      return event.drop.windowID;
+    default:
+      return 0;
+  }
+}
+
+// Sets the ID of the window of an input event
+void setEventWindowID(SDL_Event &event, Uint32 windowID) {
+  switch (event.type) {
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+      event.key.windowID = windowID;
+      break;
+    case SDL_TEXTEDITING:
+      event.edit.windowID = windowID;
+      break;
+    case SDL_TEXTINPUT:
+      event.text.windowID = windowID;
+      break;
+    case SDL_MOUSEMOTION:
+      event.motion.windowID = windowID;
+      break;
+    case SDL_MOUSEBUTTONDOWN:
+    case SDL_MOUSEBUTTONUP:
+      event.button.windowID = windowID;
+      break;
+    case SDL_MOUSEWHEEL:
+      event.wheel.windowID = windowID;
+      break;
+  }
+}
+
+// Capture settings from the argument of abcg::Application::capture
+abcg::CaptureSettings getCaptureSettings(std::string_view path) {
+  if (path.starts_with('|')) {
+    return {.format = abcg::CaptureFormat::Pipe,
+            .path = std::string{path.substr(1)}};
+  }
+  if (path.ends_with(".y4m")) {
+    return {.format = abcg::CaptureFormat::Y4M, .path = std::string{path}};
+  }
+  return {.format = abcg::CaptureFormat::PNG, .path = std::string{path}};
+}
+}  // namespace
+
 #if defined(__EMSCRIPTEN__)
 void abcg::mainLoopCallback(void *userData) {
   abcg::Application &app{*(static_cast<abcg::Application *>(userData))};
@@ -31,9 +108,13 @@ void abcg::mainLoopCallback(void *userData) {
  * Constructs an abcg::Application object and initializes SDL library and
  * subsystems.
  *
+ * Recognizes the command-line options `--record <file>`,
+ * `--replay <file>` and `--capture <path>`, which call record(),
+ * replay() and capture().
+ *
  * @throw abcg::Exception if SDL failed to initialize its subsystems.
  */
-abcg::Application::Application([[maybe_unused]] int argc, char **argv) {
+abcg::Application::Application(int argc, char **argv) {
   Uint32 subsystemMask{SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_AUDIO |
                        SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER |
                        SDL_INIT_EVENTS};
@@ -42,6 +123,15 @@ abcg::Application::Application([[maybe_unused]] int argc, char **argv) {
     throw abcg::Exception{abcg::Exception::SDL("SDL_Init failed")};
   }
 
+  const std::span arguments{argv, static_cast<std::size_t>(argc)};
+  for (const auto index : iter::range(std::size_t{1}, arguments.size())) {
+    const std::string_view option{arguments[index]};
+    if (index + 1 == arguments.size()) break;
+    if (option == "--record") record(arguments[index + 1]);
+    if (option == "--replay") replay(arguments[index + 1]);
+    if (option == "--capture") capture(arguments[index + 1]);
+  }
+
 #if !defined(__EMSCRIPTEN__)
   // Load support for the PNG image format
   auto imageFlags{IMG_INIT_PNG};
@@ -72,6 +162,12 @@ abcg::Application::Application([[maybe_unused]] int argc, char **argv) {
  * subsystems.
  */
 abcg::Application::~Application() {
+  // Secondary windows are destroyed first, as they use the resources of the
+  // main window
+  while (!m_windows.empty()) {
+    m_windows.pop_back();
+  }
+
 #if !defined(__EMSCRIPTEN__)
   IMG_Quit();
 #endif
@@ -86,34 +182,346 @@ abcg::Application::~Application() {
  * @throw abcg::Exception if window is a null pointer.
  */
 void abcg::Application::run(std::unique_ptr<OpenGLWindow> window) {
-  if (window != nullptr) {
-    m_window = std::move(window);
-    run();
-  } else {
+  std::vector<std::unique_ptr<OpenGLWindow>> windows;
+  windows.push_back(std::move(window));
+  run(std::move(windows));
+}
+
+/**
+ * @brief Runs the application for multiple windows.
+ *
+ * The first window is the main window. The OpenGL contexts of the other
+ * windows share the objects of the main window, such as textures, buffers
+ * and programs, but not container objects such as VAOs and framebuffers.
+ * Each window has its own ImGui context.
+ *
+ * Vertical synchronization should be enabled in one window at most, since
+ * each buffer swap waits for the next vertical blank.
+ *
+ * @param windows Unique pointers to windows.
+ *
+ * @throw abcg::Exception if the list is empty or has a null pointer, or if
+ * it has more than one window in WebAssembly.
+ */
+void abcg::Application::run(
+    std::vector<std::unique_ptr<OpenGLWindow>> windows) {
+  if (windows.empty() ||
+      std::any_of(windows.begin(), windows.end(),
+                  [](const auto &window) { return window == nullptr; })) {
     throw abcg::Exception{abcg::Exception::Runtime("Null pointer")};
   }
+#if defined(__EMSCRIPTEN__)
+  if (windows.size() > 1) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        "Multiple windows are not supported in WebAssembly")};
+  }
+#endif
+
+  m_windows = std::move(windows);
+  run();
 }
 
+/**
+ * @brief Records the session to a file.
+ *
+ * Records the input events received by the windows and the time steps of
+ * each frame. The file is written when the application ends. Must be called
+ * before run().
+ *
+ * @param path Path of the file to create.
+ *
+ * @sa abcg::EventRecorder.
+ */
+void abcg::Application::record(std::string_view path) { m_recordPath = path; }
+
+/**
+ * @brief Plays back a recorded session.
+ *
+ * The windows are created with their recorded size and paint the recorded
+ * frames, one after another and without frame rate limits, with the
+ * recorded input events, delta times and elapsed times. Input from the
+ * devices is ignored, except for closing the windows. When the recording
+ * ends, the time to paint each frame is summarized in the standard output
+ * and the application ends.
+ *
+ * The frames are reproduced exactly only if the application depends on time
+ * solely through abcg::OpenGLWindow::getDeltaTime,
+ * abcg::OpenGLWindow::getElapsedTime and abcg::OpenGLWindow::update. The
+ * ImGui widgets use the state of the devices and their own clock. Disable
+ * vsync to measure frame times. Must be called before run().
+ *
+ * @param path Path to a file created by record().
+ */
+void abcg::Application::replay(std::string_view path) { m_replayPath = path; }
+
+/**
+ * @brief Captures the frames of the main window from the start.
+ *
+ * The output depends on the path:
+ * - `|<command>`: a YUV4MPEG2 stream is written to the standard input of
+ *   the command, e.g. `"|ffmpeg -y -i - video.mp4"`;
+ * - a path ending in `.y4m`: YUV4MPEG2 video file;
+ * - any other path: directory of PNG files named `frame000000.png`,
+ *   `frame000001.png`, etc.
+ *
+ * Frames are captured at 60 FPS with a fixed time step. Together with
+ * replay(), each run renders the same frames, which can be compared with
+ * golden images with the `abcgdiff` tool. Not supported in WebAssembly.
+ * Must be called before run().
+ *
+ * @param path Command, video file or directory.
+ *
+ * @sa abcg::OpenGLWindow::startCapture.
+ */
+void abcg::Application::capture(std::string_view path) { m_capturePath = path; }
+
 void abcg::Application::mainLoopIterator([[maybe_unused]] bool &done) {
+  // Pass each event to the input of its window
   SDL_Event event{};
   while (SDL_PollEvent(&event) != 0) {
 #if !defined(__EMSCRIPTEN__)
     if (event.type == SDL_QUIT) done = true;
 #endif
-    m_window->handleEvent(event, done);
+    // While replaying, input events come from the recording
+    if (m_player.isOpen() && isInputEvent(event)) continue;
+
+    const auto windowID{getEventWindowID(event)};
+    for (const auto index : iter::range(m_windows.size())) {
+      if (windowID == 0 || windowID == m_windows[index]->m_windowID) {
+        pushEvent(index, event);
+      }
+    }
+  }
+  while (m_player.peek() != nullptr &&
+         m_player.peek()->type == ReplayRecord::Type::Event) {
+    auto record{m_player.read()};
+    if (record.window >= m_windows.size()) continue;
+    setEventWindowID(record.event, m_windows[record.window]->m_windowID);
+    pushEvent(record.window, record.event);
+  }
+
+  const auto now{std::chrono::steady_clock::now()};
+  std::vector<OpenGLWindow *> closedWindows;
+  for (auto &&[index, window] : iter::enumerate(m_windows)) {
+    // Events are ordered by time with the mouse motion events sampled during
+    // the last frame
+    bool closed{};
+    for (auto &windowEvent : window->m_input.takeEvents()) {
+      window->handleEvent(windowEvent, closed);
+    }
+    if (closed) {
+      closedWindows.push_back(window.get());
+      continue;
+    }
+
+    if (isFrameDue(index, now)) paint(index);
+  }
+
+  m_recorder.write({.type = ReplayRecord::Type::EndOfIteration});
+  if (m_player.isOpen()) {
+    // Skip the frames of windows that are no longer open
+    while (!m_player.atEnd() &&
+           m_player.read().type != ReplayRecord::Type::EndOfIteration) {
+    }
+    if (m_player.atEnd()) {
+      finishReplay();
+      done = true;
+    }
+  }
+
+  if (closedWindows.empty()) return;
+  if (closedWindows.front() == m_windows.front().get()) {
+    done = true;
+    return;
   }
-  m_window->paint();
+  std::erase_if(m_windows, [&closedWindows](const auto &window) {
+    return std::find(closedWindows.begin(), closedWindows.end(),
+                     window.get()) != closedWindows.end();
+  });
 }
 
 void abcg::Application::run() {
-  m_window->initialize(m_basePath);
+  auto *mainWindow{m_windows.front().get()};
+  // Windows are created with the recorded sizes
+  if (!m_replayPath.empty()) startReplay();
+  for (auto &window : m_windows) {
+    window->initialize(m_basePath,
+                       window.get() == mainWindow ? nullptr : mainWindow);
+  }
+  if (!m_recordPath.empty()) startRecording();
+  if (!m_capturePath.empty()) {
+    mainWindow->startCapture(getCaptureSettings(m_capturePath));
+  }
 
 #if defined(__EMSCRIPTEN__)
-  emscripten_set_main_loop_arg(mainLoopCallback, this, 0, true);
+  // The browser already throttles hidden pages, so only the frame limiter
+  // applies
+  emscripten_set_main_loop_arg(mainLoopCallback, this,
+                               mainWindow->m_openGLSettings.maxFrameRate,
+                               true);
 #else
   bool done{};
   while (!done) {
     mainLoopIterator(done);
+    // Recorded frames are played back as fast as possible
+    if (!done && !m_player.isOpen()) waitNextFrame();
   };
+  m_windows.front()->stopCapture();
+  m_recorder.close();
 #endif
 }
+
+// Passes an event to the input of a window, and records it if it is an input
+// event
+void abcg::Application::pushEvent(std::size_t index, const SDL_Event &event) {
+  m_windows[index]->m_input.push(event);
+  if (isInputEvent(event)) {
+    m_recorder.write({.type = ReplayRecord::Type::Event,
+                      .window = static_cast<std::uint8_t>(index),
+                      .event = event});
+  }
+}
+
+// Returns whether a window must be painted in this iteration
+bool abcg::Application::isFrameDue(
+    std::size_t index, std::chrono::steady_clock::time_point now) const {
+  if (m_player.isOpen()) {
+    const auto *record{m_player.peek()};
+    return record != nullptr && record->type == ReplayRecord::Type::Frame &&
+           record->window == index;
+  }
+  const auto nextFrameTime{m_windows[index]->getNextFrameTime()};
+  return nextFrameTime && *nextFrameTime <= now;
+}
+
+// Paints a frame of a window with the recorded time steps and mouse motion,
+// if replaying, and records it, if recording
+void abcg::Application::paint(std::size_t index) {
+  using clock = std::chrono::steady_clock;
+  auto &window{*m_windows[index]};
+  auto &sampled{window.m_input.m_sampled};
+
+  if (m_player.isOpen()) {
+    const auto frame{m_player.read()};
+    window.m_lastDeltaTime = frame.deltaTime;
+    window.m_fixedElapsedTime = frame.elapsedTime;
+    while (m_player.peek() != nullptr &&
+           m_player.peek()->type == ReplayRecord::Type::Sample) {
+      auto sample{m_player.read()};
+      setEventWindowID(sample.event, window.m_windowID);
+      sampled.push_back(sample.event);
+    }
+  }
+
+  const auto index8{static_cast<std::uint8_t>(index)};
+  m_recorder.write({.type = ReplayRecord::Type::Frame,
+                    .window = index8,
+                    .deltaTime = window.m_lastDeltaTime,
+                    .elapsedTime = window.getElapsedTime()});
+
+  const auto start{clock::now()};
+  window.paint();
+  if (m_player.isOpen()) {
+    m_replayFrameTimes.push_back(
+        std::chrono::duration<double>{clock::now() - start}.count());
+  }
+
+  if (m_recorder.isOpen()) {
+    for (const auto &event : sampled) {
+      m_recorder.write({.type = ReplayRecord::Type::Sample,
+                        .window = index8,
+                        .event = event});
+    }
+  }
+  sampled.clear();
+}
+
+void abcg::Application::startRecording() {
+  std::vector<glm::ivec2> windowSizes;
+  for (const auto &window : m_windows) {
+    auto &size{windowSizes.emplace_back()};
+    SDL_GetWindowSize(window->m_window, &size.x, &size.y);
+    window->m_input.m_recording = true;
+  }
+  m_recorder.open(m_recordPath, windowSizes);
+}
+
+void abcg::Application::startReplay() {
+  m_player.open(m_replayPath);
+  for (auto &&[window, size] :
+       iter::zip(m_windows, m_player.getWindowSizes())) {
+    window->m_windowSettings.width = size.x;
+    window->m_windowSettings.height = size.y;
+    window->m_input.m_replaying = true;
+  }
+}
+
+// Returns the windows to live input and reports the frame times
+void abcg::Application::finishReplay() {
+  m_player.close();
+  for (auto &window : m_windows) {
+    window->m_input.m_replaying = false;
+    window->m_fixedElapsedTime.reset();
+  }
+
+  auto &frameTimes{m_replayFrameTimes};
+  if (frameTimes.empty()) return;
+  std::ranges::sort(frameTimes);
+  const auto percentile{[&frameTimes](double fraction) {
+    const auto last{static_cast<double>(frameTimes.size() - 1)};
+    return frameTimes[static_cast<std::size_t>(fraction * last)] * 1000.0;
+  }};
+  const auto mean{std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0) /
+                  static_cast<double>(frameTimes.size()) * 1000.0};
+  fmt::print(
+      "Replayed {} frames: mean {:.3f} ms, median {:.3f} ms, 99th percentile "
+      "{:.3f} ms, max {:.3f} ms\n",
+      frameTimes.size(), mean, percentile(0.5), percentile(0.99),
+      frameTimes.back() * 1000.0);
+  frameTimes.clear();
+}
+
+// Waits until the next frame of any window is due, or until an event arrives
+void abcg::Application::waitNextFrame() {
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  for (const auto &window : m_windows) {
+    if (const auto nextFrameTime{window->getNextFrameTime()}) {
+      deadline = deadline ? std::min(*deadline, *nextFrameTime)
+                          : *nextFrameTime;
+    }
+  }
+
+  // All windows render on demand and wait for an event
+  if (!deadline) {
+    SDL_WaitEvent(nullptr);
+    return;
+  }
+
+  waitUntil(*deadline);
+}
+
+// Waits until the deadline or until an event arrives
+void abcg::Application::waitUntil(
+    std::chrono::steady_clock::time_point deadline) {
+  using clock = std::chrono::steady_clock;
+
+  // Sleep until shortly before the deadline, and spin for the rest. The
+  // margin follows the largest recent oversleep, which depends on the timer
+  // resolution of the system
+  const auto now{clock::now()};
+  if (const auto sleepTime{
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              deadline - now - m_sleepOvershoot)};
+      sleepTime.count() > 0) {
+    if (SDL_WaitEventTimeout(nullptr, static_cast<int>(sleepTime.count())) !=
+        0) {
+      return;
+    }
+    const auto overshoot{clock::now() - (now + sleepTime)};
+    m_sleepOvershoot =
+        std::max(overshoot, m_sleepOvershoot - m_sleepOvershoot / 16);
+  }
+  while (clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+}
@@ -10,9 +10,13 @@
 #ifndef ABCG_APPLICATION_HPP_
 #define ABCG_APPLICATION_HPP_
 
+#include <chrono>
 #include <memory>
+#include <string_view>
+#include <vector>
 
 #include "abcg_exception.hpp"
+#include "abcg_replay.hpp"
 
 namespace abcg {
 class Application;
@@ -27,6 +31,16 @@ void mainLoopCallback(void* userData);
  *
  * This is the main application class that starts an ABCg application.
  *
+ * An application can run several windows. The first window is the main
+ * window: the application ends when it is closed. The other windows share
+ * the OpenGL objects of the main window and are destroyed when closed.
+ *
+ * A session can be recorded to a file and played back later with the same
+ * input events and time steps, either with record() and replay(), or with
+ * the command-line options `--record <file>` and `--replay <file>`. The
+ * frames of the main window can be written to PNG files or to a video with
+ * capture(), or `--capture <path>`, e.g. to compare a replay with golden
+ * images using the `abcgdiff` tool.
  */
 class abcg::Application {
  public:
@@ -39,13 +53,40 @@ class abcg::Application {
   Application& operator=(Application&&) = default;
 
   void run(std::unique_ptr<OpenGLWindow> window);
+  void run(std::vector<std::unique_ptr<OpenGLWindow>> windows);
+
+  void record(std::string_view path);
+  void replay(std::string_view path);
+  void capture(std::string_view path);
 
  private:
   void mainLoopIterator(bool& done);
   void run();
+  void pushEvent(std::size_t index, const SDL_Event& event);
+  [[nodiscard]] bool isFrameDue(
+      std::size_t index, std::chrono::steady_clock::time_point now) const;
+  void paint(std::size_t index);
+  void startRecording();
+  void startReplay();
+  void finishReplay();
+  void waitNextFrame();
+  void waitUntil(std::chrono::steady_clock::time_point deadline);
 
   std::string m_basePath;
-  std::unique_ptr<OpenGLWindow> m_window;
+  // The first window is the main window
+  std::vector<std::unique_ptr<OpenGLWindow>> m_windows;
+
+  // Frame pacing
+  std::chrono::steady_clock::duration m_sleepOvershoot{};
+
+  // Recording and playback
+  std::string m_recordPath;
+  std::string m_replayPath;
+  std::string m_capturePath;
+  EventRecorder m_recorder;
+  EventPlayer m_player;
+  // Time to paint each frame played back, in seconds
+  std::vector<double> m_replayFrameTimes;
 
 #if defined(__EMSCRIPTEN__)
   friend void mainLoopCallback(void* userData);
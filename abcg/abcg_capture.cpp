@@ -0,0 +1,268 @@
+/**
+ * @file abcg_capture.cpp
+ * @brief Definition of abcg::FrameCapture members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_capture.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cppitertools/itertools.hpp>
+#include <filesystem>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "abcg_exception.hpp"
+
+namespace {
+// Frames waiting for the writer thread before the window waits
+constexpr std::size_t maxQueuedFrames{8};
+
+std::FILE *openPipe(const std::string &command) {
+#if defined(WIN32)
+  return _popen(command.c_str(), "wb");
+#elif defined(__EMSCRIPTEN__)
+  return nullptr;
+#else
+  return popen(command.c_str(), "w");
+#endif
+}
+
+void closePipe(std::FILE *pipe) {
+#if defined(WIN32)
+  _pclose(pipe);
+#elif !defined(__EMSCRIPTEN__)
+  pclose(pipe);
+#endif
+}
+
+std::uint8_t toByte(float value) {
+  return static_cast<std::uint8_t>(std::clamp(value + 0.5f, 0.0f, 255.0f));
+}
+
+// Converts an RGBA image to planar YUV 4:2:0 with full range BT.601
+// coefficients and centered chroma, as tagged by C420jpeg
+std::vector<std::uint8_t> convertToYUV420(const abcg::Image &image) {
+  const auto width{static_cast<std::size_t>(image.width)};
+  const auto height{static_cast<std::size_t>(image.height)};
+  const auto chromaWidth{(width + 1) / 2};
+  const auto chromaHeight{(height + 1) / 2};
+  const auto lumaSize{width * height};
+  const auto chromaSize{chromaWidth * chromaHeight};
+
+  std::vector<std::uint8_t> frame(lumaSize + 2 * chromaSize);
+  const std::span planes{frame};
+  const auto luma{planes.first(lumaSize)};
+  const auto blueDifference{planes.subspan(lumaSize, chromaSize)};
+  const auto redDifference{planes.subspan(lumaSize + chromaSize, chromaSize)};
+
+  const auto getColor{[&image, width](std::size_t x, std::size_t y) {
+    const auto offset{(y * width + x) * 4};
+    return glm::vec3{image.pixels[offset + 0], image.pixels[offset + 1],
+                     image.pixels[offset + 2]};
+  }};
+
+  const glm::vec3 lumaWeights{0.299f, 0.587f, 0.114f};
+  for (const auto y : iter::range(height)) {
+    for (const auto x : iter::range(width)) {
+      luma[y * width + x] = toByte(glm::dot(getColor(x, y), lumaWeights));
+    }
+  }
+
+  for (const auto y : iter::range(chromaHeight)) {
+    for (const auto x : iter::range(chromaWidth)) {
+      // Average of the 2x2 block, clamped to the image at odd sizes
+      const auto x1{std::min(2 * x + 1, width - 1)};
+      const auto y1{std::min(2 * y + 1, height - 1)};
+      const auto color{(getColor(2 * x, 2 * y) + getColor(x1, 2 * y) +
+                        getColor(2 * x, y1) + getColor(x1, y1)) *
+                       0.25f};
+      const auto index{y * chromaWidth + x};
+      blueDifference[index] = toByte(
+          128.0f + glm::dot(color, glm::vec3{-0.168736f, -0.331264f, 0.5f}));
+      redDifference[index] = toByte(
+          128.0f + glm::dot(color, glm::vec3{0.5f, -0.418688f, -0.081312f}));
+    }
+  }
+
+  return frame;
+}
+}  // namespace
+
+/**
+ * @brief Opens the output and starts the writer thread.
+ *
+ * @param settings Capture settings.
+ *
+ * @throw abcg::Exception if the output cannot be opened, if the frame rate
+ * is not positive, or in WebAssembly.
+ */
+abcg::FrameCapture::FrameCapture(CaptureSettings settings)
+    : m_settings{std::move(settings)} {
+#if defined(__EMSCRIPTEN__)
+  throw abcg::Exception{abcg::Exception::Runtime(
+      "Frame capture is not supported in WebAssembly")};
+#else
+  if (m_settings.frameRate <= 0) {
+    throw abcg::Exception{
+        abcg::Exception::Runtime("Capture frame rate must be positive")};
+  }
+
+  switch (m_settings.format) {
+    case CaptureFormat::PNG:
+      std::filesystem::create_directories(m_settings.path);
+      break;
+    case CaptureFormat::Y4M:
+      m_output = std::fopen(m_settings.path.c_str(), "wb");
+      break;
+    case CaptureFormat::Pipe:
+      m_output = openPipe(m_settings.path);
+      break;
+  }
+  if (m_settings.format != CaptureFormat::PNG && m_output == nullptr) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to open capture output {}", m_settings.path))};
+  }
+
+  m_thread = std::thread{[this] { writeFrames(); }};
+#endif
+}
+
+/**
+ * @brief Discards the pending readbacks and writes the queued frames.
+ *
+ * Call finish() before to also write the frames being read back and to get
+ * writing errors.
+ */
+abcg::FrameCapture::~FrameCapture() {
+  m_reader.destroy();
+  stop();
+}
+
+/**
+ * @brief Captures the frame in the bound read framebuffer.
+ *
+ * Call before the buffer swap. The frame is written after its readback is
+ * finished, usually while the next frame is rendered.
+ *
+ * @param width Width of the framebuffer.
+ * @param height Height of the framebuffer.
+ *
+ * @throw abcg::Exception if a previous frame could not be written.
+ */
+void abcg::FrameCapture::capture(int width, int height) {
+  rethrowError();
+  m_reader.read(width, height);
+  while (auto image{m_reader.poll()}) {
+    enqueue(std::move(*image));
+  }
+}
+
+/**
+ * @brief Writes all captured frames and closes the output.
+ *
+ * @throw abcg::Exception if a frame could not be written.
+ */
+void abcg::FrameCapture::finish() {
+  while (auto image{m_reader.wait()}) {
+    enqueue(std::move(*image));
+  }
+  m_reader.destroy();
+  stop();
+  rethrowError();
+}
+
+void abcg::FrameCapture::enqueue(Image image) {
+  std::unique_lock lock{m_mutex};
+  m_condition.wait(lock, [this] {
+    return m_queue.size() < maxQueuedFrames || m_error != nullptr;
+  });
+  m_queue.push_back(std::move(image));
+  lock.unlock();
+  m_condition.notify_all();
+}
+
+// Waits for the writer thread to write the queued frames and closes the
+// output
+void abcg::FrameCapture::stop() {
+  {
+    const std::scoped_lock lock{m_mutex};
+    m_stopping = true;
+  }
+  m_condition.notify_all();
+  if (m_thread.joinable()) m_thread.join();
+
+  if (m_output != nullptr) {
+    if (m_settings.format == CaptureFormat::Pipe) {
+      closePipe(m_output);
+    } else {
+      std::fclose(m_output);
+    }
+    m_output = nullptr;
+  }
+}
+
+void abcg::FrameCapture::rethrowError() {
+  const std::scoped_lock lock{m_mutex};
+  if (m_error != nullptr) std::rethrow_exception(std::exchange(m_error, {}));
+}
+
+// Main function of the writer thread
+void abcg::FrameCapture::writeFrames() {
+  while (true) {
+    Image image;
+    {
+      std::unique_lock lock{m_mutex};
+      m_condition.wait(lock, [this] { return !m_queue.empty() || m_stopping; });
+      if (m_queue.empty()) return;
+      image = std::move(m_queue.front());
+      m_queue.pop_front();
+    }
+    m_condition.notify_all();
+
+    try {
+      writeFrame(image);
+    } catch (...) {
+      {
+        const std::scoped_lock lock{m_mutex};
+        m_error = std::current_exception();
+        m_queue.clear();
+      }
+      m_condition.notify_all();
+      return;
+    }
+  }
+}
+
+void abcg::FrameCapture::writeFrame(const Image &image) {
+  if (m_settings.format == CaptureFormat::PNG) {
+    abcg::writeImage(
+        fmt::format("{}/frame{:06}.png", m_settings.path, m_frameCount++),
+        image);
+    return;
+  }
+
+  if (m_frameCount == 0) {
+    m_videoWidth = image.width;
+    m_videoHeight = image.height;
+    fmt::print(m_output,
+               "YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C420jpeg XYSCSS=420JPEG "
+               "XCOLORRANGE=FULL\n",
+               m_videoWidth, m_videoHeight, m_settings.frameRate);
+  }
+  if (image.width != m_videoWidth || image.height != m_videoHeight) return;
+
+  const auto frame{convertToYUV420(image)};
+  fmt::print(m_output, "FRAME\n");
+  if (std::fwrite(frame.data(), 1, frame.size(), m_output) != frame.size()) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to write frame to {}", m_settings.path))};
+  }
+  ++m_frameCount;
+}
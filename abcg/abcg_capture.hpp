@@ -0,0 +1,115 @@
+/**
+ * @file abcg_capture.hpp
+ * @brief Declaration of abcg::FrameCapture.
+ *
+ * Frames are read back with double-buffered pixel buffer objects and
+ * written by a background thread, so that capturing does not wait for the
+ * GPU or for the disk.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_CAPTURE_HPP_
+#define ABCG_CAPTURE_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "abcg_readback.hpp"
+
+namespace abcg {
+class FrameCapture;
+enum class CaptureFormat;
+struct CaptureSettings;
+}  // namespace abcg
+
+/**
+ * @brief Output formats of abcg::FrameCapture.
+ *
+ */
+enum class abcg::CaptureFormat {
+  // Numbered PNG files in a directory
+  PNG,
+  // Uncompressed YUV 4:2:0 video in a YUV4MPEG2 file
+  Y4M,
+  // YUV4MPEG2 stream written to the standard input of a command, such as
+  // "ffmpeg -y -i - -c:v libx264 -pix_fmt yuv420p video.mp4"
+  Pipe
+};
+
+/**
+ * @brief Settings of abcg::FrameCapture.
+ *
+ */
+struct abcg::CaptureSettings {
+  CaptureFormat format{CaptureFormat::PNG};
+  // Directory, file or command, depending on the format
+  std::string path{};
+  int frameRate{60};
+  // Advance the time of the window by 1/frameRate per frame, so that the
+  // video plays at the speed of the application regardless of how long
+  // each frame takes to render and capture
+  bool fixedTimeStep{true};
+};
+
+/**
+ * @brief abcg::FrameCapture class.
+ *
+ * Writes the frames of a window to PNG files or to a video. Each frame is
+ * read back with abcg::FrameReader and queued for a writer thread. The
+ * window waits only if the writer falls behind by more than a few frames.
+ *
+ * Y4M videos keep the size of the first frame; frames of other sizes are
+ * skipped. Not supported in WebAssembly.
+ *
+ * Functions that take readbacks, including the destructor, must be called
+ * with the OpenGL context of the window current.
+ */
+class abcg::FrameCapture {
+ public:
+  explicit FrameCapture(CaptureSettings settings);
+  ~FrameCapture();
+
+  FrameCapture(const FrameCapture &) = delete;
+  FrameCapture(FrameCapture &&) = delete;
+  FrameCapture &operator=(const FrameCapture &) = delete;
+  FrameCapture &operator=(FrameCapture &&) = delete;
+
+  void capture(int width, int height);
+  void finish();
+
+  [[nodiscard]] const CaptureSettings &getSettings() const {
+    return m_settings;
+  }
+
+ private:
+  CaptureSettings m_settings;
+  FrameReader m_reader{2};
+
+  std::thread m_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<Image> m_queue;
+  bool m_stopping{};
+  // Error of the writer thread, rethrown by capture() and finish()
+  std::exception_ptr m_error;
+
+  std::FILE *m_output{};
+  std::size_t m_frameCount{};
+  int m_videoWidth{};
+  int m_videoHeight{};
+
+  void enqueue(Image image);
+  void stop();
+  void rethrowError();
+  void writeFrames();
+  void writeFrame(const Image &image);
+};
+
+#endif
@@ -0,0 +1,1010 @@
+/**
+ * @file abcg_gltf.cpp
+ * @brief Definition of the glTF 2.0 loader of abcg::Model.
+ *
+ * Supports glTF files with JSON (`.gltf`) and binary (`.glb`) containers,
+ * with buffers stored in the GLB binary chunk, in external files or in data
+ * URIs.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cppitertools/itertools.hpp>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "abcg_exception.hpp"
+#include "abcg_meshnormals.hpp"
+#include "abcg_model.hpp"
+#include "abcg_openglfunctions.hpp"
+#include "abcg_pack.hpp"
+
+namespace {
+// Error in the contents of a glTF file, reported with the path of the file
+class GLTFError : public std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+// JSON value with the subset of the JSON data model used by glTF
+struct JsonValue {
+  enum class Type { Null, Boolean, Number, String, Array, Object };
+
+  Type type{Type::Null};
+  bool boolean{};
+  double number{};
+  std::string string{};
+  std::vector<JsonValue> array{};
+  std::vector<std::pair<std::string, JsonValue>> object{};
+
+  // Member of an object, or a null value if there is no such member
+  [[nodiscard]] const JsonValue &operator[](std::string_view key) const;
+  // Element of an array, or a null value if out of range
+  [[nodiscard]] const JsonValue &at(std::size_t index) const;
+
+  [[nodiscard]] bool isNull() const { return type == Type::Null; }
+  [[nodiscard]] std::size_t size() const { return array.size(); }
+  [[nodiscard]] double asNumber(double fallback = 0.0) const {
+    return type == Type::Number ? number : fallback;
+  }
+  [[nodiscard]] std::size_t asIndex() const;
+  [[nodiscard]] std::size_t asIndex(std::size_t fallback) const {
+    return isNull() ? fallback : asIndex();
+  }
+};
+
+const JsonValue nullValue{};
+
+const JsonValue &JsonValue::operator[](std::string_view key) const {
+  const auto it{std::ranges::find(object, key, [](const auto &member) {
+    return std::string_view{member.first};
+  })};
+  return it == object.end() ? nullValue : it->second;
+}
+
+const JsonValue &JsonValue::at(std::size_t index) const {
+  return index < array.size() ? array[index] : nullValue;
+}
+
+// Non-negative integer, as used by glTF to refer to other objects
+std::size_t JsonValue::asIndex() const {
+  constexpr auto maxIndex{double{1ULL << 53U}};
+  if (type != Type::Number || number < 0.0 || number >= maxIndex ||
+      number != static_cast<double>(static_cast<std::uint64_t>(number))) {
+    throw GLTFError{"invalid or missing index"};
+  }
+  return static_cast<std::size_t>(number);
+}
+
+class JsonParser {
+ public:
+  explicit JsonParser(std::string_view text) : m_text{text} {}
+
+  [[nodiscard]] JsonValue parse() {
+    auto value{parseValue(0)};
+    skipWhitespace();
+    if (m_position != m_text.size()) fail();
+    return value;
+  }
+
+ private:
+  // Nesting limit, to avoid stack overflows on malformed files
+  static constexpr int maxDepth{256};
+
+  std::string_view m_text;
+  std::size_t m_position{};
+
+  [[noreturn]] void fail() const {
+    throw GLTFError{fmt::format("invalid JSON at offset {}", m_position)};
+  }
+
+  void skipWhitespace() {
+    while (m_position < m_text.size() &&
+           (m_text[m_position] == ' ' || m_text[m_position] == '\t' ||
+            m_text[m_position] == '\n' || m_text[m_position] == '\r')) {
+      ++m_position;
+    }
+  }
+
+  [[nodiscard]] bool consume(char character) {
+    skipWhitespace();
+    if (m_position < m_text.size() && m_text[m_position] == character) {
+      ++m_position;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(char character) {
+    if (!consume(character)) fail();
+  }
+
+  void expectLiteral(std::string_view literal) {
+    if (m_text.substr(m_position, literal.size()) != literal) fail();
+    m_position += literal.size();
+  }
+
+  [[nodiscard]] JsonValue parseValue(int depth);
+  [[nodiscard]] std::string parseString();
+  [[nodiscard]] std::uint32_t parseHex4();
+};
+
+JsonValue JsonParser::parseValue(int depth) {
+  skipWhitespace();
+  if (depth > maxDepth || m_position >= m_text.size()) fail();
+
+  JsonValue value;
+  switch (m_text[m_position]) {
+    case '{':
+      value.type = JsonValue::Type::Object;
+      ++m_position;
+      if (consume('}')) break;
+      do {
+        skipWhitespace();
+        auto key{parseString()};
+        expect(':');
+        value.object.emplace_back(std::move(key), parseValue(depth + 1));
+      } while (consume(','));
+      expect('}');
+      break;
+    case '[':
+      value.type = JsonValue::Type::Array;
+      ++m_position;
+      if (consume(']')) break;
+      do {
+        value.array.push_back(parseValue(depth + 1));
+      } while (consume(','));
+      expect(']');
+      break;
+    case '"':
+      value.type = JsonValue::Type::String;
+      value.string = parseString();
+      break;
+    case 't':
+      expectLiteral("true");
+      value.type = JsonValue::Type::Boolean;
+      value.boolean = true;
+      break;
+    case 'f':
+      expectLiteral("false");
+      value.type = JsonValue::Type::Boolean;
+      break;
+    case 'n':
+      expectLiteral("null");
+      break;
+    default: {
+      const auto *first{m_text.data() + m_position};
+      const auto *last{m_text.data() + m_text.size()};
+      const auto [end, error]{std::from_chars(first, last, value.number)};
+      if (error != std::errc{}) fail();
+      value.type = JsonValue::Type::Number;
+      m_position += static_cast<std::size_t>(end - first);
+      break;
+    }
+  }
+  return value;
+}
+
+std::uint32_t JsonParser::parseHex4() {
+  if (m_position + 4 > m_text.size()) fail();
+  std::uint32_t code{};
+  const auto *first{m_text.data() + m_position};
+  const auto [end, error]{std::from_chars(first, first + 4, code, 16)};
+  if (error != std::errc{} || end != first + 4) fail();
+  m_position += 4;
+  return code;
+}
+
+// Parses a string and converts its escape sequences to UTF-8
+std::string JsonParser::parseString() {
+  if (m_position >= m_text.size() || m_text[m_position] != '"') fail();
+  ++m_position;
+
+  std::string result;
+  while (true) {
+    if (m_position >= m_text.size()) fail();
+    const auto character{m_text[m_position++]};
+    if (character == '"') break;
+    if (character != '\\') {
+      result.push_back(character);
+      continue;
+    }
+
+    if (m_position >= m_text.size()) fail();
+    switch (m_text[m_position++]) {
+      case '"':
+        result.push_back('"');
+        break;
+      case '\\':
+        result.push_back('\\');
+        break;
+      case '/':
+        result.push_back('/');
+        break;
+      case 'b':
+        result.push_back('\b');
+        break;
+      case 'f':
+        result.push_back('\f');
+        break;
+      case 'n':
+        result.push_back('\n');
+        break;
+      case 'r':
+        result.push_back('\r');
+        break;
+      case 't':
+        result.push_back('\t');
+        break;
+      case 'u': {
+        auto code{parseHex4()};
+        // Surrogate pair
+        if (code >= 0xD800 && code < 0xDC00 &&
+            m_text.substr(m_position, 2) == "\\u") {
+          m_position += 2;
+          const auto low{parseHex4()};
+          if (low < 0xDC00 || low >= 0xE000) fail();
+          code = 0x10000 + ((code - 0xD800) << 10U) + (low - 0xDC00);
+        }
+        const auto append{[&](std::uint32_t byte) {
+          result.push_back(static_cast<char>(byte));
+        }};
+        if (code < 0x80) {
+          append(code);
+        } else if (code < 0x800) {
+          append(0xC0 | (code >> 6U));
+          append(0x80 | (code & 0x3FU));
+        } else if (code < 0x10000) {
+          append(0xE0 | (code >> 12U));
+          append(0x80 | ((code >> 6U) & 0x3FU));
+          append(0x80 | (code & 0x3FU));
+        } else {
+          append(0xF0 | (code >> 18U));
+          append(0x80 | ((code >> 12U) & 0x3FU));
+          append(0x80 | ((code >> 6U) & 0x3FU));
+          append(0x80 | (code & 0x3FU));
+        }
+        break;
+      }
+      default:
+        fail();
+    }
+  }
+  return result;
+}
+
+[[nodiscard]] std::vector<std::byte> decodeBase64(std::string_view text) {
+  std::vector<std::byte> bytes;
+  bytes.reserve(text.size() / 4 * 3);
+
+  std::uint32_t bits{};
+  auto bitCount{0};
+  for (const auto character : text) {
+    std::uint32_t value{};
+    if (character >= 'A' && character <= 'Z') {
+      value = static_cast<std::uint32_t>(character - 'A');
+    } else if (character >= 'a' && character <= 'z') {
+      value = static_cast<std::uint32_t>(character - 'a' + 26);
+    } else if (character >= '0' && character <= '9') {
+      value = static_cast<std::uint32_t>(character - '0' + 52);
+    } else if (character == '+') {
+      value = 62;
+    } else if (character == '/') {
+      value = 63;
+    } else if (character == '=') {
+      break;
+    } else {
+      throw GLTFError{"invalid base64 data"};
+    }
+
+    bits = (bits << 6U) | value;
+    bitCount += 6;
+    if (bitCount >= 8) {
+      bitCount -= 8;
+      bytes.push_back(static_cast<std::byte>((bits >> bitCount) & 0xFFU));
+    }
+  }
+  return bytes;
+}
+
+// Decodes the percent-encoded characters of a relative URI
+[[nodiscard]] std::string decodeURI(std::string_view uri) {
+  std::string result;
+  for (std::size_t position{}; position < uri.size(); ++position) {
+    std::uint8_t code{};
+    if (uri[position] == '%' && position + 2 < uri.size() &&
+        std::from_chars(&uri[position + 1], &uri[position + 3], code, 16)
+                .ptr == &uri[position + 3]) {
+      result.push_back(static_cast<char>(code));
+      position += 2;
+    } else {
+      result.push_back(uri[position]);
+    }
+  }
+  return result;
+}
+
+// Contents of an asset, read from a mounted pack file or memory-mapped
+class AssetView {
+ public:
+  explicit AssetView(const std::string &path) {
+    if (auto asset{abcg::readPackedAsset(path)}) {
+      m_asset = std::move(*asset);
+      m_data = m_asset.data();
+    } else {
+      m_file.open(path);
+      m_data = m_file.data();
+    }
+  }
+
+  [[nodiscard]] std::span<const std::byte> data() const { return m_data; }
+
+ private:
+  abcg::AssetBuffer m_asset;
+  abcg::MappedFile m_file;
+  std::span<const std::byte> m_data;
+};
+
+// Component types of accessors
+constexpr int componentByte{5120};
+constexpr int componentUnsignedByte{5121};
+constexpr int componentShort{5122};
+constexpr int componentUnsignedShort{5123};
+constexpr int componentUnsignedInt{5125};
+constexpr int componentFloat{5126};
+
+// Primitive topology of triangle lists, the only one supported
+constexpr std::size_t modeTriangles{4};
+
+// Accessor resolved to the bytes of its buffer view
+struct Accessor {
+  // Starts at the first element. Empty if the accessor has no buffer view,
+  // in which case all elements are zero.
+  std::span<const std::byte> data{};
+  std::size_t count{};
+  std::size_t stride{};
+  int componentType{};
+  std::size_t components{};
+  bool normalized{};
+};
+
+template <typename T>
+[[nodiscard]] T readScalar(const std::byte *bytes, std::size_t component) {
+  T value{};
+  std::memcpy(&value, bytes + component * sizeof(T), sizeof(T));
+  return value;
+}
+
+// Component of an element of an accessor, converted to float
+[[nodiscard]] float readComponent(const Accessor &accessor,
+                                  std::size_t element, std::size_t component) {
+  if (accessor.data.empty()) return 0.0f;
+
+  const auto *bytes{accessor.data.data() + element * accessor.stride};
+  const auto normalize{[&](auto value, float maxValue) {
+    const auto result{static_cast<float>(value)};
+    return accessor.normalized ? std::max(result / maxValue, -1.0f) : result;
+  }};
+  switch (accessor.componentType) {
+    case componentByte:
+      return normalize(readScalar<std::int8_t>(bytes, component), 127.0f);
+    case componentUnsignedByte:
+      return normalize(readScalar<std::uint8_t>(bytes, component), 255.0f);
+    case componentShort:
+      return normalize(readScalar<std::int16_t>(bytes, component), 32767.0f);
+    case componentUnsignedShort:
+      return normalize(readScalar<std::uint16_t>(bytes, component),
+                       65535.0f);
+    case componentUnsignedInt:
+      return static_cast<float>(readScalar<std::uint32_t>(bytes, component));
+    default:
+      return readScalar<float>(bytes, component);
+  }
+}
+
+template <glm::length_t N>
+[[nodiscard]] glm::vec<N, float> readVector(const Accessor &accessor,
+                                            std::size_t element) {
+  glm::vec<N, float> vector{};
+  for (const auto component : iter::range(
+           std::min(static_cast<std::size_t>(N), accessor.components))) {
+    vector[static_cast<glm::length_t>(component)] =
+        readComponent(accessor, element, component);
+  }
+  return vector;
+}
+
+[[nodiscard]] GLuint readIndex(const Accessor &accessor, std::size_t element) {
+  const auto *bytes{accessor.data.data() + element * accessor.stride};
+  switch (accessor.componentType) {
+    case componentUnsignedByte:
+      return readScalar<std::uint8_t>(bytes, 0);
+    case componentUnsignedShort:
+      return readScalar<std::uint16_t>(bytes, 0);
+    default:
+      return readScalar<std::uint32_t>(bytes, 0);
+  }
+}
+
+// glTF document and the contents of its buffers
+class GLTFDocument {
+ public:
+  explicit GLTFDocument(std::string_view path);
+
+  [[nodiscard]] const JsonValue &json() const { return m_json; }
+  [[nodiscard]] std::span<const std::byte> readURI(std::string_view uri);
+  [[nodiscard]] std::span<const std::byte> getBufferView(
+      std::size_t index) const;
+  [[nodiscard]] Accessor getAccessor(std::size_t index) const;
+
+ private:
+  JsonValue m_json;
+  std::string m_basePath;
+  std::vector<std::span<const std::byte>> m_buffers;
+
+  // Storage of the file and of the buffers referenced by URIs
+  std::vector<std::unique_ptr<AssetView>> m_files;
+  std::vector<std::vector<std::byte>> m_decodedURIs;
+};
+
+GLTFDocument::GLTFDocument(std::string_view path)
+    : m_basePath{std::filesystem::path{path}.parent_path().string() + "/"} {
+  const auto &file{
+      m_files.emplace_back(std::make_unique<AssetView>(std::string{path}))};
+  const auto data{file->data()};
+
+  const auto read32{[&](std::size_t offset) {
+    std::uint32_t value{};
+    std::memcpy(&value, &data[offset], sizeof(value));
+    return value;
+  }};
+
+  // GLB layout: 12-byte header (magic, version and length), then chunks with
+  // length, type and data padded to 4 bytes. The first chunk is JSON and the
+  // optional second chunk is the binary buffer.
+  constexpr std::uint32_t glbMagic{0x46546C67};  // "glTF"
+  constexpr std::uint32_t chunkJSON{0x4E4F534A};
+  constexpr std::uint32_t chunkBIN{0x004E4942};
+  std::string_view text;
+  std::span<const std::byte> binaryChunk;
+  if (data.size() >= 12 && read32(0) == glbMagic) {
+    if (read32(4) != 2) throw GLTFError{"unsupported GLB version"};
+    const auto length{std::min<std::size_t>(read32(8), data.size())};
+    std::size_t offset{12};
+    while (offset + 8 <= length) {
+      const std::size_t chunkLength{read32(offset)};
+      const auto chunkType{read32(offset + 4)};
+      offset += 8;
+      if (chunkLength > length - offset) throw GLTFError{"truncated GLB"};
+      const auto chunk{data.subspan(offset, chunkLength)};
+      if (chunkType == chunkJSON && text.empty()) {
+        text = {reinterpret_cast<const char *>(chunk.data()), chunk.size()};
+      } else if (chunkType == chunkBIN && binaryChunk.empty()) {
+        binaryChunk = chunk;
+      }
+      offset += (chunkLength + 3) & ~std::size_t{3};
+    }
+  } else {
+    text = {reinterpret_cast<const char *>(data.data()), data.size()};
+  }
+
+  m_json = JsonParser{text}.parse();
+
+  for (const auto &buffer : m_json["buffers"].array) {
+    // Only the buffer stored in the binary chunk has no URI
+    const auto &uri{buffer["uri"]};
+    const auto contents{uri.type == JsonValue::Type::String
+                            ? readURI(uri.string)
+                            : binaryChunk};
+    const auto byteLength{buffer["byteLength"].asIndex()};
+    if (contents.size() < byteLength) throw GLTFError{"buffer too small"};
+    m_buffers.push_back(contents.first(byteLength));
+  }
+}
+
+std::span<const std::byte> GLTFDocument::readURI(std::string_view uri) {
+  if (uri.starts_with("data:")) {
+    const auto comma{uri.find(',')};
+    if (comma == std::string_view::npos ||
+        !uri.substr(0, comma).ends_with(";base64")) {
+      throw GLTFError{"unsupported data URI"};
+    }
+    return m_decodedURIs.emplace_back(decodeBase64(uri.substr(comma + 1)));
+  }
+  const auto &file{m_files.emplace_back(
+      std::make_unique<AssetView>(m_basePath + decodeURI(uri)))};
+  return file->data();
+}
+
+std::span<const std::byte> GLTFDocument::getBufferView(
+    std::size_t index) const {
+  const auto &view{m_json["bufferViews"].at(index)};
+  const auto bufferIndex{view["buffer"].asIndex()};
+  const auto offset{view["byteOffset"].asIndex(0)};
+  const auto length{view["byteLength"].asIndex()};
+  if (bufferIndex >= m_buffers.size() ||
+      offset > m_buffers[bufferIndex].size() ||
+      length > m_buffers[bufferIndex].size() - offset) {
+    throw GLTFError{fmt::format("invalid buffer view {}", index)};
+  }
+  return m_buffers[bufferIndex].subspan(offset, length);
+}
+
+Accessor GLTFDocument::getAccessor(std::size_t index) const {
+  const auto &json{m_json["accessors"].at(index)};
+  if (!json["sparse"].isNull()) {
+    throw GLTFError{"sparse accessors are not supported"};
+  }
+
+  Accessor accessor{
+      .count = json["count"].asIndex(),
+      .componentType = static_cast<int>(json["componentType"].asIndex()),
+      .normalized = json["normalized"].boolean};
+
+  const auto &type{json["type"].string};
+  if (type == "SCALAR") {
+    accessor.components = 1;
+  } else if (type == "VEC2") {
+    accessor.components = 2;
+  } else if (type == "VEC3") {
+    accessor.components = 3;
+  } else if (type == "VEC4") {
+    accessor.components = 4;
+  } else {
+    throw GLTFError{fmt::format("unsupported type of accessor {}", index)};
+  }
+
+  std::size_t componentSize{};
+  switch (accessor.componentType) {
+    case componentByte:
+    case componentUnsignedByte:
+      componentSize = 1;
+      break;
+    case componentShort:
+    case componentUnsignedShort:
+      componentSize = 2;
+      break;
+    case componentUnsignedInt:
+    case componentFloat:
+      componentSize = 4;
+      break;
+    default:
+      throw GLTFError{
+          fmt::format("invalid component type of accessor {}", index)};
+  }
+
+  // Elements are tightly packed unless the buffer view has a stride
+  const auto elementSize{accessor.components * componentSize};
+  accessor.stride = elementSize;
+  if (json["bufferView"].isNull() || accessor.count == 0) return accessor;
+
+  const auto viewIndex{json["bufferView"].asIndex()};
+  const auto view{getBufferView(viewIndex)};
+  accessor.stride =
+      m_json["bufferViews"].at(viewIndex)["byteStride"].asIndex(elementSize);
+  const auto offset{json["byteOffset"].asIndex(0)};
+  const auto size{accessor.stride * (accessor.count - 1) + elementSize};
+  if (offset > view.size() || size > view.size() - offset) {
+    throw GLTFError{fmt::format("accessor {} out of bounds", index)};
+  }
+  accessor.data = view.subspan(offset, size);
+  return accessor;
+}
+
+[[nodiscard]] glm::mat4 getLocalTransform(const JsonValue &node) {
+  glm::mat4 transform{1.0f};
+  if (const auto &matrix{node["matrix"]}; matrix.size() == 16) {
+    for (const auto index : iter::range(std::size_t{16})) {
+      glm::value_ptr(transform)[static_cast<std::ptrdiff_t>(index)] =
+          static_cast<float>(matrix.at(index).asNumber());
+    }
+    return transform;
+  }
+
+  const auto readVec{[](const JsonValue &array, auto vector) {
+    for (const auto index : iter::range(vector.length())) {
+      vector[index] = static_cast<float>(
+          array.at(static_cast<std::size_t>(index)).asNumber(vector[index]));
+    }
+    return vector;
+  }};
+  const auto translation{readVec(node["translation"], glm::vec3{0.0f})};
+  const auto rotation{readVec(node["rotation"], glm::vec4{0, 0, 0, 1})};
+  const auto scale{readVec(node["scale"], glm::vec3{1.0f})};
+  return glm::translate(transform, translation) *
+         glm::mat4_cast(
+             glm::quat{rotation.w, rotation.x, rotation.y, rotation.z}) *
+         glm::scale(glm::mat4{1.0f}, scale);
+}
+
+// Mesh placed in the scene by a node
+struct MeshInstance {
+  std::size_t mesh{};
+  glm::mat4 transform{1.0f};
+};
+
+void collectInstances(const JsonValue &nodes, std::size_t nodeIndex,
+                      const glm::mat4 &parentTransform, std::size_t depth,
+                      std::vector<MeshInstance> &instances) {
+  const auto &node{nodes.at(nodeIndex)};
+  if (node.isNull() || depth > nodes.size()) {
+    throw GLTFError{"invalid node hierarchy"};
+  }
+
+  const auto transform{parentTransform * getLocalTransform(node)};
+  if (!node["mesh"].isNull()) {
+    instances.push_back(
+        {.mesh = node["mesh"].asIndex(), .transform = transform});
+  }
+  for (const auto &child : node["children"].array) {
+    collectInstances(nodes, child.asIndex(), transform, depth + 1, instances);
+  }
+}
+
+// Meshes of the default scene, or of all root nodes if there are no scenes
+[[nodiscard]] std::vector<MeshInstance> getMeshInstances(
+    const JsonValue &json) {
+  const auto &nodes{json["nodes"]};
+  std::vector<std::size_t> roots;
+  if (const auto &scenes{json["scenes"]}; scenes.size() > 0) {
+    const auto &scene{scenes.at(json["scene"].asIndex(0))};
+    for (const auto &node : scene["nodes"].array) {
+      roots.push_back(node.asIndex());
+    }
+  } else {
+    std::vector<bool> isChild(nodes.size());
+    for (const auto &node : nodes.array) {
+      for (const auto &child : node["children"].array) {
+        if (child.asIndex() < isChild.size()) isChild[child.asIndex()] = true;
+      }
+    }
+    for (const auto index : iter::range(nodes.size())) {
+      if (!isChild[index]) roots.push_back(index);
+    }
+  }
+
+  std::vector<MeshInstance> instances;
+  for (const auto root : roots) {
+    collectInstances(nodes, root, glm::mat4{1.0f}, 0, instances);
+  }
+  return instances;
+}
+
+// Triangles of a mesh primitive placed by a node
+struct Primitive {
+  std::size_t materialIndex{};
+  GLuint baseVertex{};
+  std::size_t indexCount{};
+  // Indices relative to the base vertex, or none for non-indexed primitives
+  std::optional<Accessor> indices{};
+  // Whether the node transform mirrors the primitive
+  bool mirrored{};
+
+  // Whether the indices can be copied to a 16-bit index buffer as they are
+  [[nodiscard]] bool isDirectlyUploadable() const {
+    return indices && indices->componentType == componentUnsignedShort &&
+           indices->stride == sizeof(GLushort) && !mirrored;
+  }
+};
+
+// Indices of the triangles of a primitive, relative to its base vertex and
+// with counterclockwise winding
+[[nodiscard]] std::vector<GLuint> readIndices(const Primitive &primitive) {
+  std::vector<GLuint> indices(primitive.indexCount);
+  for (const auto &&[offset, index] : iter::enumerate(indices)) {
+    index = primitive.indices ? readIndex(*primitive.indices, offset)
+                              : static_cast<GLuint>(offset);
+  }
+  if (primitive.mirrored) {
+    for (const auto offset : iter::range<std::size_t>(0, indices.size(), 3)) {
+      std::swap(indices[offset + 1], indices[offset + 2]);
+    }
+  }
+  return indices;
+}
+}  // namespace
+
+/**
+ * @brief Loads a model from a file, choosing the loader from the extension.
+ *
+ * Files with extension `.gltf` or `.glb` are loaded with loadGLTF(), and all
+ * other files with loadObj().
+ *
+ * @param path Path to the model file.
+ *
+ * @throw abcg::Exception if the file cannot be loaded.
+ */
+void abcg::Model::load(std::string_view path) {
+  auto extension{std::filesystem::path{path}.extension().string()};
+  std::ranges::transform(extension, extension.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  if (extension == ".gltf" || extension == ".glb") {
+    loadGLTF(path);
+  } else {
+    loadObj(path);
+  }
+}
+
+/**
+ * @brief Loads a model from a glTF 2.0 file.
+ *
+ * The meshes of the default scene are placed by their nodes and merged into a
+ * single model. Triangles are grouped by material into submeshes, as in
+ * loadObj(). Normals and tangents are computed when missing.
+ *
+ * Files are memory-mapped, or read from a mounted pack file, and accessors
+ * are read in place. When all primitives use 16-bit indices, which is the
+ * case of most exported assets, each primitive is drawn as a meshlet and its
+ * indices are uploaded straight from the buffer view to the index buffer.
+ * Otherwise, indices are converted as in loadObj(). Vertex attributes are
+ * always converted to the vertex format of the model. Levels of detail are
+ * not generated and the mesh is not reordered, since exported assets are
+ * expected to be already optimized.
+ *
+ * Metallic-roughness materials are approximated with Blinn-Phong materials:
+ * `Kd` is the base color, `Ks` is the reflectance at normal incidence and the
+ * shininess is derived from the roughness. Base color textures and normal
+ * textures are loaded once per image. Samplers, other textures, sparse
+ * accessors, skins, morph targets and primitives other than triangle lists
+ * are not supported.
+ *
+ * Must be called with an OpenGL context.
+ *
+ * @param path Path to the `.gltf` or `.glb` file. External buffers and images
+ * are searched relative to its directory.
+ *
+ * @throw abcg::Exception if the file cannot be loaded.
+ */
+void abcg::Model::loadGLTF(std::string_view path) {
+  destroy();
+
+  try {
+    GLTFDocument document{path};
+    const auto &json{document.json()};
+
+    for (const auto &extension : json["extensionsRequired"].array) {
+      // Quantized attributes are handled by the accessors
+      if (extension.string != "KHR_mesh_quantization") {
+        throw GLTFError{
+            fmt::format("required extension {} not supported",
+                        extension.string)};
+      }
+    }
+
+    // Images stored as files are cached by path, and embedded images by
+    // index
+    const auto basePath{std::filesystem::path{path}.parent_path().string() +
+                        "/"};
+    const auto loadImage{[&](const JsonValue &textureInfo) -> GLuint {
+      if (textureInfo.isNull()) return 0;
+      const auto &texture{json["textures"].at(textureInfo["index"].asIndex())};
+      if (texture["source"].isNull()) return 0;
+      const auto imageIndex{texture["source"].asIndex()};
+      const auto &image{json["images"].at(imageIndex)};
+      const auto &uri{image["uri"].string};
+      if (!uri.empty() && !uri.starts_with("data:")) {
+        return loadTexture(basePath + decodeURI(uri));
+      }
+      if (uri.empty() && image["bufferView"].isNull()) {
+        throw GLTFError{fmt::format("invalid image {}", imageIndex)};
+      }
+
+      const auto key{fmt::format("{}#{}", path, imageIndex)};
+      if (auto it{m_textures.find(key)}; it != m_textures.end()) {
+        return it->second;
+      }
+      const auto data{image["bufferView"].isNull()
+                          ? document.readURI(uri)
+                          : document.getBufferView(
+                                image["bufferView"].asIndex())};
+      const auto textureID{abcg::opengl::loadTextureFromMemory(data)};
+      m_textures.emplace(key, textureID);
+      return textureID;
+    }};
+
+    // Materials, plus a default one at the end for primitives without
+    // material
+    for (const auto &gltfMaterial : json["materials"].array) {
+      const auto &pbr{gltfMaterial["pbrMetallicRoughness"]};
+      glm::vec4 baseColor{1.0f};
+      for (const auto index : iter::range(4)) {
+        baseColor[index] = static_cast<float>(
+            pbr["baseColorFactor"].at(static_cast<std::size_t>(index))
+                .asNumber(1.0));
+      }
+      const auto metallic{
+          static_cast<float>(pbr["metallicFactor"].asNumber(1.0))};
+      const auto roughness{
+          static_cast<float>(pbr["roughnessFactor"].asNumber(1.0))};
+
+      // Blinn-Phong exponent with the same highlight width as the GGX
+      // distribution with alpha = roughness^2
+      const auto alpha{std::max(roughness * roughness, 0.001f)};
+      const glm::vec3 dielectricReflectance{0.04f};
+      Material material{
+          .name = gltfMaterial["name"].string,
+          .Kd = baseColor,
+          .Ks = {glm::mix(dielectricReflectance, glm::vec3{baseColor},
+                          metallic),
+                 1.0f},
+          .shininess =
+              std::clamp(2.0f / (alpha * alpha) - 2.0f, 1.0f, 1000.0f),
+          .diffuseTexture = loadImage(pbr["baseColorTexture"]),
+          .normalTexture = loadImage(gltfMaterial["normalTexture"])};
+      m_materials.push_back(material);
+    }
+    const auto defaultMaterial{m_materials.size()};
+    m_materials.push_back({.name = "default"});
+
+    std::vector<Primitive> primitives;
+    for (const auto &instance : getMeshInstances(json)) {
+      const glm::mat3 linearTransform{instance.transform};
+      const auto normalMatrix{glm::inverseTranspose(linearTransform)};
+      const auto mirrored{glm::determinant(linearTransform) < 0.0f};
+
+      const auto &mesh{json["meshes"].at(instance.mesh)};
+      for (const auto &gltfPrimitive : mesh["primitives"].array) {
+        if (gltfPrimitive["mode"].asIndex(modeTriangles) != modeTriangles) {
+          continue;
+        }
+
+        const auto &attributes{gltfPrimitive["attributes"]};
+        const auto position{
+            document.getAccessor(attributes["POSITION"].asIndex())};
+        const auto getAttribute{
+            [&](std::string_view name) -> std::optional<Accessor> {
+              if (attributes[name].isNull()) return std::nullopt;
+              auto accessor{document.getAccessor(attributes[name].asIndex())};
+              if (accessor.count != position.count) {
+                throw GLTFError{
+                    fmt::format("invalid number of elements of {}", name)};
+              }
+              return accessor;
+            }};
+        const auto normal{getAttribute("NORMAL")};
+        const auto texCoord{getAttribute("TEXCOORD_0")};
+        const auto tangent{getAttribute("TANGENT")};
+
+        Primitive primitive{
+            .materialIndex =
+                gltfPrimitive["material"].asIndex(defaultMaterial),
+            .baseVertex = static_cast<GLuint>(m_vertices.size()),
+            .indexCount = position.count,
+            .mirrored = mirrored};
+        if (primitive.materialIndex > defaultMaterial) {
+          throw GLTFError{"invalid material index"};
+        }
+        if (!gltfPrimitive["indices"].isNull()) {
+          primitive.indices =
+              document.getAccessor(gltfPrimitive["indices"].asIndex());
+          primitive.indexCount = primitive.indices->count;
+          if (const auto &indices{*primitive.indices};
+              indices.components != 1 || indices.data.empty() ||
+              (indices.componentType != componentUnsignedByte &&
+               indices.componentType != componentUnsignedShort &&
+               indices.componentType != componentUnsignedInt)) {
+            throw GLTFError{"invalid indices"};
+          }
+          for (const auto offset : iter::range(primitive.indexCount)) {
+            if (readIndex(*primitive.indices, offset) >= position.count) {
+              throw GLTFError{"index out of range"};
+            }
+          }
+        }
+        primitive.indexCount -= primitive.indexCount % 3;
+        if (primitive.indexCount == 0) continue;
+
+        m_vertices.resize(m_vertices.size() + position.count);
+        const auto vertices{
+            std::span{m_vertices}.subspan(primitive.baseVertex)};
+        for (const auto &&[index, vertex] : iter::enumerate(vertices)) {
+          vertex.position = glm::vec3{
+              instance.transform *
+              glm::vec4{readVector<3>(position, index), 1.0f}};
+          if (normal) {
+            vertex.normal =
+                glm::normalize(normalMatrix * readVector<3>(*normal, index));
+          }
+          // glTF puts the origin of texture coordinates at the top left
+          // corner, and abcg at the bottom left corner, as in OBJ files
+          if (texCoord) {
+            const auto uv{readVector<2>(*texCoord, index)};
+            vertex.texCoord = {uv.x, 1.0f - uv.y};
+          }
+          // The handedness is flipped along with the v coordinate, and again
+          // by mirroring transforms
+          if (tangent) {
+            const auto value{readVector<4>(*tangent, index)};
+            vertex.tangent = {
+                glm::normalize(linearTransform * glm::vec3{value}),
+                mirrored ? value.w : -value.w};
+          }
+        }
+
+        m_hasNormals = m_hasNormals || normal;
+        m_hasTexCoords = m_hasTexCoords || texCoord;
+        if (!normal || (texCoord && !tangent)) {
+          const auto indices{readIndices(primitive)};
+          if (!normal) {
+            computeNormals(vertices, indices, NormalWeighting::Angle);
+          }
+          if (texCoord && !tangent) computeTangents(vertices, indices);
+        }
+
+        primitives.push_back(std::move(primitive));
+      }
+    }
+
+    // Draw the primitives of each material together
+    std::ranges::stable_sort(primitives, {}, &Primitive::materialIndex);
+
+    const auto directUpload{
+        std::ranges::all_of(primitives, &Primitive::isDirectlyUploadable)};
+    std::size_t firstIndex{};
+    for (const auto &primitive : primitives) {
+      if (m_submeshes.empty() ||
+          m_submeshes.back().materialIndex != primitive.materialIndex) {
+        m_submeshes.push_back({.materialIndex = primitive.materialIndex,
+                               .lods = {{.firstIndex = firstIndex}}});
+      }
+      m_submeshes.back().lods.front().indexCount += primitive.indexCount;
+
+      if (directUpload) {
+        m_meshlets.push_back({.baseVertex = primitive.baseVertex,
+                              .firstIndex = firstIndex,
+                              .indexCount = primitive.indexCount});
+      } else {
+        for (const auto index : readIndices(primitive)) {
+          m_indices.push_back(primitive.baseVertex + index);
+        }
+      }
+      firstIndex += primitive.indexCount;
+    }
+
+    if (!directUpload) {
+      createBuffers();
+      return;
+    }
+
+    createVertexBuffer();
+
+    // Copy the index buffer views to the ranges of their meshlets
+    abcg::glGenBuffers(1, &m_EBO);
+    abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+    abcg::glBufferData(
+        GL_ELEMENT_ARRAY_BUFFER,
+        static_cast<GLsizeiptr>(firstIndex * sizeof(GLushort)), nullptr,
+        GL_STATIC_DRAW);
+    for (const auto &&[meshlet, primitive] :
+         iter::zip(m_meshlets, primitives)) {
+      abcg::glBufferSubData(
+          GL_ELEMENT_ARRAY_BUFFER,
+          static_cast<GLintptr>(meshlet.firstIndex * sizeof(GLushort)),
+          static_cast<GLsizeiptr>(meshlet.indexCount * sizeof(GLushort)),
+          primitive.indices->data.data());
+    }
+    abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  } catch (const GLTFError &error) {
+    destroy();
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to load model {} ({})", path, error.what()))};
+  } catch (...) {
+    destroy();
+    throw;
+  }
+}
@@ -0,0 +1,123 @@
+/**
+ * @file abcg_gputimer.cpp
+ * @brief Definition of abcg::GPUTimer members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_gputimer.hpp"
+
+#include <algorithm>
+#include <string_view>
+
+#include "abcg_openglfunctions.hpp"
+
+/**
+ * @brief Constructs a GPU timer.
+ *
+ * @param queryCount Number of measurements that can be pending at a time.
+ * Queries are created by the first measurements.
+ */
+abcg::GPUTimer::GPUTimer(std::size_t queryCount)
+    : m_queries(std::max(queryCount, std::size_t{1})) {}
+
+/**
+ * @brief Starts measuring the GPU time of the next commands.
+ *
+ * Does nothing if every query is pending or if timer queries are not
+ * supported.
+ */
+void abcg::GPUTimer::begin() {
+#if !defined(__EMSCRIPTEN__)
+  if (!m_supported.has_value()) m_supported = isSupported();
+  if (!*m_supported || m_active || m_pendingCount == m_queries.size()) return;
+
+  auto &query{
+      m_queries[(m_firstPending + m_pendingCount) % m_queries.size()]};
+  if (query == 0) abcg::glGenQueries(1, &query);
+  abcg::glBeginQuery(GL_TIME_ELAPSED, query);
+  m_active = true;
+#endif
+}
+
+/**
+ * @brief Ends the measurement started by begin().
+ *
+ */
+void abcg::GPUTimer::end() {
+#if !defined(__EMSCRIPTEN__)
+  if (!m_active) return;
+  abcg::glEndQuery(GL_TIME_ELAPSED);
+  m_active = false;
+  ++m_pendingCount;
+#endif
+}
+
+/**
+ * @brief Returns the latest finished measurement.
+ *
+ * Older finished measurements are discarded. Does not wait for the GPU.
+ *
+ * @return GPU time in seconds, or an empty optional if no measurement has
+ * finished since the last call.
+ */
+std::optional<double> abcg::GPUTimer::poll() {
+  std::optional<double> latest;
+#if !defined(__EMSCRIPTEN__)
+  while (m_pendingCount > 0) {
+    const auto query{m_queries[m_firstPending]};
+    GLuint available{};
+    abcg::glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == GL_FALSE) break;
+
+    GLuint64 elapsed{};
+    abcg::glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+    latest = static_cast<double>(elapsed) * 1.0e-9;
+    m_firstPending = (m_firstPending + 1) % m_queries.size();
+    --m_pendingCount;
+  }
+#endif
+  return latest;
+}
+
+/**
+ * @brief Deletes the queries and discards the pending measurements.
+ *
+ */
+void abcg::GPUTimer::destroy() {
+#if !defined(__EMSCRIPTEN__)
+  if (m_active) abcg::glEndQuery(GL_TIME_ELAPSED);
+#endif
+  for (auto &query : m_queries) {
+    if (query != 0) abcg::glDeleteQueries(1, &query);
+    query = 0;
+  }
+  m_firstPending = 0;
+  m_pendingCount = 0;
+  m_active = false;
+  m_supported.reset();
+}
+
+/**
+ * @brief Returns whether the current OpenGL context supports timer queries.
+ *
+ * Timer queries are core in OpenGL 3.3, and are not available in OpenGL ES
+ * and WebGL.
+ */
+bool abcg::GPUTimer::isSupported() {
+#if defined(__EMSCRIPTEN__)
+  return false;
+#else
+  const auto *version{
+      reinterpret_cast<const char *>(abcg::glGetString(GL_VERSION))};
+  if (version == nullptr || std::string_view{version}.starts_with("OpenGL ES"))
+    return false;
+
+  GLint majorVersion{};
+  GLint minorVersion{};
+  abcg::glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+  abcg::glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+  return majorVersion > 3 || (majorVersion == 3 && minorVersion >= 3) ||
+         SDL_GL_ExtensionSupported("GL_ARB_timer_query") == SDL_TRUE;
+#endif
+}
@@ -0,0 +1,64 @@
+/**
+ * @file abcg_gputimer.hpp
+ * @brief Declaration of abcg::GPUTimer.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_GPUTIMER_HPP_
+#define ABCG_GPUTIMER_HPP_
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+#include "abcg_external.hpp"
+
+namespace abcg {
+class GPUTimer;
+}  // namespace abcg
+
+/**
+ * @brief abcg::GPUTimer class.
+ *
+ * Measures the GPU time of the commands issued between begin() and end()
+ * with a ring of GL_TIME_ELAPSED queries. Results arrive a few frames
+ * later and are returned by poll() without waiting for the GPU. If every
+ * query is still pending, the measurement is skipped.
+ *
+ * Timer queries are not available in OpenGL ES and WebGL, where
+ * isSupported() returns false and nothing is measured.
+ *
+ * Only one GL_TIME_ELAPSED query can be active at a time, so measurements
+ * cannot be nested. All functions must be called with the OpenGL context
+ * of the timer current. OpenGL objects are deleted by destroy(), not by the
+ * destructor.
+ */
+class abcg::GPUTimer {
+ public:
+  explicit GPUTimer(std::size_t queryCount = 4);
+  ~GPUTimer() = default;
+
+  GPUTimer(const GPUTimer &) = delete;
+  GPUTimer(GPUTimer &&) = delete;
+  GPUTimer &operator=(const GPUTimer &) = delete;
+  GPUTimer &operator=(GPUTimer &&) = delete;
+
+  void begin();
+  void end();
+  [[nodiscard]] std::optional<double> poll();
+  void destroy();
+
+  [[nodiscard]] static bool isSupported();
+
+ private:
+  std::vector<GLuint> m_queries;
+  // Whether the context supports timer queries, checked by the first begin()
+  std::optional<bool> m_supported;
+  // Index of the oldest pending query and number of pending queries
+  std::size_t m_firstPending{};
+  std::size_t m_pendingCount{};
+  bool m_active{};
+};
+
+#endif
@@ -9,7 +9,11 @@
 
 #include <fmt/core.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cppitertools/itertools.hpp>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <gsl/gsl>
 #include <span>
@@ -18,6 +22,11 @@
 #include "SDL_image.h"
 #include "abcg_exception.hpp"
 #include "abcg_external.hpp"
+#include "abcg_pack.hpp"
+
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include <imstb_rectpack.h>
 
 void flipHorizontally(gsl::not_null<SDL_Surface*> surface) {
   auto width{static_cast<size_t>(surface->w * surface->format->BytesPerPixel)};
@@ -62,71 +71,200 @@ void flipVertically(gsl::not_null<SDL_Surface*> surface) {
   }
 }
 
-GLuint abcg::opengl::loadTexture(std::string_view path, bool generateMipmaps) {
-  GLuint textureID{};
+namespace {
+// Loads an image from a mounted pack file, or else from the file system
+SDL_Surface* loadSurface(std::string_view path) {
+  if (const auto asset{abcg::readPackedAsset(path)}) {
+    const auto data{asset->data()};
+    return IMG_Load_RW(
+        SDL_RWFromConstMem(data.data(), static_cast<int>(data.size())), 1);
+  }
 
-  // Copy file data into buffer
-  std::ifstream input(path.data(), std::ios::binary);
-  if (!input) {
+  if (std::ifstream input(path.data(), std::ios::binary); !input) {
     throw abcg::Exception{abcg::Exception::Runtime(
         fmt::format("Failed to open texture file {}", path))};
   }
-  std::vector<char> buffer((std::istreambuf_iterator<char>(input)),
-                           std::istreambuf_iterator<char>());
+  return IMG_Load(path.data());
+}
 
-  // Load the bitmap
-  if (SDL_Surface * surface{IMG_Load(path.data())}) {
-    // Enforce RGB/RGBA
-    GLenum format{0};
-    SDL_Surface* formattedSurface{nullptr};
-    if (surface->format->BytesPerPixel == 3) {
-      formattedSurface =
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0);
-      format = GL_RGB;
-    } else {
-      formattedSurface =
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
-      format = GL_RGBA;
-    }
-    SDL_FreeSurface(surface);
+// RGBA image with rows ordered from bottom to top, as expected by OpenGL
+struct Image {
+  int width{};
+  int height{};
+  std::vector<std::uint32_t> pixels{};
+};
+
+Image loadImage(std::string_view path) {
+  SDL_Surface* surface{loadSurface(path)};
+  if (surface == nullptr) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to load texture file {}", path))};
+  }
 
-    // Flip upside down
-    flipVertically(formattedSurface);
+  SDL_Surface* formattedSurface{
+      SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0)};
+  SDL_FreeSurface(surface);
+
+  // Flip upside down
+  flipVertically(formattedSurface);
+
+  Image image{.width = formattedSurface->w, .height = formattedSurface->h};
+  const auto width{static_cast<std::size_t>(image.width)};
+  image.pixels.resize(width * static_cast<std::size_t>(image.height));
+  for (const auto row : iter::range(image.height)) {
+    std::memcpy(&image.pixels.at(static_cast<std::size_t>(row) * width),
+                static_cast<std::byte*>(formattedSurface->pixels) +
+                    row * formattedSurface->pitch,
+                width * sizeof(std::uint32_t));
+  }
+  SDL_FreeSurface(formattedSurface);
 
-    // Generate the texture
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(format),
-                 formattedSurface->w, formattedSurface->h, 0, format,
-                 GL_UNSIGNED_BYTE, formattedSurface->pixels);
+  return image;
+}
 
-    SDL_FreeSurface(formattedSurface);
+// Bilinear resampling of an RGBA image
+Image resizeImage(const Image& image, int width, int height) {
+  if (image.width == width && image.height == height) return image;
+
+  Image result{.width = width, .height = height};
+  result.pixels.resize(static_cast<std::size_t>(width) *
+                       static_cast<std::size_t>(height));
+
+  const auto texel{[&](int x, int y, int channel) {
+    x = std::clamp(x, 0, image.width - 1);
+    y = std::clamp(y, 0, image.height - 1);
+    const auto pixel{
+        image.pixels[static_cast<std::size_t>(y * image.width + x)]};
+    return static_cast<float>((pixel >> (channel * 8)) & 0xFFU);
+  }};
+
+  for (const auto y : iter::range(height)) {
+    for (const auto x : iter::range(width)) {
+      // Position in the source image, at texel centers
+      const auto sx{(static_cast<float>(x) + 0.5f) *
+                        static_cast<float>(image.width) /
+                        static_cast<float>(width) -
+                    0.5f};
+      const auto sy{(static_cast<float>(y) + 0.5f) *
+                        static_cast<float>(image.height) /
+                        static_cast<float>(height) -
+                    0.5f};
+      const auto x0{static_cast<int>(std::floor(sx))};
+      const auto y0{static_cast<int>(std::floor(sy))};
+      const auto fx{sx - static_cast<float>(x0)};
+      const auto fy{sy - static_cast<float>(y0)};
+
+      std::uint32_t pixel{};
+      for (const auto channel : iter::range(4)) {
+        const auto top{texel(x0, y0, channel) * (1.0f - fx) +
+                       texel(x0 + 1, y0, channel) * fx};
+        const auto bottom{texel(x0, y0 + 1, channel) * (1.0f - fx) +
+                          texel(x0 + 1, y0 + 1, channel) * fx};
+        const auto value{top * (1.0f - fy) + bottom * fy + 0.5f};
+        pixel |= static_cast<std::uint32_t>(value) << (channel * 8);
+      }
+      result.pixels[static_cast<std::size_t>(y * width + x)] = pixel;
+    }
+  }
 
-    // Set texture filtering
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  return result;
+}
 
-    // Generate the mipmap levels
-    if (generateMipmaps) {
-      glGenerateMipmap(GL_TEXTURE_2D);
+void setTextureParameters(GLenum target, GLint wrap, bool generateMipmaps) {
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  if (generateMipmaps) {
+    glGenerateMipmap(target);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  }
+  glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+  glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+}
+}  // namespace
 
-      // Override minifying filtering
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
-                      GL_LINEAR_MIPMAP_LINEAR);
-    }
+namespace {
+// Creates a texture from an image, consuming the surface
+GLuint createTexture(SDL_Surface* surface, bool generateMipmaps) {
+  GLuint textureID{};
 
-    // Set texture wrapping
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  // Enforce RGB/RGBA
+  GLenum format{0};
+  SDL_Surface* formattedSurface{nullptr};
+  if (surface->format->BytesPerPixel == 3) {
+    formattedSurface =
+        SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0);
+    format = GL_RGB;
   } else {
-    throw abcg::Exception{abcg::Exception::Runtime(
-        fmt::format("Failed to load texture file {}", path))};
+    formattedSurface =
+        SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+    format = GL_RGBA;
+  }
+  SDL_FreeSurface(surface);
+
+  // Flip upside down
+  flipVertically(formattedSurface);
+
+  // Generate the texture
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(format),
+               formattedSurface->w, formattedSurface->h, 0, format,
+               GL_UNSIGNED_BYTE, formattedSurface->pixels);
+
+  SDL_FreeSurface(formattedSurface);
+
+  // Set texture filtering
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  // Generate the mipmap levels
+  if (generateMipmaps) {
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    // Override minifying filtering
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GL_LINEAR_MIPMAP_LINEAR);
   }
 
+  // Set texture wrapping
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
   glBindTexture(GL_TEXTURE_2D, 0);
 
   return textureID;
 }
+}  // namespace
+
+GLuint abcg::opengl::loadTexture(std::string_view path, bool generateMipmaps) {
+  // Load the bitmap
+  if (SDL_Surface * surface{loadSurface(path)}) {
+    return createTexture(surface, generateMipmaps);
+  }
+  throw abcg::Exception{abcg::Exception::Runtime(
+      fmt::format("Failed to load texture file {}", path))};
+}
+
+/**
+ * @brief Loads a texture from an image file stored in memory.
+ *
+ * @param data Contents of an image file in any format supported by SDL_image.
+ * @param generateMipmaps Whether to generate the mipmap levels.
+ *
+ * @return Texture name.
+ *
+ * @throw abcg::Exception if the image cannot be decoded.
+ */
+GLuint abcg::opengl::loadTextureFromMemory(std::span<const std::byte> data,
+                                           bool generateMipmaps) {
+  if (SDL_Surface * surface{IMG_Load_RW(
+          SDL_RWFromConstMem(data.data(), static_cast<int>(data.size())),
+          1)}) {
+    return createTexture(surface, generateMipmaps);
+  }
+  throw abcg::Exception{
+      abcg::Exception::Runtime("Failed to load texture from memory")};
+}
 
 GLuint abcg::opengl::loadCubemap(std::array<std::string_view, 6> paths,
                                  bool generateMipmaps, bool rightHandedSystem) {
@@ -135,17 +273,8 @@ GLuint abcg::opengl::loadCubemap(std::array<std::string_view, 6> paths,
   glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
   for (auto&& [index, path] : iter::enumerate(paths)) {
-    // Copy file data into buffer
-    std::ifstream input(path.data(), std::ios::binary);
-    if (!input) {
-      throw abcg::Exception{abcg::Exception::Runtime(
-          fmt::format("Failed to open texture file {}", path))};
-    }
-    std::vector<char> buffer((std::istreambuf_iterator<char>(input)),
-                             std::istreambuf_iterator<char>());
-
     // Load the bitmap
-    if (SDL_Surface * surface{IMG_Load(path.data())}) {
+    if (SDL_Surface * surface{loadSurface(path)}) {
       // Enforce RGB
       SDL_Surface* formattedSurface{
           SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0)};
@@ -201,3 +330,148 @@ GLuint abcg::opengl::loadCubemap(std::array<std::string_view, 6> paths,
 
   return textureID;
 }
+
+/**
+ * @brief Loads textures into the layers of a `GL_TEXTURE_2D_ARRAY`.
+ *
+ * All layers have the size of the first texture. Textures of other sizes are
+ * resampled with bilinear filtering.
+ *
+ * @param paths Paths of the textures. Layer i is the texture of `paths[i]`.
+ * @param generateMipmaps Whether to generate mipmap levels.
+ *
+ * @return Texture name of the array texture.
+ *
+ * @throw abcg::Exception if a texture cannot be loaded.
+ */
+GLuint abcg::opengl::loadTextureArray(std::span<const std::string_view> paths,
+                                      bool generateMipmaps) {
+  if (paths.empty()) return 0;
+
+  std::vector<Image> images;
+  images.reserve(paths.size());
+  for (const auto path : paths) {
+    auto image{loadImage(path)};
+    if (!images.empty()) {
+      image = resizeImage(image, images.front().width, images.front().height);
+    }
+    images.push_back(std::move(image));
+  }
+
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, images.front().width,
+               images.front().height, static_cast<GLsizei>(images.size()), 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  for (auto&& [layer, image] : iter::enumerate(images)) {
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(layer),
+                    image.width, image.height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                    image.pixels.data());
+  }
+  setTextureParameters(GL_TEXTURE_2D_ARRAY, GL_REPEAT, generateMipmaps);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  return textureID;
+}
+
+/**
+ * @brief Packs textures into a single texture atlas.
+ *
+ * Textures are packed with the skyline algorithm of stb_rect_pack into the
+ * smallest square power-of-two texture that fits them. The border texels of
+ * each texture are replicated into a gutter of `padding` texels to reduce
+ * bleeding between neighbors when filtering.
+ *
+ * Texture coordinates must be remapped with abcg::TextureAtlas::remap, and
+ * only texture coordinates in [0, 1] are supported (no repeat).
+ *
+ * @param paths Paths of the textures.
+ * @param maxSize Maximum width and height of the atlas.
+ * @param padding Width of the gutter around each texture, in texels.
+ * @param generateMipmaps Whether to generate mipmap levels.
+ *
+ * @return Atlas texture and regions of each texture.
+ *
+ * @throw abcg::Exception if a texture cannot be loaded or if the textures do
+ * not fit in an atlas of size `maxSize`.
+ */
+abcg::TextureAtlas abcg::opengl::loadTextureAtlas(
+    std::span<const std::string_view> paths, int maxSize, int padding,
+    bool generateMipmaps) {
+  TextureAtlas atlas;
+  if (paths.empty()) return atlas;
+
+  std::vector<Image> images;
+  images.reserve(paths.size());
+  std::vector<stbrp_rect> rects;
+  rects.reserve(paths.size());
+  std::size_t area{};
+  for (auto&& [index, path] : iter::enumerate(paths)) {
+    images.push_back(loadImage(path));
+    const auto& image{images.back()};
+    stbrp_rect rect{};
+    rect.id = static_cast<int>(index);
+    rect.w = static_cast<stbrp_coord>(image.width + 2 * padding);
+    rect.h = static_cast<stbrp_coord>(image.height + 2 * padding);
+    rects.push_back(rect);
+    area += static_cast<std::size_t>(rects.back().w) *
+            static_cast<std::size_t>(rects.back().h);
+  }
+
+  // Smallest power of two that may hold all rectangles
+  auto size{1};
+  while (static_cast<std::size_t>(size) * static_cast<std::size_t>(size) <
+         area) {
+    size *= 2;
+  }
+  for (;; size *= 2) {
+    if (size > maxSize) {
+      throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+          "Textures do not fit in a {}x{} atlas", maxSize, maxSize))};
+    }
+    std::vector<stbrp_node> nodes(static_cast<std::size_t>(size));
+    stbrp_context context{};
+    stbrp_init_target(&context, size, size, nodes.data(), size);
+    if (stbrp_pack_rects(&context, rects.data(),
+                         static_cast<int>(rects.size())) != 0) {
+      break;
+    }
+  }
+
+  // Copy each image into its region, replicating border texels into the
+  // gutter
+  std::vector<std::uint32_t> pixels(static_cast<std::size_t>(size) *
+                                    static_cast<std::size_t>(size));
+  atlas.width = size;
+  atlas.height = size;
+  atlas.regions.resize(images.size());
+  for (const auto& rect : rects) {
+    const auto& image{images.at(static_cast<std::size_t>(rect.id))};
+    for (const auto y : iter::range(rect.h)) {
+      const auto sourceY{std::clamp(y - padding, 0, image.height - 1)};
+      for (const auto x : iter::range(rect.w)) {
+        const auto sourceX{std::clamp(x - padding, 0, image.width - 1)};
+        pixels[static_cast<std::size_t>((rect.y + y) * size + rect.x + x)] =
+            image.pixels[static_cast<std::size_t>(sourceY * image.width +
+                                                  sourceX)];
+      }
+    }
+
+    const auto atlasSize{static_cast<float>(size)};
+    atlas.regions.at(static_cast<std::size_t>(rect.id)) = {
+        .offset = {static_cast<float>(rect.x + padding) / atlasSize,
+                   static_cast<float>(rect.y + padding) / atlasSize},
+        .scale = {static_cast<float>(image.width) / atlasSize,
+                  static_cast<float>(image.height) / atlasSize}};
+  }
+
+  glGenTextures(1, &atlas.texture);
+  glBindTexture(GL_TEXTURE_2D, atlas.texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, pixels.data());
+  setTextureParameters(GL_TEXTURE_2D, GL_CLAMP_TO_EDGE, generateMipmaps);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  return atlas;
+}
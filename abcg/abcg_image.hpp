@@ -2,6 +2,10 @@
  * @file abcg_image.hpp
  * @brief Declaration of texture loading helper functions.
  *
+ * Besides single textures and cube maps, small textures can be combined into
+ * a texture array or a texture atlas, so that several materials can be drawn
+ * without changing the bound texture.
+ *
  * This project is released under the MIT License.
  */
 
@@ -10,14 +14,59 @@
 
 #include <abcg_external.hpp>
 #include <array>
+#include <cstddef>
+#include <glm/vec2.hpp>
+#include <span>
 #include <string_view>
+#include <vector>
+
+namespace abcg {
+struct TextureAtlas;
+struct TextureAtlasRegion;
+}  // namespace abcg
 
 namespace abcg::opengl {
 [[nodiscard]] GLuint loadTexture(std::string_view path,
                                  bool generateMipmaps = true);
+[[nodiscard]] GLuint loadTextureFromMemory(std::span<const std::byte> data,
+                                           bool generateMipmaps = true);
 [[nodiscard]] GLuint loadCubemap(std::array<std::string_view, 6> paths,
                                  bool generateMipmaps = true,
                                  bool rightHandedSystem = true);
+[[nodiscard]] GLuint loadTextureArray(std::span<const std::string_view> paths,
+                                      bool generateMipmaps = true);
+[[nodiscard]] TextureAtlas loadTextureAtlas(
+    std::span<const std::string_view> paths, int maxSize = 4096,
+    int padding = 4, bool generateMipmaps = true);
 }  // namespace abcg::opengl
 
+/**
+ * @brief Region of a texture atlas occupied by one of the packed textures.
+ *
+ * Texture coordinates (u, v) in [0, 1] of the original texture map to
+ * `offset + (u, v) * scale` in the atlas.
+ */
+struct abcg::TextureAtlasRegion {
+  glm::vec2 offset{};
+  glm::vec2 scale{1.0f};
+};
+
+/**
+ * @brief Texture atlas created by abcg::opengl::loadTextureAtlas.
+ *
+ * `regions` are in the same order as the paths of the packed textures.
+ */
+struct abcg::TextureAtlas {
+  GLuint texture{};
+  int width{};
+  int height{};
+  std::vector<TextureAtlasRegion> regions{};
+
+  [[nodiscard]] glm::vec2 remap(std::size_t region,
+                                const glm::vec2 &texCoord) const {
+    const auto &r{regions.at(region)};
+    return r.offset + texCoord * r.scale;
+  }
+};
+
 #endif
\ No newline at end of file
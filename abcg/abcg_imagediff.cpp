@@ -0,0 +1,118 @@
+/**
+ * @file abcg_imagediff.cpp
+ * @brief Definition of image comparison functions.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_imagediff.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+#include <span>
+
+namespace {
+// Largest value of the squared YIQ difference below
+constexpr double maxYIQDifference{35215.0};
+
+// Color blended with a white background, so that transparent pixels compare
+// equal regardless of their color
+glm::dvec3 blendWithWhite(std::span<const std::uint8_t> pixel) {
+  const auto alpha{pixel[3] / 255.0};
+  const glm::dvec3 color{pixel[0], pixel[1], pixel[2]};
+  return 255.0 + (color - 255.0) * alpha;
+}
+
+// Perceptual color difference from 0 to 1, based on the weighted YIQ
+// difference of Kotsarenko and Ramos, "Measuring perceived color difference
+// using YIQ NTSC transmission color space in mobile applications" (2010)
+double getColorDifference(std::span<const std::uint8_t> expected,
+                          std::span<const std::uint8_t> actual) {
+  const auto difference{blendWithWhite(expected) - blendWithWhite(actual)};
+  const auto y{glm::dot(difference,
+                        glm::dvec3{0.29889531, 0.58662247, 0.11448223})};
+  const auto i{glm::dot(difference,
+                        glm::dvec3{0.59597799, -0.27417610, -0.32180189})};
+  const auto q{glm::dot(difference,
+                        glm::dvec3{0.21147017, -0.52261711, 0.31114694})};
+  const auto delta{0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q};
+  return std::sqrt(std::min(delta / maxYIQDifference, 1.0));
+}
+}  // namespace
+
+/**
+ * @brief Compares two images pixel by pixel.
+ *
+ * Pixels match if their perceptual color difference is at most
+ * ImageComparisonSettings::threshold. Images of different sizes never
+ * match.
+ *
+ * @param expected Reference image, e.g. a golden image of a test.
+ * @param actual Image to compare with the reference.
+ * @param settings Comparison settings.
+ *
+ * @return Comparison result.
+ */
+abcg::ImageComparison abcg::compareImages(
+    const Image &expected, const Image &actual,
+    const ImageComparisonSettings &settings) {
+  ImageComparison result;
+  if (expected.width != actual.width || expected.height != actual.height) {
+    result.differentPixels =
+        std::max(expected.pixels.size(), actual.pixels.size()) / 4;
+    result.maxDifference = 1.0;
+    result.meanDifference = 1.0;
+    return result;
+  }
+
+  const auto pixelCount{expected.pixels.size() / 4};
+  if (settings.createDiffImage) {
+    result.diffImage = {.width = expected.width, .height = expected.height};
+    result.diffImage.pixels.resize(expected.pixels.size());
+  }
+
+  const std::span expectedPixels{expected.pixels};
+  const std::span actualPixels{actual.pixels};
+  auto sum{0.0};
+  for (const auto index : iter::range(pixelCount)) {
+    const auto offset{index * 4};
+    const auto difference{getColorDifference(
+        expectedPixels.subspan(offset, 4), actualPixels.subspan(offset, 4))};
+    const auto differs{difference > settings.threshold};
+    if (differs) ++result.differentPixels;
+    result.maxDifference = std::max(result.maxDifference, difference);
+    sum += difference;
+
+    if (settings.createDiffImage) {
+      auto diffPixel{std::span{result.diffImage.pixels}.subspan(offset, 4)};
+      if (differs) {
+        diffPixel[0] = 255;
+        diffPixel[1] = 0;
+        diffPixel[2] = 0;
+      } else {
+        // Faded luminance of the expected image
+        const auto color{blendWithWhite(expectedPixels.subspan(offset, 4))};
+        const auto luminance{glm::dot(
+            color, glm::dvec3{0.29889531, 0.58662247, 0.11448223})};
+        const auto gray{
+            static_cast<std::uint8_t>(255.0 - (255.0 - luminance) * 0.1)};
+        diffPixel[0] = gray;
+        diffPixel[1] = gray;
+        diffPixel[2] = gray;
+      }
+      diffPixel[3] = 255;
+    }
+  }
+
+  if (pixelCount > 0) {
+    result.meanDifference = sum / static_cast<double>(pixelCount);
+  }
+  const auto maxDifferentPixels{settings.maxDifferentPixels *
+                                 static_cast<double>(pixelCount)};
+  result.matches =
+      static_cast<double>(result.differentPixels) <= maxDifferentPixels;
+  return result;
+}
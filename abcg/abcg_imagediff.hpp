@@ -0,0 +1,56 @@
+/**
+ * @file abcg_imagediff.hpp
+ * @brief Declaration of image comparison functions.
+ *
+ * Images are compared pixel by pixel with a perceptual color difference, so
+ * that small changes of rounding or blending between builds and drivers can
+ * be told apart from actual rendering errors.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_IMAGEDIFF_HPP_
+#define ABCG_IMAGEDIFF_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "abcg_readback.hpp"
+
+namespace abcg {
+struct ImageComparison;
+struct ImageComparisonSettings;
+
+[[nodiscard]] ImageComparison compareImages(
+    const Image &expected, const Image &actual,
+    const ImageComparisonSettings &settings);
+}  // namespace abcg
+
+/**
+ * @brief Settings of abcg::compareImages.
+ *
+ */
+struct abcg::ImageComparisonSettings {
+  // Largest color difference of matching pixels, from 0 to 1
+  double threshold{0.1};
+  // Largest fraction of pixels that can differ for the images to match
+  double maxDifferentPixels{0.0};
+  bool createDiffImage{false};
+};
+
+/**
+ * @brief Result of abcg::compareImages.
+ *
+ * The diff image, if requested, shows the expected image faded to gray with
+ * the differing pixels in red.
+ */
+struct abcg::ImageComparison {
+  bool matches{};
+  std::size_t differentPixels{};
+  // Color differences, from 0 to 1
+  double maxDifference{};
+  double meanDifference{};
+  Image diffImage{};
+};
+
+#endif
@@ -0,0 +1,220 @@
+/**
+ * @file abcg_input.cpp
+ * @brief Definition of abcg::Input class members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_input.hpp"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+/**
+ * @brief Takes the mouse motion events received since the start of the
+ * frame.
+ *
+ * Call this function right before consuming the mouse motion, e.g. in
+ * paintGL before building the view matrix. Other events, including the mouse
+ * motion events of other windows, stay in the SDL queue until the next
+ * frame. Sampled events are passed to abcg::OpenGLWindow::handleEvent in the
+ * next frame.
+ *
+ * Must be called from the main thread.
+ */
+void abcg::Input::sample() {
+  if (m_replaying) {
+    for (const auto &event : m_sampled) push(event);
+    m_sampled.clear();
+    return;
+  }
+
+  SDL_PumpEvents();
+
+  std::array<SDL_Event, 64> events{};
+  std::vector<SDL_Event> otherWindows;
+  while (true) {
+    const auto count{SDL_PeepEvents(events.data(),
+                                    static_cast<int>(events.size()),
+                                    SDL_GETEVENT, SDL_MOUSEMOTION,
+                                    SDL_MOUSEMOTION)};
+    if (count <= 0) break;
+
+    for (const auto &event :
+         std::span{events}.first(static_cast<std::size_t>(count))) {
+      if (event.motion.windowID == m_windowID) {
+        push(event);
+        if (m_recording) m_sampled.push_back(event);
+      } else {
+        otherWindows.push_back(event);
+      }
+    }
+    if (static_cast<std::size_t>(count) < events.size()) break;
+  }
+
+  // Put back the events of other windows. Unlike SDL_PushEvent,
+  // SDL_PeepEvents keeps their timestamps, which restore their order
+  if (!otherWindows.empty()) {
+    SDL_PeepEvents(otherWindows.data(), static_cast<int>(otherWindows.size()),
+                   SDL_ADDEVENT, 0, 0);
+  }
+}
+
+/**
+ * @brief Returns the relative mouse motion accumulated since the last call.
+ *
+ * @return Motion in pixels.
+ */
+glm::vec2 abcg::Input::consumeMouseMotion() {
+  return std::exchange(m_mouseMotion, glm::vec2{});
+}
+
+/**
+ * @brief Returns the state of the keys.
+ *
+ * @return Array indexed by SDL_Scancode, with nonzero values for pressed
+ * keys.
+ */
+std::span<const Uint8> abcg::Input::getKeyboardState() const {
+  if (m_replaying) return m_keyState;
+
+  int numKeys{};
+  const auto *state{SDL_GetKeyboardState(&numKeys)};
+  return {state, static_cast<std::size_t>(numKeys)};
+}
+
+/**
+ * @brief Returns whether a key is pressed.
+ *
+ * @param scancode Scancode of the key.
+ *
+ * @return True if the key is pressed.
+ */
+bool abcg::Input::isKeyDown(SDL_Scancode scancode) const {
+  const auto state{getKeyboardState()};
+  const auto index{static_cast<std::size_t>(scancode)};
+  return index < state.size() && state[index] != 0;
+}
+
+/**
+ * @brief Returns the state of the mouse buttons.
+ *
+ * @return Bitmask of SDL_BUTTON(button) values of the pressed buttons.
+ */
+Uint32 abcg::Input::getMouseButtons() const {
+  if (m_replaying) return m_mouseButtons;
+  return SDL_GetMouseState(nullptr, nullptr);
+}
+
+/**
+ * @brief Returns whether a mouse button is pressed.
+ *
+ * @param button Button index, such as SDL_BUTTON_LEFT.
+ *
+ * @return True if the button is pressed.
+ */
+bool abcg::Input::isMouseButtonDown(int button) const {
+  return (getMouseButtons() & SDL_BUTTON(button)) != 0;
+}
+
+/**
+ * @brief Returns the position of the mouse in the window.
+ *
+ * @return Position in pixels.
+ */
+glm::ivec2 abcg::Input::getMousePosition() const {
+  if (m_replaying) return m_mousePosition;
+
+  glm::ivec2 position{};
+  SDL_GetMouseState(&position.x, &position.y);
+  return position;
+}
+
+/**
+ * @brief Sets a function called after each frame with its input latency.
+ *
+ * @param callback Function called with the latency in seconds, or an empty
+ * function. Frames without events are not reported.
+ */
+void abcg::Input::setLatencyCallback(LatencyCallback callback) {
+  m_latencyCallback = std::move(callback);
+}
+
+// Adds an event to be passed to the window
+void abcg::Input::push(const SDL_Event &event) {
+  record(event);
+  m_pending.push_back(event);
+}
+
+// Returns the events to be passed to the window, ordered by time
+std::span<SDL_Event> abcg::Input::takeEvents() {
+  std::stable_sort(m_pending.begin(), m_pending.end(),
+                   [](const SDL_Event &lhs, const SDL_Event &rhs) {
+                     return lhs.common.timestamp < rhs.common.timestamp;
+                   });
+
+  m_dispatched.clear();
+  std::swap(m_dispatched, m_pending);
+  return m_dispatched;
+}
+
+void abcg::Input::record(const SDL_Event &event) {
+  if (!isInputEvent(event)) return;
+
+  m_frameEvents.push_back(
+      {.event = event, .time = event.common.timestamp / 1000.0});
+
+  if (event.type == SDL_MOUSEMOTION) {
+    m_mouseMotion += glm::vec2{event.motion.xrel, event.motion.yrel};
+  }
+
+  if (m_replaying) {
+    switch (event.type) {
+      case SDL_KEYDOWN:
+      case SDL_KEYUP: {
+        const auto index{static_cast<std::size_t>(event.key.keysym.scancode)};
+        if (m_keyState.empty()) m_keyState.resize(SDL_NUM_SCANCODES);
+        if (index < m_keyState.size()) {
+          m_keyState[index] = event.type == SDL_KEYDOWN ? 1 : 0;
+        }
+      } break;
+      case SDL_MOUSEMOTION:
+        m_mousePosition = {event.motion.x, event.motion.y};
+        break;
+      case SDL_MOUSEBUTTONDOWN:
+        m_mouseButtons |= SDL_BUTTON(event.button.button);
+        m_mousePosition = {event.button.x, event.button.y};
+        break;
+      case SDL_MOUSEBUTTONUP:
+        m_mouseButtons &= ~SDL_BUTTON(event.button.button);
+        m_mousePosition = {event.button.x, event.button.y};
+        break;
+    }
+  }
+}
+
+// Reports the latency of the frame that was just presented
+void abcg::Input::endFrame() {
+  if (m_frameEvents.empty()) return;
+
+  const auto oldest{std::min_element(
+      m_frameEvents.begin(), m_frameEvents.end(),
+      [](const auto &lhs, const auto &rhs) { return lhs.time < rhs.time; })};
+  m_latency = SDL_GetTicks() / 1000.0 - oldest->time;
+  m_frameEvents.clear();
+
+  if (m_latencyCallback) m_latencyCallback(m_latency);
+}
+
+/**
+ * @brief Returns whether an event comes from an input device.
+ *
+ * @param event SDL event.
+ *
+ * @return True for keyboard, mouse, joystick, game controller, touch and
+ * gesture events.
+ */
+bool abcg::isInputEvent(const SDL_Event &event) {
+  return event.type >= SDL_KEYDOWN && event.type < SDL_CLIPBOARDUPDATE;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file abcg_input.hpp
+ * @brief Declaration of abcg::Input, the input state of a window.
+ *
+ * Events are timestamped and kept in a queue ordered by time. Mouse motion
+ * can be sampled in the middle of a frame, so that the view is built from
+ * the latest motion instead of the motion of the previous frame.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_INPUT_HPP_
+#define ABCG_INPUT_HPP_
+
+#include <functional>
+#include <glm/vec2.hpp>
+#include <span>
+#include <vector>
+
+#include "abcg_external.hpp"
+
+namespace abcg {
+class Application;
+class Input;
+class OpenGLWindow;
+struct InputEvent;
+
+[[nodiscard]] bool isInputEvent(const SDL_Event &event);
+}  // namespace abcg
+
+/**
+ * @brief Input event received by a window and its time.
+ *
+ */
+struct abcg::InputEvent {
+  SDL_Event event{};
+  // Time of the event in seconds, on the clock of SDL_GetTicks
+  double time{};
+};
+
+/**
+ * @brief abcg::Input class.
+ *
+ * Each abcg::OpenGLWindow has an input object returned by
+ * abcg::OpenGLWindow::getInput. Events are still passed to
+ * abcg::OpenGLWindow::handleEvent, once each, in the order they were
+ * received.
+ *
+ * Relative mouse motion is accumulated from all mouse motion events until it
+ * is consumed. Calling sample() right before consuming it takes the motion
+ * events that arrived during the frame, which would otherwise wait for the
+ * next frame.
+ *
+ * The input latency of a frame is the time from its oldest event to the end
+ * of its buffer swap.
+ *
+ * While a recording is played back (see abcg::Application::replay), the key
+ * and mouse states are those of the recorded events instead of the state of
+ * the devices. isReplaying() is already true in
+ * abcg::OpenGLWindow::initializeGL, so that applications can seed their
+ * random number generators with a fixed value.
+ */
+class abcg::Input {
+ public:
+  using LatencyCallback = std::function<void(double latency)>;
+
+  void sample();
+  [[nodiscard]] glm::vec2 consumeMouseMotion();
+
+  [[nodiscard]] std::span<const InputEvent> getFrameEvents() const {
+    return m_frameEvents;
+  }
+  [[nodiscard]] std::span<const Uint8> getKeyboardState() const;
+  [[nodiscard]] bool isKeyDown(SDL_Scancode scancode) const;
+  [[nodiscard]] Uint32 getMouseButtons() const;
+  [[nodiscard]] bool isMouseButtonDown(int button) const;
+  [[nodiscard]] glm::ivec2 getMousePosition() const;
+
+  [[nodiscard]] double getLatency() const { return m_latency; }
+  [[nodiscard]] bool isReplaying() const { return m_replaying; }
+  void setLatencyCallback(LatencyCallback callback);
+
+ private:
+  friend Application;
+  friend OpenGLWindow;
+
+  Uint32 m_windowID{};
+
+  // Mouse motion events sampled during the frame, kept for the recorder or
+  // taken from the player
+  bool m_recording{};
+  bool m_replaying{};
+  std::vector<SDL_Event> m_sampled;
+
+  // Device state while replaying
+  std::vector<Uint8> m_keyState;
+  Uint32 m_mouseButtons{};
+  glm::ivec2 m_mousePosition{};
+
+  // Events not yet passed to the window, including the sampled ones
+  std::vector<SDL_Event> m_pending;
+  // Events being passed to the window
+  std::vector<SDL_Event> m_dispatched;
+  // Input events received since the last frame
+  std::vector<InputEvent> m_frameEvents;
+
+  glm::vec2 m_mouseMotion{};
+  double m_latency{};
+  LatencyCallback m_latencyCallback;
+
+  void push(const SDL_Event &event);
+  [[nodiscard]] std::span<SDL_Event> takeEvents();
+  void record(const SDL_Event &event);
+  void endFrame();
+};
+
+#endif
@@ -0,0 +1,223 @@
+/**
+ * @file abcg_jobsystem.cpp
+ * @brief Definition of the job system.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_jobsystem.hpp"
+
+#include <cppitertools/itertools.hpp>
+
+namespace {
+// Job system of the worker thread, and index of its queue
+thread_local const abcg::JobSystem *currentSystem{};
+thread_local std::size_t currentQueue{};
+}  // namespace
+
+/**
+ * @brief Returns the job system shared by abcg and the applications.
+ *
+ * The job system is created on first use with the default number of workers.
+ *
+ * @return Shared job system.
+ */
+abcg::JobSystem &abcg::getJobSystem() {
+  static JobSystem jobSystem;
+  return jobSystem;
+}
+
+/**
+ * @brief Returns the default number of workers.
+ *
+ * @return One less than the number of hardware threads, since the main thread
+ * also runs jobs while waiting for them, or zero on Emscripten.
+ */
+std::size_t abcg::JobSystem::getDefaultNumWorkers() {
+#if defined(__EMSCRIPTEN__)
+  return 0;
+#else
+  const std::size_t hardwareThreads{std::thread::hardware_concurrency()};
+  return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+#endif
+}
+
+/**
+ * @brief Constructs a job system and starts its worker threads.
+ *
+ * @param numWorkers Number of worker threads. If zero, jobs run inline when
+ * submitted.
+ */
+abcg::JobSystem::JobSystem(std::size_t numWorkers) {
+#if defined(__EMSCRIPTEN__)
+  numWorkers = 0;
+#endif
+  for ([[maybe_unused]] const auto index : iter::range(numWorkers + 1)) {
+    m_queues.push_back(std::make_unique<Queue>());
+  }
+  m_threads.reserve(numWorkers);
+  for (const auto index : iter::range(numWorkers)) {
+    m_threads.emplace_back([this, index] { workerLoop(index); });
+  }
+}
+
+/**
+ * @brief Runs the remaining jobs and stops the worker threads.
+ *
+ */
+abcg::JobSystem::~JobSystem() {
+  {
+    const std::scoped_lock lock{m_sleepMutex};
+    m_stop = true;
+  }
+  m_wakeUp.notify_all();
+  for (auto &thread : m_threads) thread.join();
+}
+
+/**
+ * @brief Submits a job.
+ *
+ * @param job Function to run. Exceptions thrown by the job are rethrown by
+ * wait().
+ * @param counter Counter of the group of the job.
+ */
+void abcg::JobSystem::run(Job job, JobCounter &counter) {
+  counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+  submit({.job = std::move(job), .counter = &counter});
+}
+
+/**
+ * @brief Submits a job that runs after the jobs of another group.
+ *
+ * @param job Function to run. Exceptions thrown by the job are rethrown by
+ * wait().
+ * @param counter Counter of the group of the job.
+ * @param dependency Counter of the jobs that must finish before the job
+ * starts.
+ */
+void abcg::JobSystem::run(Job job, JobCounter &counter,
+                          JobCounter &dependency) {
+  counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+  {
+    const std::scoped_lock lock{dependency.m_mutex};
+    if (!dependency.isDone()) {
+      dependency.m_dependents.emplace_back(std::move(job), &counter);
+      return;
+    }
+  }
+  submit({.job = std::move(job), .counter = &counter});
+}
+
+/**
+ * @brief Waits until all jobs of a group are done.
+ *
+ * The calling thread runs queued jobs while it waits.
+ *
+ * @param counter Counter of the group.
+ *
+ * @throw Rethrows the first exception thrown by a job of the group.
+ */
+void abcg::JobSystem::wait(JobCounter &counter) {
+  while (!counter.isDone()) {
+    if (!runQueuedTask()) std::this_thread::yield();
+  }
+
+  // The thread that finished the last job may still hold the mutex
+  std::exception_ptr exception;
+  {
+    const std::scoped_lock lock{counter.m_mutex};
+    std::swap(exception, counter.m_exception);
+  }
+  if (exception) std::rethrow_exception(exception);
+}
+
+void abcg::JobSystem::workerLoop(std::size_t queueIndex) {
+  currentSystem = this;
+  currentQueue = queueIndex;
+
+  while (true) {
+    if (runQueuedTask()) continue;
+
+    std::unique_lock lock{m_sleepMutex};
+    m_wakeUp.wait(lock, [this] { return m_stop || m_queuedTasks > 0; });
+    if (m_stop && m_queuedTasks == 0) return;
+  }
+}
+
+void abcg::JobSystem::submit(Task task) {
+  if (m_threads.empty()) {
+    execute(task);
+    return;
+  }
+
+  m_queuedTasks.fetch_add(1);
+  {
+    auto &queue{*m_queues.at(getQueueIndex())};
+    const std::scoped_lock lock{queue.mutex};
+    queue.tasks.push_back(std::move(task));
+  }
+  // Pairs with the check of the predicate by sleeping workers
+  { const std::scoped_lock lock{m_sleepMutex}; }
+  m_wakeUp.notify_one();
+}
+
+// Runs a job of the queue of the current thread, or else steals one from the
+// front of another queue. Returns false if all queues are empty.
+bool abcg::JobSystem::runQueuedTask() {
+  if (m_queuedTasks == 0) return false;
+
+  const auto ownIndex{getQueueIndex()};
+  for (const auto offset : iter::range(m_queues.size())) {
+    const auto index{(ownIndex + offset) % m_queues.size()};
+    auto &queue{*m_queues.at(index)};
+
+    Task task;
+    {
+      const std::scoped_lock lock{queue.mutex};
+      if (queue.tasks.empty()) continue;
+      if (offset == 0) {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+      } else {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+      }
+    }
+    m_queuedTasks.fetch_sub(1);
+    execute(task);
+    return true;
+  }
+  return false;
+}
+
+void abcg::JobSystem::execute(Task &task) {
+  try {
+    task.job();
+  } catch (...) {
+    const std::scoped_lock lock{task.counter->m_mutex};
+    if (!task.counter->m_exception) {
+      task.counter->m_exception = std::current_exception();
+    }
+  }
+  finish(*task.counter);
+}
+
+// Decrements a counter and submits its dependents when it reaches zero
+void abcg::JobSystem::finish(JobCounter &counter) {
+  std::vector<std::pair<Job, JobCounter *>> dependents;
+  {
+    const std::scoped_lock lock{counter.m_mutex};
+    if (counter.m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      std::swap(dependents, counter.m_dependents);
+    }
+  }
+  for (auto &[job, dependentCounter] : dependents) {
+    submit({.job = std::move(job), .counter = dependentCounter});
+  }
+}
+
+// Queue of the current thread: its own queue on workers of this job system,
+// or the shared queue on other threads
+std::size_t abcg::JobSystem::getQueueIndex() const {
+  return currentSystem == this ? currentQueue : m_queues.size() - 1;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file abcg_jobsystem.hpp
+ * @brief Declaration of the job system.
+ *
+ * A pool of worker threads that run small jobs. Each worker has its own
+ * queue, and idle workers steal jobs from the queues of the others. Jobs are
+ * grouped by counters that can be waited on or used as dependencies of other
+ * jobs.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_JOBSYSTEM_HPP_
+#define ABCG_JOBSYSTEM_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace abcg {
+class JobCounter;
+class JobSystem;
+
+using Job = std::function<void()>;
+
+[[nodiscard]] JobSystem &getJobSystem();
+}  // namespace abcg
+
+/**
+ * @brief Number of unfinished jobs of a group.
+ *
+ * A counter must outlive its jobs. Call abcg::JobSystem::wait before
+ * destroying a counter that has pending jobs.
+ */
+class abcg::JobCounter {
+ public:
+  JobCounter() = default;
+
+  JobCounter(const JobCounter &) = delete;
+  JobCounter(JobCounter &&) = delete;
+  JobCounter &operator=(const JobCounter &) = delete;
+  JobCounter &operator=(JobCounter &&) = delete;
+
+  [[nodiscard]] bool isDone() const {
+    return m_pending.load(std::memory_order_acquire) == 0;
+  }
+
+ private:
+  friend class JobSystem;
+
+  std::atomic<std::size_t> m_pending{};
+  std::mutex m_mutex;
+  // Jobs that run when the counter reaches zero, and their counters
+  std::vector<std::pair<Job, JobCounter *>> m_dependents;
+  // First exception thrown by a job of the group
+  std::exception_ptr m_exception;
+};
+
+/**
+ * @brief abcg::JobSystem class.
+ *
+ * Jobs submitted by a worker go to the back of its own queue and are taken
+ * from there in LIFO order, which keeps recently touched data in cache. Jobs
+ * submitted by other threads go to a shared queue. Idle workers steal from
+ * the front of the other queues, and sleep when all queues are empty.
+ *
+ * Threads that wait on a counter run queued jobs while they wait, so waiting
+ * from inside a job does not deadlock.
+ *
+ * Without workers, as on Emscripten, jobs run inline when submitted.
+ */
+class abcg::JobSystem {
+ public:
+  explicit JobSystem(std::size_t numWorkers = getDefaultNumWorkers());
+  ~JobSystem();
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem(JobSystem &&) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+  JobSystem &operator=(JobSystem &&) = delete;
+
+  void run(Job job, JobCounter &counter);
+  void run(Job job, JobCounter &counter, JobCounter &dependency);
+  void wait(JobCounter &counter);
+
+  template <typename Function>
+  void parallelFor(std::size_t count, std::size_t minItemsPerJob,
+                   const Function &function);
+
+  [[nodiscard]] std::size_t getNumWorkers() const { return m_threads.size(); }
+  [[nodiscard]] static std::size_t getDefaultNumWorkers();
+
+ private:
+  struct Task {
+    Job job;
+    JobCounter *counter{};
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  // One queue per worker, plus the shared queue at the end
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wakeUp;
+  std::atomic<std::size_t> m_queuedTasks{};
+  bool m_stop{false};
+
+  void workerLoop(std::size_t queueIndex);
+  void submit(Task task);
+  [[nodiscard]] bool runQueuedTask();
+  void execute(Task &task);
+  void finish(JobCounter &counter);
+  [[nodiscard]] std::size_t getQueueIndex() const;
+};
+
+/**
+ * @brief Calls a function for disjoint subranges of a range, in parallel.
+ *
+ * The calling thread handles the first subrange and returns when all
+ * subranges are done.
+ *
+ * @param count Number of items of the range [0, count).
+ * @param minItemsPerJob Minimum number of items of each subrange. Ranges with
+ * fewer than twice this number of items are handled inline.
+ * @param function Function called as `function(first, last)` for each
+ * subrange [first, last).
+ *
+ * @throw Rethrows the first exception thrown by `function`.
+ */
+template <typename Function>
+void abcg::JobSystem::parallelFor(std::size_t count, std::size_t minItemsPerJob,
+                                  const Function &function) {
+  // A few jobs per thread, so that faster threads can steal the remaining
+  // ones
+  constexpr std::size_t jobsPerThread{4};
+  const auto maxJobs{(getNumWorkers() + 1) * jobsPerThread};
+  const auto numJobs{std::clamp<std::size_t>(
+      count / std::max<std::size_t>(minItemsPerJob, 1), 1, maxJobs)};
+  if (getNumWorkers() == 0 || numJobs <= 1) {
+    function(std::size_t{}, count);
+    return;
+  }
+
+  const auto chunkSize{(count + numJobs - 1) / numJobs};
+  JobCounter counter;
+  for (std::size_t first{chunkSize}; first < count; first += chunkSize) {
+    const auto last{std::min(first + chunkSize, count)};
+    run([&function, first, last] { function(first, last); }, counter);
+  }
+  try {
+    function(std::size_t{}, chunkSize);
+  } catch (...) {
+    wait(counter);
+    throw;
+  }
+  wait(counter);
+}
+
+#endif
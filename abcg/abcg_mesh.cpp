@@ -0,0 +1,421 @@
+/**
+ * @file abcg_mesh.cpp
+ * @brief Definition of mesh processing helper functions.
+ *
+ * The simplifier is a greedy edge collapser driven by quadric error metrics
+ * (Garland and Heckbert, "Surface Simplification Using Quadric Error
+ * Metrics", SIGGRAPH 1997). Vertices are never moved: each collapse merges a
+ * vertex into one of its neighbors, so every level of detail can be drawn
+ * from the same vertex buffer.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_mesh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cppitertools/itertools.hpp>
+#include <glm/geometric.hpp>
+#include <numeric>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+// Symmetric 4x4 matrix stored as its upper triangle, plus the accumulated
+// weight used to turn the sum of squared distances into a mean
+struct Quadric {
+  std::array<double, 10> m{};
+  double weight{};
+
+  void addPlane(const glm::dvec3 &n, double d, double w) {
+    m[0] += w * n.x * n.x;
+    m[1] += w * n.x * n.y;
+    m[2] += w * n.x * n.z;
+    m[3] += w * n.x * d;
+    m[4] += w * n.y * n.y;
+    m[5] += w * n.y * n.z;
+    m[6] += w * n.y * d;
+    m[7] += w * n.z * n.z;
+    m[8] += w * n.z * d;
+    m[9] += w * d * d;
+    weight += w;
+  }
+
+  Quadric &operator+=(const Quadric &other) {
+    for (auto i : iter::range(m.size())) m[i] += other.m[i];
+    weight += other.weight;
+    return *this;
+  }
+
+  // Mean squared distance from p to the accumulated planes
+  [[nodiscard]] double evaluate(const glm::dvec3 &p) const {
+    const auto sum{m[0] * p.x * p.x + 2 * m[1] * p.x * p.y +
+                   2 * m[2] * p.x * p.z + 2 * m[3] * p.x + m[4] * p.y * p.y +
+                   2 * m[5] * p.y * p.z + 2 * m[6] * p.y + m[7] * p.z * p.z +
+                   2 * m[8] * p.z + m[9]};
+    return weight > 0.0 ? std::abs(sum) / weight : 0.0;
+  }
+};
+
+struct Collapse {
+  GLuint source{};
+  GLuint target{};
+  double cost{};
+};
+
+[[nodiscard]] float computeExtent(std::span<const abcg::Vertex> vertices) {
+  if (vertices.empty()) return 0.0f;
+  glm::vec3 min{vertices.front().position};
+  glm::vec3 max{min};
+  for (const auto &vertex : vertices) {
+    min = glm::min(min, vertex.position);
+    max = glm::max(max, vertex.position);
+  }
+  const auto size{max - min};
+  return std::max({size.x, size.y, size.z});
+}
+
+[[nodiscard]] std::uint64_t edgeKey(GLuint a, GLuint b) {
+  return (static_cast<std::uint64_t>(std::min(a, b)) << 32U) | std::max(a, b);
+}
+}  // namespace
+
+/**
+ * @brief Simplifies an indexed triangle mesh.
+ *
+ * Vertices sharing the same position are treated as a single node, so seams
+ * of normals or texture coordinates don't open cracks. Vertices on open
+ * borders are kept in place.
+ *
+ * @param vertices Vertex buffer.
+ * @param indices Index buffer, three indices per triangle.
+ * @param targetIndexCount Desired number of indices of the simplified mesh.
+ * @param targetError Maximum error, relative to the mesh extent, that a
+ * collapse may introduce.
+ * @param resultError If not null, receives the error of the result, relative
+ * to the mesh extent.
+ *
+ * @return Index buffer of the simplified mesh, referencing the same vertices.
+ */
+std::vector<GLuint> abcg::simplifyMesh(std::span<const Vertex> vertices,
+                                       std::span<const GLuint> indices,
+                                       std::size_t targetIndexCount,
+                                       float targetError, float *resultError) {
+  std::vector<GLuint> result(indices.begin(), indices.end());
+  if (resultError != nullptr) *resultError = 0.0f;
+
+  const auto extent{computeExtent(vertices)};
+  if (result.size() <= targetIndexCount || extent <= 0.0f) return result;
+
+  const auto vertexCount{vertices.size()};
+
+  // Map each vertex to the first vertex with the same position (its node)
+  std::vector<GLuint> node(vertexCount);
+  std::unordered_map<glm::vec3, GLuint> firstAtPosition{};
+  for (auto index : iter::range(vertexCount)) {
+    const auto [it, inserted]{firstAtPosition.try_emplace(
+        vertices[index].position, static_cast<GLuint>(index))};
+    node[index] = it->second;
+  }
+
+  // Vertices of each node, in compressed sparse row format
+  std::vector<GLuint> wedgeOffsets(vertexCount + 1, 0);
+  for (auto index : iter::range(vertexCount)) ++wedgeOffsets[node[index] + 1];
+  std::partial_sum(wedgeOffsets.begin(), wedgeOffsets.end(),
+                   wedgeOffsets.begin());
+  std::vector<GLuint> wedges(vertexCount);
+  {
+    auto cursor{wedgeOffsets};
+    for (auto index : iter::range(vertexCount))
+      wedges[cursor[node[index]]++] = static_cast<GLuint>(index);
+  }
+
+  // Positions normalized to the unit cube so that errors are scale-invariant
+  const auto origin{glm::dvec3{vertices.front().position}};
+  const auto scale{1.0 / static_cast<double>(extent)};
+  auto position{[&](GLuint index) {
+    return (glm::dvec3{vertices[index].position} - origin) * scale;
+  }};
+
+  // Accumulate area-weighted plane quadrics and find border edges
+  std::vector<Quadric> quadrics(vertexCount);
+  std::unordered_map<std::uint64_t, int> edgeCount{};
+  for (auto offset : iter::range<std::size_t>(0, result.size(), 3)) {
+    const std::array corners{node[result[offset + 0]],
+                             node[result[offset + 1]],
+                             node[result[offset + 2]]};
+    const auto p0{position(corners[0])};
+    auto normal{glm::cross(position(corners[1]) - p0,
+                           position(corners[2]) - p0)};
+    const auto doubleArea{glm::length(normal)};
+    if (doubleArea > 0.0) {
+      normal /= doubleArea;
+      for (auto corner : corners) {
+        quadrics[corner].addPlane(normal, -glm::dot(normal, p0),
+                                  doubleArea * 0.5);
+      }
+    }
+    for (auto i : iter::range(std::size_t{3})) {
+      ++edgeCount[edgeKey(corners.at(i), corners.at((i + 1) % 3))];
+    }
+  }
+  std::vector<bool> locked(vertexCount, false);
+  for (const auto &[key, count] : edgeCount) {
+    if (count == 1) {
+      locked[static_cast<GLuint>(key >> 32U)] = true;
+      locked[static_cast<GLuint>(key & 0xFFFFFFFFU)] = true;
+    }
+  }
+
+  // Union-find style remap from collapsed vertices to surviving vertices
+  std::vector<GLuint> remap(vertexCount);
+  std::iota(remap.begin(), remap.end(), 0);
+  auto resolve{[&remap](GLuint index) {
+    auto root{index};
+    while (remap[root] != root) root = remap[root];
+    while (remap[index] != root) index = std::exchange(remap[index], root);
+    return root;
+  }};
+
+  // Surviving vertex of the target node whose attributes best match those of
+  // the given vertex
+  auto closestWedge{[&](GLuint target, GLuint index) {
+    auto best{target};
+    auto bestDistance{std::numeric_limits<float>::max()};
+    for (auto offset : iter::range(wedgeOffsets[target],
+                                   wedgeOffsets[target + 1])) {
+      const auto candidate{wedges[offset]};
+      const auto distance{
+          glm::distance(vertices[candidate].normal, vertices[index].normal) +
+          glm::distance(vertices[candidate].texCoord,
+                        vertices[index].texCoord)};
+      if (distance < bestDistance) {
+        best = candidate;
+        bestDistance = distance;
+      }
+    }
+    return best;
+  }};
+
+  const auto maxCost{static_cast<double>(targetError) *
+                     static_cast<double>(targetError)};
+  double resultCost{};
+
+  std::vector<std::pair<GLuint, GLuint>> edges;
+  std::vector<Collapse> collapses;
+  std::vector<GLuint> adjacencyOffsets(vertexCount + 1);
+  std::vector<GLuint> adjacency;
+  std::vector<bool> touched(vertexCount);
+
+  while (result.size() > targetIndexCount) {
+    // Unique edges between nodes
+    edges.clear();
+    for (auto offset : iter::range<std::size_t>(0, result.size(), 3)) {
+      for (auto i : iter::range<std::size_t>(3)) {
+        const auto a{node[result[offset + i]]};
+        const auto b{node[result[offset + (i + 1) % 3]]};
+        edges.emplace_back(std::min(a, b), std::max(a, b));
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    // Cheapest valid direction of each edge collapse
+    collapses.clear();
+    for (const auto &[a, b] : edges) {
+      auto merged{quadrics[a]};
+      merged += quadrics[b];
+      const auto costToA{locked[b] ? std::numeric_limits<double>::max()
+                                   : merged.evaluate(position(a))};
+      const auto costToB{locked[a] ? std::numeric_limits<double>::max()
+                                   : merged.evaluate(position(b))};
+      if (costToA <= costToB && !locked[b]) {
+        collapses.push_back({b, a, costToA});
+      } else if (!locked[a]) {
+        collapses.push_back({a, b, costToB});
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const auto &lhs, const auto &rhs) {
+                return lhs.cost < rhs.cost;
+              });
+
+    // Triangles incident to each node
+    std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+    for (auto index : result) ++adjacencyOffsets[node[index] + 1];
+    std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(),
+                     adjacencyOffsets.begin());
+    adjacency.resize(result.size());
+    {
+      auto cursor{adjacencyOffsets};
+      for (auto offset : iter::range(result.size())) {
+        adjacency[cursor[node[result[offset]]]++] =
+            static_cast<GLuint>(offset / 3);
+      }
+    }
+
+    // Apply independent collapses until the target is reached
+    std::fill(touched.begin(), touched.end(), false);
+    auto trianglesLeft{result.size() / 3};
+    std::size_t applied{};
+    for (const auto &collapse : collapses) {
+      if (collapse.cost > maxCost || trianglesLeft * 3 <= targetIndexCount)
+        break;
+      const auto source{collapse.source};
+      const auto target{collapse.target};
+      if (touched[source] || touched[target]) continue;
+
+      // Reject collapses that would flip a triangle
+      const auto targetPosition{position(target)};
+      bool flips{false};
+      std::size_t removedTriangles{};
+      for (auto offset : iter::range(adjacencyOffsets[source],
+                                     adjacencyOffsets[source + 1])) {
+        const auto triangle{adjacency[offset] * std::size_t{3}};
+        std::array<GLuint, 3> corners{};
+        for (auto i : iter::range<std::size_t>(3))
+          corners.at(i) = node[result[triangle + i]];
+        if (std::find(corners.begin(), corners.end(), target) !=
+            corners.end()) {
+          ++removedTriangles;
+          continue;
+        }
+        std::array before{position(corners[0]), position(corners[1]),
+                          position(corners[2])};
+        auto after{before};
+        for (auto i : iter::range<std::size_t>(3)) {
+          if (corners.at(i) == source) after.at(i) = targetPosition;
+        }
+        const auto n0{glm::cross(before[1] - before[0], before[2] - before[0])};
+        const auto n1{glm::cross(after[1] - after[0], after[2] - after[0])};
+        if (glm::dot(n0, n1) < 1e-2 * glm::length(n0) * glm::length(n1)) {
+          flips = true;
+          break;
+        }
+      }
+      if (flips) continue;
+
+      // Merge the source node into the target node
+      for (auto offset : iter::range(wedgeOffsets[source],
+                                     wedgeOffsets[source + 1])) {
+        const auto wedge{wedges[offset]};
+        remap[wedge] = closestWedge(target, wedge);
+      }
+      quadrics[target] += quadrics[source];
+
+      // Freeze the one-ring so that the flip test above stays valid
+      for (auto offset : iter::range(adjacencyOffsets[source],
+                                     adjacencyOffsets[source + 1])) {
+        const auto triangle{adjacency[offset] * std::size_t{3}};
+        for (auto i : iter::range<std::size_t>(3))
+          touched[node[result[triangle + i]]] = true;
+      }
+
+      resultCost = std::max(resultCost, collapse.cost);
+      trianglesLeft -= std::min(trianglesLeft, removedTriangles);
+      ++applied;
+    }
+
+    if (applied == 0) break;
+
+    // Rewrite triangles and drop the degenerate ones
+    std::size_t writeOffset{};
+    for (auto offset : iter::range<std::size_t>(0, result.size(), 3)) {
+      const std::array corners{resolve(result[offset + 0]),
+                               resolve(result[offset + 1]),
+                               resolve(result[offset + 2])};
+      if (node[corners[0]] == node[corners[1]] ||
+          node[corners[1]] == node[corners[2]] ||
+          node[corners[2]] == node[corners[0]])
+        continue;
+      for (auto corner : corners) result[writeOffset++] = corner;
+    }
+    result.resize(writeOffset);
+  }
+
+  if (resultError != nullptr) {
+    *resultError = static_cast<float>(std::sqrt(resultCost));
+  }
+
+  return result;
+}
+
+/**
+ * @brief Generates a chain of levels of detail for an indexed mesh.
+ *
+ * Each level has about half the triangles of the previous one. The indices of
+ * the new levels are appended to `indices`, so that all levels can be stored
+ * in a single element buffer.
+ *
+ * @param vertices Vertex buffer.
+ * @param indices Index buffer of the full-detail mesh. On return, it also
+ * contains the indices of the coarser levels.
+ * @param maxLevels Maximum number of levels, including the full-detail one.
+ * @param maxError Maximum error of each simplification step, relative to the
+ * mesh extent.
+ *
+ * @return Index ranges of each level, from the finest to the coarsest.
+ */
+std::vector<abcg::MeshLOD> abcg::generateLODs(std::span<const Vertex> vertices,
+                                              std::vector<GLuint> &indices,
+                                              std::size_t maxLevels,
+                                              float maxError) {
+  std::vector<MeshLOD> lods{{.firstIndex = 0, .indexCount = indices.size()}};
+
+  const auto extent{computeExtent(vertices)};
+  auto previous{indices};
+  auto error{0.0f};
+
+  while (lods.size() < maxLevels) {
+    const auto targetIndexCount{previous.size() / 6 * 3};
+    if (targetIndexCount < 3) break;
+
+    auto stepError{0.0f};
+    auto lod{simplifyMesh(vertices, previous, targetIndexCount, maxError,
+                          &stepError)};
+    // Stop when the simplifier can no longer make meaningful progress
+    if (lod.empty() || lod.size() * 10 > previous.size() * 9) break;
+
+    // Errors of successive steps add up in the worst case
+    error += stepError * extent;
+    lods.push_back({.firstIndex = indices.size(),
+                    .indexCount = lod.size(),
+                    .error = error});
+    indices.insert(indices.end(), lod.begin(), lod.end());
+    previous = std::move(lod);
+  }
+
+  return lods;
+}
+
+/**
+ * @brief Selects the coarsest level of detail with an acceptable screen-space
+ * error.
+ *
+ * @param lods Levels of detail, from the finest to the coarsest.
+ * @param distance Distance from the viewer to the object, in object space
+ * units.
+ * @param fieldOfView Vertical field of view, in radians.
+ * @param viewportHeight Height of the viewport, in pixels.
+ * @param pixelThreshold Maximum projected error, in pixels.
+ *
+ * @return Index of the selected level.
+ */
+std::size_t abcg::selectLOD(std::span<const MeshLOD> lods, float distance,
+                            float fieldOfView, int viewportHeight,
+                            float pixelThreshold) {
+  const auto epsilon{std::numeric_limits<float>::epsilon()};
+  const auto pixelsPerUnit{
+      static_cast<float>(viewportHeight) /
+      (2.0f * std::tan(fieldOfView / 2.0f) * std::max(distance, epsilon))};
+
+  std::size_t selected{};
+  for (auto &&[level, lod] : iter::enumerate(lods)) {
+    if (lod.error * pixelsPerUnit > pixelThreshold) break;
+    selected = level;
+  }
+  return selected;
+}
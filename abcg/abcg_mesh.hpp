@@ -0,0 +1,86 @@
+/**
+ * @file abcg_mesh.hpp
+ * @brief Declaration of mesh processing helper functions.
+ *
+ * Vertex type shared by the mesh processing functions, plus level-of-detail
+ * generation and selection.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MESH_HPP_
+#define ABCG_MESH_HPP_
+
+#include <abcg_external.hpp>
+#include <cstddef>
+#include <glm/gtc/epsilon.hpp>
+#include <glm/gtx/hash.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace abcg {
+struct MeshLOD;
+struct Vertex;
+
+[[nodiscard]] std::vector<GLuint> simplifyMesh(
+    std::span<const Vertex> vertices, std::span<const GLuint> indices,
+    std::size_t targetIndexCount, float targetError,
+    float *resultError = nullptr);
+[[nodiscard]] std::vector<MeshLOD> generateLODs(
+    std::span<const Vertex> vertices, std::vector<GLuint> &indices,
+    std::size_t maxLevels = 4, float maxError = 0.05f);
+[[nodiscard]] std::size_t selectLOD(std::span<const MeshLOD> lods,
+                                    float distance, float fieldOfView,
+                                    int viewportHeight,
+                                    float pixelThreshold = 1.0f);
+}  // namespace abcg
+
+/**
+ * @brief Vertex with position, normal, texture coordinates and tangent.
+ *
+ * The `w` component of `tangent` is the handedness of the tangent space
+ * (+1 or -1). The bitangent is `tangent.w * cross(normal, tangent.xyz)`.
+ */
+struct abcg::Vertex {
+  glm::vec3 position{};
+  glm::vec3 normal{};
+  glm::vec2 texCoord{};
+  glm::vec4 tangent{};
+
+  bool operator==(const Vertex &other) const noexcept {
+    static const auto epsilon{std::numeric_limits<float>::epsilon()};
+    return glm::all(glm::epsilonEqual(position, other.position, epsilon)) &&
+           glm::all(glm::epsilonEqual(normal, other.normal, epsilon)) &&
+           glm::all(glm::epsilonEqual(texCoord, other.texCoord, epsilon)) &&
+           glm::all(glm::epsilonEqual(tangent, other.tangent, epsilon));
+  }
+};
+
+/**
+ * @brief Range of indices of one level of detail of a mesh.
+ *
+ * All levels share the same vertex buffer. `error` is the approximation error
+ * in object space units, which is zero for the full-detail level.
+ */
+struct abcg::MeshLOD {
+  std::size_t firstIndex{};
+  std::size_t indexCount{};
+  float error{};
+};
+
+// Explicit specialization of std::hash for abcg::Vertex
+template <>
+struct std::hash<abcg::Vertex> {
+  std::size_t operator()(const abcg::Vertex &vertex) const noexcept {
+    const std::size_t h1{std::hash<glm::vec3>()(vertex.position)};
+    const std::size_t h2{std::hash<glm::vec3>()(vertex.normal)};
+    const std::size_t h3{std::hash<glm::vec2>()(vertex.texCoord)};
+    return h1 ^ (h2 << 1) ^ (h3 << 2);
+  }
+};
+
+#endif
@@ -0,0 +1,131 @@
+/**
+ * @file abcg_meshlet.cpp
+ * @brief Definition of 16-bit index buffer narrowing.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_meshlet.hpp"
+
+#include <algorithm>
+#include <cppitertools/itertools.hpp>
+#include <limits>
+
+#include "abcg_openglfunctions.hpp"
+
+namespace {
+// Number of vertices addressable by a 16-bit index. 0xFFFF is left out
+// because it is always the primitive restart index on OpenGL ES 3.0 and
+// WebGL 2, so the largest local index is 0xFFFE
+constexpr std::size_t maxMeshletVertices{
+    std::size_t{std::numeric_limits<GLushort>::max()}};
+}  // namespace
+
+/**
+ * @brief Converts a 32-bit index buffer of triangles to 16-bit indices.
+ *
+ * When there are more than 65535 vertices, the triangles are grouped in
+ * order into meshlets whose vertices fit in a window of 65535 vertices.
+ * Triangles whose own vertices are too far apart have their vertices
+ * duplicated at the end of `vertices`. Run abcg::optimizeVertexFetch before
+ * this function to get fewer meshlets.
+ *
+ * @param vertices Vertices of the mesh. May be appended with duplicates.
+ * @param indices Indices of the triangles.
+ *
+ * @return 16-bit index buffer and its meshlets.
+ */
+abcg::NarrowIndexBuffer abcg::narrowIndices(std::vector<Vertex> &vertices,
+                                            std::span<const GLuint> indices) {
+  NarrowIndexBuffer result;
+  result.indices.reserve(indices.size());
+
+  if (vertices.size() <= maxMeshletVertices) {
+    std::transform(indices.begin(), indices.end(),
+                   std::back_inserter(result.indices),
+                   [](GLuint index) { return static_cast<GLushort>(index); });
+    result.meshlets.push_back({.indexCount = indices.size()});
+    return result;
+  }
+
+  // Global indices, including the ones of duplicated vertices
+  std::vector<GLuint> remapped(indices.begin(), indices.end());
+
+  Meshlet meshlet;
+  GLuint maxVertex{};
+  for (const auto offset : iter::range<std::size_t>(0, remapped.size(), 3)) {
+    auto *triangle{&remapped.at(offset)};
+    auto triangleMin{std::min({triangle[0], triangle[1], triangle[2]})};
+    auto triangleMax{std::max({triangle[0], triangle[1], triangle[2]})};
+
+    if (triangleMax - triangleMin >= maxMeshletVertices) {
+      for (const auto i : iter::range(3)) {
+        const auto vertex{vertices.at(triangle[i])};
+        triangle[i] = static_cast<GLuint>(vertices.size());
+        vertices.push_back(vertex);
+      }
+      triangleMin = triangle[0];
+      triangleMax = triangle[2];
+    }
+
+    if (meshlet.indexCount > 0) {
+      const auto newMin{std::min(meshlet.baseVertex, triangleMin)};
+      const auto newMax{std::max(maxVertex, triangleMax)};
+      if (newMax - newMin < maxMeshletVertices) {
+        meshlet.baseVertex = newMin;
+        maxVertex = newMax;
+        meshlet.indexCount += 3;
+        continue;
+      }
+      result.meshlets.push_back(meshlet);
+    }
+
+    meshlet = {
+        .baseVertex = triangleMin, .firstIndex = offset, .indexCount = 3};
+    maxVertex = triangleMax;
+  }
+  if (meshlet.indexCount > 0) result.meshlets.push_back(meshlet);
+
+  for (const auto &current : result.meshlets) {
+    const auto first{remapped.begin() +
+                     static_cast<std::ptrdiff_t>(current.firstIndex)};
+    std::transform(first,
+                   first + static_cast<std::ptrdiff_t>(current.indexCount),
+                   std::back_inserter(result.indices), [&](GLuint index) {
+                     return static_cast<GLushort>(index - current.baseVertex);
+                   });
+  }
+
+  return result;
+}
+
+/**
+ * @brief Draws a range of a 16-bit index buffer split into meshlets.
+ *
+ * Each meshlet is drawn with its own VAO, whose attribute pointers must be
+ * offset by the base vertex of the meshlet (see
+ * abcg::opengl::setupVertexAttributes). All VAOs must share the same index
+ * buffer. The VAO of the last meshlet drawn is left bound.
+ *
+ * @param VAOs VAOs of the meshlets, one for each meshlet.
+ * @param meshlets Meshlets of the index buffer.
+ * @param firstIndex First index of the range to draw.
+ * @param indexCount Number of indices of the range to draw.
+ */
+void abcg::opengl::drawMeshlets(std::span<const GLuint> VAOs,
+                                std::span<const Meshlet> meshlets,
+                                std::size_t firstIndex,
+                                std::size_t indexCount) {
+  const auto lastIndex{firstIndex + indexCount};
+  for (const auto &&[index, meshlet] : iter::enumerate(meshlets)) {
+    const auto first{std::max(firstIndex, meshlet.firstIndex)};
+    const auto last{
+        std::min(lastIndex, meshlet.firstIndex + meshlet.indexCount)};
+    if (first >= last) continue;
+
+    abcg::glBindVertexArray(VAOs[index]);
+    abcg::glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(last - first),
+                         GL_UNSIGNED_SHORT,
+                         reinterpret_cast<void *>(first * sizeof(GLushort)));
+  }
+}
@@ -0,0 +1,59 @@
+/**
+ * @file abcg_meshlet.hpp
+ * @brief Declaration of 16-bit index buffer narrowing.
+ *
+ * Conversion of 32-bit index buffers to 16-bit index buffers. Meshes with more
+ * than 65535 vertices are split into meshlets that each address at most 65535
+ * vertices starting from a base vertex.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MESHLET_HPP_
+#define ABCG_MESHLET_HPP_
+
+#include <abcg_external.hpp>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "abcg_mesh.hpp"
+
+namespace abcg {
+struct Meshlet;
+struct NarrowIndexBuffer;
+
+[[nodiscard]] NarrowIndexBuffer narrowIndices(std::vector<Vertex> &vertices,
+                                              std::span<const GLuint> indices);
+}  // namespace abcg
+
+namespace abcg::opengl {
+void drawMeshlets(std::span<const GLuint> VAOs,
+                  std::span<const Meshlet> meshlets, std::size_t firstIndex,
+                  std::size_t indexCount);
+}  // namespace abcg::opengl
+
+/**
+ * @brief Range of a 16-bit index buffer that addresses vertices relative to
+ * `baseVertex`.
+ *
+ */
+struct abcg::Meshlet {
+  GLuint baseVertex{};
+  std::size_t firstIndex{};
+  std::size_t indexCount{};
+};
+
+/**
+ * @brief 16-bit index buffer and its meshlets.
+ *
+ * Indices keep the same positions they had in the 32-bit index buffer, so
+ * index ranges such as the ones of abcg::MeshLOD are still valid. Meshes with
+ * up to 65535 vertices have a single meshlet with base vertex 0.
+ */
+struct abcg::NarrowIndexBuffer {
+  std::vector<GLushort> indices{};
+  std::vector<Meshlet> meshlets{};
+};
+
+#endif
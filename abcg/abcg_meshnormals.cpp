@@ -0,0 +1,333 @@
+/**
+ * @file abcg_meshnormals.cpp
+ * @brief Definition of vertex normal and tangent generation.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_meshnormals.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+#include "abcg_exception.hpp"
+#include "abcg_jobsystem.hpp"
+
+namespace {
+// Number of triangles whose face normals are computed together. Positions of
+// a batch are gathered into arrays of components so that the compiler can
+// vectorize the arithmetic.
+constexpr std::size_t batchSize{64};
+
+// Minimum number of items handled by each job
+constexpr std::size_t minItemsPerJob{16384};
+
+// Calls function(first, last) for disjoint subranges of [0, count) on the
+// shared job system. Runs inline for small ranges and on Emscripten.
+template <typename Function>
+void parallelFor(std::size_t count, const Function &function) {
+  abcg::getJobSystem().parallelFor(count, minItemsPerJob, function);
+}
+
+// Triangle corners that share each vertex, as a compressed sparse row. The
+// corners of vertex i are corners[offsets[i]] to corners[offsets[i + 1] - 1].
+struct VertexCorners {
+  std::vector<std::size_t> offsets;
+  std::vector<GLuint> corners;
+
+  [[nodiscard]] std::span<const GLuint> get(std::size_t vertex) const {
+    return std::span{corners}.subspan(offsets[vertex],
+                                      offsets[vertex + 1] - offsets[vertex]);
+  }
+};
+
+[[nodiscard]] VertexCorners buildVertexCorners(
+    std::size_t vertexCount, std::span<const GLuint> indices) {
+  VertexCorners result;
+  result.offsets.resize(vertexCount + 1);
+  for (const auto index : indices) {
+    if (index >= vertexCount) {
+      throw abcg::Exception{abcg::Exception::Runtime("Index out of range")};
+    }
+    ++result.offsets[index + 1];
+  }
+  std::partial_sum(result.offsets.begin(), result.offsets.end(),
+                   result.offsets.begin());
+
+  result.corners.resize(indices.size());
+  auto nextCorner{result.offsets};
+  for (const auto corner : iter::range(indices.size())) {
+    result.corners[nextCorner[indices[corner]]++] = static_cast<GLuint>(corner);
+  }
+  return result;
+}
+
+// Angle between the unit vectors u and v, computed with atan2 for accuracy
+// at small and large angles
+[[nodiscard]] float angleBetween(float ux, float uy, float uz, float vx,
+                                 float vy, float vz) {
+  const auto cx{uy * vz - uz * vy};
+  const auto cy{uz * vx - ux * vz};
+  const auto cz{ux * vy - uy * vx};
+  return std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz),
+                    ux * vx + uy * vy + uz * vz);
+}
+
+// Angles of the triangle abc at each of its corners
+[[nodiscard]] glm::vec3 computeCornerAngles(const glm::vec3 &a,
+                                            const glm::vec3 &b,
+                                            const glm::vec3 &c) {
+  const auto safeNormalize{[](const glm::vec3 &v) {
+    const auto length{glm::length(v)};
+    return length > 0.0f ? v / length : glm::vec3{};
+  }};
+  const auto ab{safeNormalize(b - a)};
+  const auto bc{safeNormalize(c - b)};
+  const auto ca{safeNormalize(a - c)};
+  return {angleBetween(ab.x, ab.y, ab.z, -ca.x, -ca.y, -ca.z),
+          angleBetween(bc.x, bc.y, bc.z, -ab.x, -ab.y, -ab.z),
+          angleBetween(ca.x, ca.y, ca.z, -bc.x, -bc.y, -bc.z)};
+}
+
+// Unit vector orthogonal to the unit vector n
+[[nodiscard]] glm::vec3 computeOrthogonal(const glm::vec3 &n) {
+  const glm::vec3 v{std::abs(n.x) > std::abs(n.z) ? glm::vec3{-n.y, n.x, 0.0f}
+                                                  : glm::vec3{0.0f, -n.z, n.y}};
+  const auto length{glm::length(v)};
+  return length > 0.0f ? v / length : glm::vec3{1.0f, 0.0f, 0.0f};
+}
+
+// Computes the face normals of triangles [first, last). For each triangle,
+// the contribution to the normal of its corner k is
+// faceNormals[t] * cornerWeights[t][k].
+void computeFaceNormals(std::span<const abcg::Vertex> vertices,
+                        std::span<const GLuint> indices, std::size_t first,
+                        std::size_t last, abcg::NormalWeighting weighting,
+                        std::span<glm::vec3> faceNormals,
+                        std::span<glm::vec3> cornerWeights) {
+  // Triangle corners as structure of arrays
+  std::array<float, batchSize> ax{}, ay{}, az{};
+  std::array<float, batchSize> bx{}, by{}, bz{};
+  std::array<float, batchSize> cx{}, cy{}, cz{};
+  std::array<float, batchSize> nx{}, ny{}, nz{};
+
+  for (auto batchFirst{first}; batchFirst < last; batchFirst += batchSize) {
+    const auto count{std::min(batchSize, last - batchFirst)};
+
+    // Gather
+    for (const auto i : iter::range(count)) {
+      const auto *triangle{&indices[(batchFirst + i) * 3]};
+      const auto &a{vertices[triangle[0]].position};
+      const auto &b{vertices[triangle[1]].position};
+      const auto &c{vertices[triangle[2]].position};
+      ax[i] = a.x;
+      ay[i] = a.y;
+      az[i] = a.z;
+      bx[i] = b.x;
+      by[i] = b.y;
+      bz[i] = b.z;
+      cx[i] = c.x;
+      cy[i] = c.y;
+      cz[i] = c.z;
+    }
+
+    // Cross product of the edges. Its length is twice the area.
+    for (const auto i : iter::range(batchSize)) {
+      const auto e1x{bx[i] - ax[i]};
+      const auto e1y{by[i] - ay[i]};
+      const auto e1z{bz[i] - az[i]};
+      const auto e2x{cx[i] - ax[i]};
+      const auto e2y{cy[i] - ay[i]};
+      const auto e2z{cz[i] - az[i]};
+      nx[i] = e1y * e2z - e1z * e2y;
+      ny[i] = e1z * e2x - e1x * e2z;
+      nz[i] = e1x * e2y - e1y * e2x;
+    }
+
+    if (weighting != abcg::NormalWeighting::Area) {
+      for (const auto i : iter::range(batchSize)) {
+        const auto length{std::sqrt(nx[i] * nx[i] + ny[i] * ny[i] +
+                                    nz[i] * nz[i])};
+        const auto scale{length > 0.0f ? 1.0f / length : 0.0f};
+        nx[i] *= scale;
+        ny[i] *= scale;
+        nz[i] *= scale;
+      }
+    }
+
+    // Scatter
+    for (const auto i : iter::range(count)) {
+      const auto triangle{batchFirst + i};
+      faceNormals[triangle] = {nx[i], ny[i], nz[i]};
+      if (weighting != abcg::NormalWeighting::Angle) {
+        cornerWeights[triangle] = glm::vec3{1.0f};
+        continue;
+      }
+
+      cornerWeights[triangle] = computeCornerAngles({ax[i], ay[i], az[i]},
+                                                    {bx[i], by[i], bz[i]},
+                                                    {cx[i], cy[i], cz[i]});
+    }
+  }
+}
+}  // namespace
+
+/**
+ * @brief Computes smooth vertex normals of an indexed triangle mesh.
+ *
+ * Face normals are computed in batches of triangles, and the normal of each
+ * vertex is the normalized weighted sum of the normals of the faces that
+ * share the vertex. Both steps are split among threads on large meshes. Each
+ * thread owns a range of vertices, so results do not depend on the number of
+ * threads.
+ *
+ * Vertices not used by any triangle, or used only by degenerate triangles,
+ * get the normal (0, 0, 1) instead of NaN.
+ *
+ * @param vertices Vertices whose normals will be overwritten.
+ * @param indices Indices of the triangles.
+ * @param weighting Weight of each face normal.
+ *
+ * @throw abcg::Exception if an index is out of range.
+ */
+void abcg::computeNormals(std::span<Vertex> vertices,
+                          std::span<const GLuint> indices,
+                          NormalWeighting weighting) {
+  const auto numTriangles{indices.size() / 3};
+  const auto vertexCorners{
+      buildVertexCorners(vertices.size(), indices.first(numTriangles * 3))};
+
+  std::vector<glm::vec3> faceNormals(numTriangles);
+  std::vector<glm::vec3> cornerWeights(numTriangles);
+  parallelFor(numTriangles, [&](std::size_t first, std::size_t last) {
+    computeFaceNormals(vertices, indices, first, last, weighting, faceNormals,
+                       cornerWeights);
+  });
+
+  parallelFor(vertices.size(), [&](std::size_t first, std::size_t last) {
+    for (const auto vertexIndex : iter::range(first, last)) {
+      glm::vec3 normal{};
+      for (const auto corner : vertexCorners.get(vertexIndex)) {
+        const auto triangle{corner / 3};
+        const auto weight{
+            cornerWeights[triangle][static_cast<glm::length_t>(corner % 3)]};
+        normal += faceNormals[triangle] * weight;
+      }
+
+      const auto length{glm::length(normal)};
+      vertices[vertexIndex].normal =
+          length > 0.0f ? normal / length : glm::vec3{0.0f, 0.0f, 1.0f};
+    }
+  });
+}
+
+/**
+ * @brief Computes the tangent frames of an indexed triangle mesh.
+ *
+ * Follows the conventions of MikkTSpace, so that normal maps baked by tools
+ * that use MikkTSpace (e.g. Blender, Substance, xNormal) are reproduced
+ * correctly:
+ *
+ * - The tangent of each face is the direction of increasing `u` texture
+ * coordinate, projected onto the tangent plane of the vertex normal.
+ * - Face tangents are normalized and then weighted by the angle of the face
+ * at the vertex.
+ * - `tangent.w` is the handedness, and the bitangent must be computed in the
+ * fragment shader as `tangent.w * cross(normal, tangent.xyz)` from the
+ * interpolated (not normalized) vectors.
+ *
+ * Unlike the reference implementation, vertices are not split where faces
+ * of opposite handedness meet, so the handedness of these vertices is the
+ * one of the faces with larger total weight.
+ *
+ * Vertex normals must be computed beforehand. Vertices without faces with
+ * valid texture coordinates get an arbitrary tangent orthogonal to the
+ * normal.
+ *
+ * @param vertices Vertices whose tangents will be overwritten.
+ * @param indices Indices of the triangles.
+ *
+ * @throw abcg::Exception if an index is out of range.
+ */
+void abcg::computeTangents(std::span<Vertex> vertices,
+                           std::span<const GLuint> indices) {
+  const auto numTriangles{indices.size() / 3};
+  const auto vertexCorners{
+      buildVertexCorners(vertices.size(), indices.first(numTriangles * 3))};
+
+  // Unit tangent and bitangent of each face, and angle at each corner
+  std::vector<glm::vec3> faceTangents(numTriangles);
+  std::vector<glm::vec3> faceBitangents(numTriangles);
+  std::vector<glm::vec3> cornerAngles(numTriangles);
+  parallelFor(numTriangles, [&](std::size_t first, std::size_t last) {
+    for (const auto triangle : iter::range(first, last)) {
+      const auto &a{vertices[indices[triangle * 3 + 0]]};
+      const auto &b{vertices[indices[triangle * 3 + 1]]};
+      const auto &c{vertices[indices[triangle * 3 + 2]]};
+
+      const auto edge1{b.position - a.position};
+      const auto edge2{c.position - a.position};
+      const auto deltaUV1{b.texCoord - a.texCoord};
+      const auto deltaUV2{c.texCoord - a.texCoord};
+      const auto det{deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y};
+
+      cornerAngles[triangle] =
+          computeCornerAngles(a.position, b.position, c.position);
+
+      // Degenerate texture coordinates contribute nothing
+      if (det == 0.0f) continue;
+
+      // Sign of det is the orientation of the texture mapping
+      const auto sign{det > 0.0f ? 1.0f : -1.0f};
+      const auto tangent{(edge1 * deltaUV2.y - edge2 * deltaUV1.y) * sign};
+      const auto bitangent{(edge2 * deltaUV1.x - edge1 * deltaUV2.x) * sign};
+      const auto tangentLength{glm::length(tangent)};
+      const auto bitangentLength{glm::length(bitangent)};
+      if (tangentLength > 0.0f) {
+        faceTangents[triangle] = tangent / tangentLength;
+      }
+      if (bitangentLength > 0.0f) {
+        faceBitangents[triangle] = bitangent / bitangentLength;
+      }
+    }
+  });
+
+  parallelFor(vertices.size(), [&](std::size_t first, std::size_t last) {
+    for (const auto vertexIndex : iter::range(first, last)) {
+      auto &vertex{vertices[vertexIndex]};
+      const auto &normal{vertex.normal};
+
+      glm::vec3 tangent{};
+      glm::vec3 bitangent{};
+      for (const auto corner : vertexCorners.get(vertexIndex)) {
+        const auto triangle{corner / 3};
+        const auto weight{
+            cornerAngles[triangle][static_cast<glm::length_t>(corner % 3)]};
+
+        // Project onto the tangent plane of the vertex before weighting
+        const auto &faceTangent{faceTangents[triangle]};
+        const auto &faceBitangent{faceBitangents[triangle]};
+        const auto projectedTangent{faceTangent -
+                                    normal * glm::dot(normal, faceTangent)};
+        const auto projectedBitangent{
+            faceBitangent - normal * glm::dot(normal, faceBitangent)};
+        const auto length{glm::length(projectedTangent)};
+        if (length > 0.0f) tangent += projectedTangent * (weight / length);
+        bitangent += projectedBitangent * weight;
+      }
+
+      const auto length{glm::length(tangent)};
+      const auto unitTangent{length > 0.0f ? tangent / length
+                                           : computeOrthogonal(normal)};
+      const auto handedness{
+          glm::dot(glm::cross(normal, unitTangent), bitangent) < 0.0f ? -1.0f
+                                                                      : 1.0f};
+      vertex.tangent = glm::vec4{unitTangent, handedness};
+    }
+  });
+}
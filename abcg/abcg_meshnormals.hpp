@@ -0,0 +1,40 @@
+/**
+ * @file abcg_meshnormals.hpp
+ * @brief Declaration of vertex normal and tangent generation.
+ *
+ * Smooth vertex normals and tangent frames of indexed triangle meshes,
+ * computed in parallel.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MESHNORMALS_HPP_
+#define ABCG_MESHNORMALS_HPP_
+
+#include <abcg_external.hpp>
+#include <span>
+
+#include "abcg_mesh.hpp"
+
+namespace abcg {
+enum class NormalWeighting;
+
+void computeNormals(std::span<Vertex> vertices, std::span<const GLuint> indices,
+                    NormalWeighting weighting);
+void computeTangents(std::span<Vertex> vertices,
+                     std::span<const GLuint> indices);
+}  // namespace abcg
+
+/**
+ * @brief Weight of the contribution of each face to the normals of its
+ * vertices.
+ *
+ * - `Uniform`: all faces contribute equally.
+ * - `Area`: faces contribute proportionally to their area. This is the
+ * weighting of the usual sum of unnormalized cross products.
+ * - `Angle`: faces contribute proportionally to the angle of the face at the
+ * vertex. Results do not depend on how a surface is triangulated.
+ */
+enum class abcg::NormalWeighting { Uniform, Area, Angle };
+
+#endif
@@ -0,0 +1,372 @@
+/**
+ * @file abcg_meshoptimizer.cpp
+ * @brief Definition of mesh optimization functions.
+ *
+ * The vertex cache optimizer follows Tom Forsyth's "Linear-Speed Vertex Cache
+ * Optimisation" (2006). The overdraw optimizer follows Sander et al., "Fast
+ * Triangle Reordering for Vertex Locality and Reduced Overdraw" (SIGGRAPH
+ * 2007).
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_meshoptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <numeric>
+
+namespace {
+// Simulated FIFO cache, as found in most GPUs
+class FIFOCache {
+ public:
+  FIFOCache(std::size_t vertexCount, std::size_t cacheSize)
+      : m_timestamps(vertexCount, 0), m_cacheSize{cacheSize} {}
+
+  // Returns 1 on a cache miss, 0 on a hit
+  std::size_t access(GLuint index) {
+    if (m_time - m_timestamps[index] < m_cacheSize) return 0;
+    m_timestamps[index] = m_time++;
+    return 1;
+  }
+
+  // Makes every vertex miss on its next access
+  void reset() { m_time += m_cacheSize + 1; }
+
+ private:
+  std::vector<std::size_t> m_timestamps;
+  std::size_t m_cacheSize{};
+  std::size_t m_time{m_cacheSize + 1};
+};
+
+// Forsyth's scoring function
+constexpr std::size_t maxCacheSize{32};
+constexpr float cacheDecayPower{1.5f};
+constexpr float lastTriangleScore{0.75f};
+constexpr float valenceBoostScale{2.0f};
+constexpr float valenceBoostPower{0.5f};
+
+[[nodiscard]] float vertexScore(int cachePosition, std::size_t remaining) {
+  // Vertex not used by any remaining triangle
+  if (remaining == 0) return -1.0f;
+
+  auto score{0.0f};
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      // Vertices of the last triangle get a fixed score
+      score = lastTriangleScore;
+    } else {
+      const auto scaler{1.0f / static_cast<float>(maxCacheSize - 3)};
+      score = std::pow(
+          1.0f - static_cast<float>(cachePosition - 3) * scaler,
+          cacheDecayPower);
+    }
+  }
+
+  // Boost vertices with few remaining triangles to avoid leaving them behind
+  score += valenceBoostScale *
+           std::pow(static_cast<float>(remaining), -valenceBoostPower);
+  return score;
+}
+}  // namespace
+
+/**
+ * @brief Reorders triangles for better use of the post-transform vertex cache.
+ *
+ * @param indices Index buffer, three indices per triangle.
+ * @param vertexCount Number of vertices referenced by the index buffer.
+ *
+ * @return Reordered index buffer.
+ */
+std::vector<GLuint> abcg::optimizeVertexCache(std::span<const GLuint> indices,
+                                              std::size_t vertexCount) {
+  const auto triangleCount{indices.size() / 3};
+  std::vector<GLuint> result;
+  result.reserve(triangleCount * 3);
+  if (triangleCount == 0) return result;
+
+  // Triangles adjacent to each vertex, in compressed sparse row format
+  std::vector<std::size_t> adjacencyOffsets(vertexCount + 1, 0);
+  for (auto index : indices.first(triangleCount * 3))
+    ++adjacencyOffsets[index + 1];
+  std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(),
+                   adjacencyOffsets.begin());
+  std::vector<std::size_t> adjacency(triangleCount * 3);
+  {
+    auto cursor{adjacencyOffsets};
+    for (auto offset : iter::range(triangleCount * 3))
+      adjacency[cursor[indices[offset]]++] = offset / 3;
+  }
+
+  std::vector<std::size_t> remaining(vertexCount);
+  for (auto vertex : iter::range(vertexCount))
+    remaining[vertex] = adjacencyOffsets[vertex + 1] - adjacencyOffsets[vertex];
+
+  std::vector<int> cachePosition(vertexCount, -1);
+  std::vector<float> vertexScores(vertexCount);
+  for (auto vertex : iter::range(vertexCount))
+    vertexScores[vertex] = vertexScore(-1, remaining[vertex]);
+
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<GLuint> cache;
+  std::vector<GLuint> newCache;
+  cache.reserve(maxCacheSize + 3);
+  newCache.reserve(maxCacheSize + 3);
+
+  std::size_t bestTriangle{0};
+  std::size_t scanCursor{0};
+
+  for ([[maybe_unused]] auto iteration : iter::range(triangleCount)) {
+    // Fall back to a linear scan when the cache holds no candidates
+    if (bestTriangle == triangleCount) {
+      while (emitted[scanCursor]) ++scanCursor;
+      bestTriangle = scanCursor;
+    }
+
+    emitted[bestTriangle] = true;
+    const std::array corners{indices[bestTriangle * 3 + 0],
+                             indices[bestTriangle * 3 + 1],
+                             indices[bestTriangle * 3 + 2]};
+    result.insert(result.end(), corners.begin(), corners.end());
+
+    // Move the triangle vertices to the front of the LRU cache
+    newCache.assign(corners.begin(), corners.end());
+    for (auto vertex : cache) {
+      if (std::find(corners.begin(), corners.end(), vertex) == corners.end())
+        newCache.push_back(vertex);
+    }
+
+    for (auto vertex : corners) {
+      --remaining[vertex];
+      // Remove the emitted triangle from the vertex adjacency list
+      auto first{adjacency.begin() +
+                 static_cast<std::ptrdiff_t>(adjacencyOffsets[vertex])};
+      auto last{first + static_cast<std::ptrdiff_t>(remaining[vertex] + 1)};
+      if (auto it{std::find(first, last, bestTriangle)}; it != last)
+        std::iter_swap(it, last - 1);
+    }
+
+    // Update scores of cached vertices and of their remaining triangles
+    for (auto &&[position, vertex] : iter::enumerate(newCache)) {
+      const auto inCache{position < maxCacheSize};
+      cachePosition[vertex] = inCache ? static_cast<int>(position) : -1;
+      vertexScores[vertex] =
+          vertexScore(cachePosition[vertex], remaining[vertex]);
+    }
+
+    auto bestScore{-std::numeric_limits<float>::max()};
+    bestTriangle = triangleCount;
+    for (auto vertex : newCache) {
+      const auto first{adjacencyOffsets[vertex]};
+      for (auto offset : iter::range(first, first + remaining[vertex])) {
+        const auto triangle{adjacency[offset]};
+        const auto score{vertexScores[indices[triangle * 3 + 0]] +
+                         vertexScores[indices[triangle * 3 + 1]] +
+                         vertexScores[indices[triangle * 3 + 2]]};
+        if (score > bestScore) {
+          bestScore = score;
+          bestTriangle = triangle;
+        }
+      }
+    }
+
+    if (newCache.size() > maxCacheSize) newCache.resize(maxCacheSize);
+    std::swap(cache, newCache);
+  }
+
+  return result;
+}
+
+/**
+ * @brief Reorders clusters of triangles to reduce overdraw.
+ *
+ * The index buffer is split into clusters at points where the vertex cache
+ * would be cold anyway. Clusters are then sorted so that those facing away
+ * from the mesh center, which are more likely to occlude the others, are
+ * drawn first. Should be called after abcg::optimizeVertexCache.
+ *
+ * @param indices Index buffer, three indices per triangle.
+ * @param vertices Vertex buffer.
+ * @param threshold Maximum allowed increase of the ACMR, as a ratio (e.g.
+ * 1.05 allows for 5% more cache misses in exchange for more clusters).
+ *
+ * @return Reordered index buffer.
+ */
+std::vector<GLuint> abcg::optimizeOverdraw(std::span<const GLuint> indices,
+                                           std::span<const Vertex> vertices,
+                                           float threshold) {
+  const auto triangleCount{indices.size() / 3};
+  if (triangleCount == 0) return {};
+
+  // Hard boundaries: triangles that miss the cache on all three vertices
+  FIFOCache cache{vertices.size(), 16};
+  std::vector<std::size_t> hardClusters;
+  for (auto triangle : iter::range(triangleCount)) {
+    std::size_t misses{};
+    for (auto i : iter::range<std::size_t>(3))
+      misses += cache.access(indices[triangle * 3 + i]);
+    if (misses == 3) hardClusters.push_back(triangle);
+  }
+  hardClusters.push_back(triangleCount);
+
+  // Soft boundaries: split hard clusters while the ACMR stays acceptable
+  std::vector<std::size_t> clusters;
+  for (auto cluster : iter::range(hardClusters.size() - 1)) {
+    const auto begin{hardClusters[cluster]};
+    const auto end{hardClusters[cluster + 1]};
+
+    cache.reset();
+    std::size_t clusterMisses{};
+    for (auto offset : iter::range(begin * 3, end * 3))
+      clusterMisses += cache.access(indices[offset]);
+    const auto maxACMR{threshold * static_cast<float>(clusterMisses) /
+                       static_cast<float>(end - begin)};
+
+    cache.reset();
+    auto start{begin};
+    std::size_t misses{};
+    clusters.push_back(begin);
+    for (auto triangle : iter::range(begin, end)) {
+      for (auto i : iter::range<std::size_t>(3))
+        misses += cache.access(indices[triangle * 3 + i]);
+      const auto acmr{static_cast<float>(misses) /
+                      static_cast<float>(triangle - start + 1)};
+      if (triangle + 1 < end && acmr <= maxACMR) {
+        start = triangle + 1;
+        misses = 0;
+        cache.reset();
+        clusters.push_back(start);
+      }
+    }
+  }
+  clusters.push_back(triangleCount);
+
+  // Mesh centroid
+  glm::vec3 meshCentroid{};
+  for (const auto &vertex : vertices) meshCentroid += vertex.position;
+  meshCentroid /= static_cast<float>(std::max<std::size_t>(vertices.size(), 1));
+
+  // Sort key of each cluster: distance of its area-weighted centroid to the
+  // mesh centroid along the average cluster normal
+  struct ClusterKey {
+    std::size_t cluster{};
+    float key{};
+  };
+  std::vector<ClusterKey> keys;
+  keys.reserve(clusters.size() - 1);
+  for (auto cluster : iter::range(clusters.size() - 1)) {
+    glm::vec3 centroid{};
+    glm::vec3 normal{};
+    auto area{0.0f};
+    for (auto triangle :
+         iter::range(clusters[cluster], clusters[cluster + 1])) {
+      const auto &a{vertices[indices[triangle * 3 + 0]].position};
+      const auto &b{vertices[indices[triangle * 3 + 1]].position};
+      const auto &c{vertices[indices[triangle * 3 + 2]].position};
+      const auto faceNormal{glm::cross(b - a, c - a)};
+      const auto faceArea{glm::length(faceNormal)};
+      centroid += (a + b + c) * (faceArea / 3.0f);
+      normal += faceNormal;
+      area += faceArea;
+    }
+    auto key{0.0f};
+    if (const auto length{glm::length(normal)}; area > 0.0f && length > 0.0f) {
+      key = glm::dot(centroid / area - meshCentroid, normal / length);
+    }
+    keys.push_back({cluster, key});
+  }
+  std::stable_sort(keys.begin(), keys.end(),
+                   [](const auto &lhs, const auto &rhs) {
+                     return lhs.key > rhs.key;
+                   });
+
+  std::vector<GLuint> result;
+  result.reserve(triangleCount * 3);
+  for (const auto &[cluster, key] : keys) {
+    const auto first{indices.begin() +
+                     static_cast<std::ptrdiff_t>(clusters[cluster] * 3)};
+    const auto last{indices.begin() +
+                    static_cast<std::ptrdiff_t>(clusters[cluster + 1] * 3)};
+    result.insert(result.end(), first, last);
+  }
+  return result;
+}
+
+/**
+ * @brief Reorders vertices in the order they are first referenced.
+ *
+ * Vertices not referenced by the index buffer are removed. The index buffer
+ * is remapped accordingly.
+ *
+ * @param vertices Vertex buffer.
+ * @param indices Index buffer.
+ */
+void abcg::optimizeVertexFetch(std::vector<Vertex> &vertices,
+                               std::vector<GLuint> &indices) {
+  constexpr auto unused{std::numeric_limits<GLuint>::max()};
+  std::vector<GLuint> remap(vertices.size(), unused);
+  std::vector<Vertex> result;
+  result.reserve(vertices.size());
+
+  for (auto &index : indices) {
+    if (remap[index] == unused) {
+      remap[index] = static_cast<GLuint>(result.size());
+      result.push_back(vertices[index]);
+    }
+    index = remap[index];
+  }
+
+  vertices = std::move(result);
+}
+
+/**
+ * @brief Runs all mesh optimizations.
+ *
+ * Runs abcg::optimizeVertexCache and abcg::optimizeOverdraw on each level of
+ * detail, then abcg::optimizeVertexFetch on the whole mesh.
+ *
+ * @param vertices Vertex buffer.
+ * @param indices Index buffer.
+ * @param lods Index ranges of each level of detail. If empty, the whole index
+ * buffer is treated as a single level.
+ */
+void abcg::optimizeMesh(std::vector<Vertex> &vertices,
+                        std::vector<GLuint> &indices,
+                        std::span<const MeshLOD> lods) {
+  const MeshLOD wholeMesh{.firstIndex = 0, .indexCount = indices.size()};
+  for (const auto &lod : lods.empty() ? std::span{&wholeMesh, 1} : lods) {
+    const auto range{
+        std::span{indices}.subspan(lod.firstIndex, lod.indexCount)};
+    const auto reordered{optimizeOverdraw(
+        optimizeVertexCache(range, vertices.size()), vertices)};
+    std::copy(reordered.begin(), reordered.end(), range.begin());
+  }
+
+  optimizeVertexFetch(vertices, indices);
+}
+
+/**
+ * @brief Computes the average cache miss ratio of an index buffer.
+ *
+ * @param indices Index buffer, three indices per triangle.
+ * @param vertexCount Number of vertices referenced by the index buffer.
+ * @param cacheSize Number of entries of the simulated FIFO cache.
+ *
+ * @return Average number of vertex shader invocations per triangle, between
+ * 0.5 (best case for regular grids) and 3.0 (no reuse).
+ */
+float abcg::computeACMR(std::span<const GLuint> indices,
+                        std::size_t vertexCount, std::size_t cacheSize) {
+  const auto triangleCount{indices.size() / 3};
+  if (triangleCount == 0) return 0.0f;
+
+  FIFOCache cache{vertexCount, cacheSize};
+  std::size_t misses{};
+  for (auto index : indices) misses += cache.access(index);
+
+  return static_cast<float>(misses) / static_cast<float>(triangleCount);
+}
@@ -0,0 +1,36 @@
+/**
+ * @file abcg_meshoptimizer.hpp
+ * @brief Declaration of mesh optimization functions.
+ *
+ * Reordering of indexed triangle meshes for better use of the post-transform
+ * vertex cache, less overdraw, and better locality of vertex fetches.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MESHOPTIMIZER_HPP_
+#define ABCG_MESHOPTIMIZER_HPP_
+
+#include <abcg_external.hpp>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "abcg_mesh.hpp"
+
+namespace abcg {
+[[nodiscard]] std::vector<GLuint> optimizeVertexCache(
+    std::span<const GLuint> indices, std::size_t vertexCount);
+[[nodiscard]] std::vector<GLuint> optimizeOverdraw(
+    std::span<const GLuint> indices, std::span<const Vertex> vertices,
+    float threshold = 1.05f);
+void optimizeVertexFetch(std::vector<Vertex> &vertices,
+                         std::vector<GLuint> &indices);
+void optimizeMesh(std::vector<Vertex> &vertices, std::vector<GLuint> &indices,
+                  std::span<const MeshLOD> lods = {});
+[[nodiscard]] float computeACMR(std::span<const GLuint> indices,
+                                std::size_t vertexCount,
+                                std::size_t cacheSize = 16);
+}  // namespace abcg
+
+#endif
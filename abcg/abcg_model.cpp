@@ -0,0 +1,578 @@
+/**
+ * @file abcg_model.cpp
+ * @brief Definition of abcg::Model members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_model.hpp"
+
+#include <fmt/core.h>
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <cppitertools/itertools.hpp>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <map>
+#include <utility>
+
+#include "abcg_exception.hpp"
+#include "abcg_image.hpp"
+#include "abcg_meshnormals.hpp"
+#include "abcg_meshoptimizer.hpp"
+#include "abcg_openglfunctions.hpp"
+#include "abcg_pack.hpp"
+#include "abcg_vertexlayout.hpp"
+
+namespace {
+// Reads material files from mounted pack files, or else from the file system
+class PackedMaterialReader : public tinyobj::MaterialReader {
+ public:
+  explicit PackedMaterialReader(std::string basePath)
+      : m_basePath(std::move(basePath)), m_fileReader(m_basePath) {}
+
+  bool operator()(const std::string &matId,
+                  std::vector<tinyobj::material_t> *materials,
+                  std::map<std::string, int> *matMap, std::string *warn,
+                  std::string *err) override {
+    if (const auto asset{abcg::readPackedAsset(m_basePath + matId)}) {
+      abcg::AssetStreamBuffer buffer{asset->data()};
+      std::istream stream{&buffer};
+      tinyobj::LoadMtl(matMap, materials, &stream, warn, err);
+      return true;
+    }
+    return m_fileReader(matId, materials, matMap, warn, err);
+  }
+
+ private:
+  std::string m_basePath;
+  tinyobj::MaterialFileReader m_fileReader;
+};
+
+[[nodiscard]] bool isSameMaterial(const abcg::Material &a,
+                                  const abcg::Material &b) {
+  return a.Ka == b.Ka && a.Kd == b.Kd && a.Ks == b.Ks &&
+         a.shininess == b.shininess && a.diffuseTexture == b.diffuseTexture &&
+         a.normalTexture == b.normalTexture;
+}
+}  // namespace
+
+/**
+ * @brief Loads a model from a Wavefront OBJ file.
+ *
+ * Triangles of all shapes are grouped by material into submeshes. Each
+ * submesh gets its own chain of levels of detail, and the whole model is
+ * optimized for vertex cache, overdraw and vertex fetch. Normals and tangents
+ * are computed when missing.
+ *
+ * Diffuse textures (`map_Kd`) and normal maps (`norm` or `map_Bump`) are
+ * loaded once per file, even if used by several materials. Diffuse textures
+ * are packed into a texture atlas when possible (see loadDiffuseTextures()),
+ * and materials that end up with the same properties are merged into a
+ * single submesh.
+ *
+ * Must be called with an OpenGL context.
+ *
+ * @param path Path to the OBJ file. Material files are searched in the same
+ * directory.
+ *
+ * @throw abcg::Exception if the file cannot be loaded.
+ */
+void abcg::Model::loadObj(std::string_view path) {
+  destroy();
+
+  const auto basePath{std::filesystem::path{path}.parent_path().string() + "/"};
+  PackedMaterialReader materialReader{basePath};  // Path to material files
+
+  tinyobj::attrib_t attrib;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+  std::string warning;
+  std::string error;
+
+  // Read from a mounted pack file without copies, or else from the file
+  auto loaded{false};
+  if (const auto asset{readPackedAsset(path)}) {
+    AssetStreamBuffer buffer{asset->data()};
+    std::istream stream{&buffer};
+    loaded = tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error,
+                              &stream, &materialReader);
+  } else if (std::ifstream stream(path.data()); stream) {
+    loaded = tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error,
+                              &stream, &materialReader);
+  }
+
+  if (!loaded) {
+    if (!error.empty()) {
+      throw abcg::Exception{abcg::Exception::Runtime(
+          fmt::format("Failed to load model {} ({})", path, error))};
+    }
+    throw abcg::Exception{
+        abcg::Exception::Runtime(fmt::format("Failed to load model {}", path))};
+  }
+
+  if (!warning.empty()) {
+    fmt::print("Warning: {}\n", warning);
+  }
+
+  // Materials, plus a default one at the end for faces without material.
+  // Diffuse textures are loaded after the texture coordinates are known.
+  std::vector<std::string> diffusePaths;
+  for (const auto &mat : materials) {
+    Material material{
+        .name = mat.name,
+        .Ka = {mat.ambient[0], mat.ambient[1], mat.ambient[2], 1.0f},
+        .Kd = {mat.diffuse[0], mat.diffuse[1], mat.diffuse[2], 1.0f},
+        .Ks = {mat.specular[0], mat.specular[1], mat.specular[2], 1.0f},
+        .shininess = mat.shininess};
+    diffusePaths.push_back(
+        mat.diffuse_texname.empty() ? "" : basePath + mat.diffuse_texname);
+    // Tangent-space normal map from "norm" or, as exported by Blender,
+    // "map_Bump"
+    if (!mat.normal_texname.empty()) {
+      material.normalTexture = loadTexture(basePath + mat.normal_texname);
+    } else if (!mat.bump_texname.empty()) {
+      material.normalTexture = loadTexture(basePath + mat.bump_texname);
+    }
+    m_materials.push_back(material);
+  }
+  const auto defaultMaterial{m_materials.size()};
+  m_materials.push_back({.name = "default"});
+  diffusePaths.emplace_back();
+
+  // Indices of the triangles of each material
+  std::vector<std::vector<GLuint>> materialIndices(m_materials.size());
+
+  // A key:value map with key=Vertex and value=index
+  std::unordered_map<Vertex, GLuint> hash{};
+
+  for (const auto &shape : shapes) {
+    for (const auto offset : iter::range(shape.mesh.indices.size())) {
+      const tinyobj::index_t index{shape.mesh.indices.at(offset)};
+
+      Vertex vertex{};
+      const auto positionIndex{static_cast<std::size_t>(index.vertex_index)};
+      vertex.position = {attrib.vertices.at(3 * positionIndex + 0),
+                         attrib.vertices.at(3 * positionIndex + 1),
+                         attrib.vertices.at(3 * positionIndex + 2)};
+      if (index.normal_index >= 0) {
+        m_hasNormals = true;
+        const auto normalIndex{static_cast<std::size_t>(index.normal_index)};
+        vertex.normal = {attrib.normals.at(3 * normalIndex + 0),
+                         attrib.normals.at(3 * normalIndex + 1),
+                         attrib.normals.at(3 * normalIndex + 2)};
+      }
+      if (index.texcoord_index >= 0) {
+        m_hasTexCoords = true;
+        const auto texCoordIndex{
+            static_cast<std::size_t>(index.texcoord_index)};
+        vertex.texCoord = {attrib.texcoords.at(2 * texCoordIndex + 0),
+                           attrib.texcoords.at(2 * texCoordIndex + 1)};
+      }
+
+      // If hash doesn't contain this vertex
+      if (hash.count(vertex) == 0) {
+        hash[vertex] = static_cast<GLuint>(m_vertices.size());
+        m_vertices.push_back(vertex);
+      }
+
+      // Faces are triangulated by tinyobj
+      const auto materialId{shape.mesh.material_ids.at(offset / 3)};
+      const auto materialIndex{materialId >= 0
+                                   ? static_cast<std::size_t>(materialId)
+                                   : defaultMaterial};
+      materialIndices.at(materialIndex).push_back(hash[vertex]);
+    }
+  }
+
+  std::vector<GLuint> allIndices;
+  for (const auto &indices : materialIndices) {
+    allIndices.insert(allIndices.end(), indices.begin(), indices.end());
+  }
+  if (!m_hasNormals) {
+    computeNormals(m_vertices, allIndices, NormalWeighting::Angle);
+  }
+  if (m_hasTexCoords) {
+    computeTangents(m_vertices, allIndices);
+  }
+  loadDiffuseTextures(diffusePaths, materialIndices);
+
+  // Merge the triangles of materials with the same properties, so that they
+  // are drawn together
+  for (const auto index : iter::range(m_materials.size())) {
+    for (const auto other : iter::range(index)) {
+      if (!materialIndices.at(other).empty() &&
+          isSameMaterial(m_materials.at(index), m_materials.at(other))) {
+        auto &indices{materialIndices.at(other)};
+        indices.insert(indices.end(), materialIndices.at(index).begin(),
+                       materialIndices.at(index).end());
+        materialIndices.at(index).clear();
+        break;
+      }
+    }
+  }
+
+  // One submesh per material, each with its own levels of detail, all in the
+  // same index buffer
+  std::vector<MeshLOD> allLODs;
+  for (auto &&[materialIndex, indices] : iter::enumerate(materialIndices)) {
+    if (indices.empty()) continue;
+
+    Submesh submesh{.materialIndex = materialIndex,
+                    .lods = generateLODs(m_vertices, indices)};
+    for (auto &lod : submesh.lods) {
+      lod.firstIndex += m_indices.size();
+      allLODs.push_back(lod);
+    }
+    m_indices.insert(m_indices.end(), indices.begin(), indices.end());
+    m_submeshes.push_back(std::move(submesh));
+  }
+
+  // ACMR of the full detail of all submeshes, as drawn by render()
+  const auto computeFullDetailACMR{[this] {
+    float misses{};
+    std::size_t triangles{};
+    for (const auto &submesh : m_submeshes) {
+      const auto &lod{submesh.lods.front()};
+      const auto indices{
+          std::span{m_indices}.subspan(lod.firstIndex, lod.indexCount)};
+      misses += computeACMR(indices, m_vertices.size()) *
+                static_cast<float>(lod.indexCount / 3);
+      triangles += lod.indexCount / 3;
+    }
+    return triangles == 0 ? 0.0f : misses / static_cast<float>(triangles);
+  }};
+
+  // Reorder triangles and vertices for the post-transform cache, overdraw
+  // and vertex fetch
+  const auto acmrBefore{computeFullDetailACMR()};
+  optimizeMesh(m_vertices, m_indices, allLODs);
+  const auto acmrAfter{computeFullDetailACMR()};
+  fmt::print("ACMR of {}: {:.3f} before, {:.3f} after optimization\n", path,
+             acmrBefore, acmrAfter);
+
+  createBuffers();
+}
+
+GLuint abcg::Model::loadTexture(const std::string &path) {
+  if (!assetExists(path)) return 0;
+
+  if (auto it{m_textures.find(path)}; it != m_textures.end()) {
+    return it->second;
+  }
+  const auto texture{abcg::opengl::loadTexture(path)};
+  m_textures.emplace(path, texture);
+  return texture;
+}
+
+/**
+ * @brief Loads the diffuse textures of the materials.
+ *
+ * The textures of materials without normal maps and with texture coordinates
+ * in [0, 1] are packed into a single texture atlas, and the texture
+ * coordinates of their vertices are remapped to the atlas. Vertices shared
+ * with other materials are duplicated. The remaining textures, or all of them
+ * if there are fewer than two candidates or they do not fit in the atlas, are
+ * loaded individually.
+ *
+ * @param paths Path to the diffuse texture of each material, or an empty
+ * string if the material has no diffuse texture.
+ * @param materialIndices Indices of the triangles of each material.
+ */
+void abcg::Model::loadDiffuseTextures(
+    std::span<const std::string> paths,
+    std::vector<std::vector<GLuint>> &materialIndices) {
+  // Materials whose textures can be packed, and their atlas regions
+  constexpr auto noRegion{std::numeric_limits<std::size_t>::max()};
+  std::vector<std::size_t> materialRegion(m_materials.size(), noRegion);
+  std::vector<std::string_view> atlasPaths;
+  for (const auto &&[materialIndex, path] : iter::enumerate(paths)) {
+    const auto &indices{materialIndices.at(materialIndex)};
+    if (path.empty() || indices.empty() || !assetExists(path) ||
+        m_materials.at(materialIndex).normalTexture != 0) {
+      continue;
+    }
+    const auto inUnitSquare{std::ranges::all_of(indices, [&](auto index) {
+      const auto &texCoord{m_vertices.at(index).texCoord};
+      return texCoord.x >= 0.0f && texCoord.x <= 1.0f && texCoord.y >= 0.0f &&
+             texCoord.y <= 1.0f;
+    })};
+    if (!inUnitSquare) continue;
+
+    const auto it{std::ranges::find(atlasPaths, path)};
+    materialRegion.at(materialIndex) =
+        static_cast<std::size_t>(it - atlasPaths.begin());
+    if (it == atlasPaths.end()) atlasPaths.emplace_back(path);
+  }
+
+  if (atlasPaths.size() >= 2) {
+    try {
+      m_atlas = abcg::opengl::loadTextureAtlas(atlasPaths);
+    } catch (const abcg::Exception &exception) {
+      fmt::print("Warning: {}\n", exception.what());
+    }
+  }
+
+  if (m_atlas.texture == 0) {
+    for (const auto &&[material, path] : iter::zip(m_materials, paths)) {
+      if (!path.empty()) material.diffuseTexture = loadTexture(path);
+    }
+    return;
+  }
+
+  // Region of the texture coordinates of each vertex. Vertices of materials
+  // that are not in the atlas keep their texture coordinates.
+  constexpr auto unassigned{noRegion - 1};
+  std::vector<std::size_t> vertexRegion(m_vertices.size(), unassigned);
+  for (const auto &&[indices, region] :
+       iter::zip(materialIndices, materialRegion)) {
+    if (region != noRegion) continue;
+    for (const auto index : indices) vertexRegion.at(index) = noRegion;
+  }
+
+  const auto originalTexCoords{[&] {
+    std::vector<glm::vec2> texCoords;
+    texCoords.reserve(m_vertices.size());
+    for (const auto &vertex : m_vertices) texCoords.push_back(vertex.texCoord);
+    return texCoords;
+  }()};
+  std::map<std::pair<GLuint, std::size_t>, GLuint> duplicates;
+  for (const auto &&[material, path, indices, region] :
+       iter::zip(m_materials, paths, materialIndices, materialRegion)) {
+    if (region == noRegion) {
+      if (!path.empty()) material.diffuseTexture = loadTexture(path);
+      continue;
+    }
+
+    material.diffuseTexture = m_atlas.texture;
+    for (auto &index : indices) {
+      auto &currentRegion{vertexRegion.at(index)};
+      if (currentRegion == region) continue;
+      if (currentRegion == unassigned) {
+        currentRegion = region;
+        auto &texCoord{m_vertices.at(index).texCoord};
+        texCoord = m_atlas.remap(region, texCoord);
+        continue;
+      }
+
+      // Vertex already used with other texture coordinates
+      const auto key{std::pair{index, region}};
+      if (auto it{duplicates.find(key)}; it != duplicates.end()) {
+        index = it->second;
+        continue;
+      }
+      auto vertex{m_vertices.at(index)};
+      vertex.texCoord = m_atlas.remap(region, originalTexCoords.at(index));
+      const auto duplicate{static_cast<GLuint>(m_vertices.size())};
+      m_vertices.push_back(vertex);
+      duplicates.emplace(key, duplicate);
+      index = duplicate;
+    }
+  }
+}
+
+void abcg::Model::createBuffers() {
+  // Use 16-bit indices, split into meshlets if needed
+  const auto narrowed{narrowIndices(m_vertices, m_indices)};
+  m_meshlets = narrowed.meshlets;
+
+  createVertexBuffer();
+
+  // Generate EBO
+  abcg::glGenBuffers(1, &m_EBO);
+  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+  abcg::glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     static_cast<GLsizeiptr>(sizeof(narrowed.indices[0]) *
+                                             narrowed.indices.size()),
+                     narrowed.indices.data(), GL_STATIC_DRAW);
+  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void abcg::Model::createVertexBuffer() {
+  // Quantize vertices to less than half of their size
+  const auto quantized{quantizeVertices(m_vertices)};
+  m_dequantizationMatrix = quantized.getDequantizationMatrix();
+
+  // Generate VBO
+  abcg::glGenBuffers(1, &m_VBO);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  abcg::glBufferData(GL_ARRAY_BUFFER,
+                     static_cast<GLsizeiptr>(sizeof(quantized.vertices[0]) *
+                                             quantized.vertices.size()),
+                     quantized.vertices.data(), GL_STATIC_DRAW);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * @brief Creates the VAOs of the model for a shader program.
+ *
+ * @param program Shader program used to render the model.
+ */
+void abcg::Model::setupVAO(GLuint program) {
+  // Release previous VAOs
+  abcg::glDeleteVertexArrays(static_cast<GLsizei>(m_VAOs.size()),
+                             m_VAOs.data());
+
+  // Create one VAO per meshlet
+  m_VAOs.resize(m_meshlets.size());
+  abcg::glGenVertexArrays(static_cast<GLsizei>(m_VAOs.size()), m_VAOs.data());
+  for (const auto &&[VAO, meshlet] : iter::zip(m_VAOs, m_meshlets)) {
+    abcg::glBindVertexArray(VAO);
+
+    // Bind EBO and VBO
+    abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+    abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+
+    // Bind vertex attributes
+    abcg::opengl::setupVertexAttributes(program, getQuantizedVertexLayout(),
+                                        meshlet.baseVertex);
+
+    // End of binding
+    abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+    abcg::glBindVertexArray(0);
+  }
+
+  // Material uniforms
+  m_KaLocation = abcg::glGetUniformLocation(program, "Ka");
+  m_KdLocation = abcg::glGetUniformLocation(program, "Kd");
+  m_KsLocation = abcg::glGetUniformLocation(program, "Ks");
+  m_shininessLocation = abcg::glGetUniformLocation(program, "shininess");
+  m_diffuseTexLocation = abcg::glGetUniformLocation(program, "diffuseTex");
+  m_normalTexLocation = abcg::glGetUniformLocation(program, "normalTex");
+  m_normalMappingLocation =
+      abcg::glGetUniformLocation(program, "normalMapping");
+}
+
+void abcg::Model::bindMaterial(const Material &material,
+                               const Material *previous) const {
+  if (m_KaLocation >= 0) abcg::glUniform4fv(m_KaLocation, 1, &material.Ka.x);
+  if (m_KdLocation >= 0) abcg::glUniform4fv(m_KdLocation, 1, &material.Kd.x);
+  if (m_KsLocation >= 0) abcg::glUniform4fv(m_KsLocation, 1, &material.Ks.x);
+  if (m_shininessLocation >= 0) {
+    abcg::glUniform1f(m_shininessLocation, material.shininess);
+  }
+  if (m_diffuseTexLocation >= 0) abcg::glUniform1i(m_diffuseTexLocation, 0);
+  if (m_normalTexLocation >= 0) abcg::glUniform1i(m_normalTexLocation, 1);
+  if (m_normalMappingLocation >= 0) {
+    abcg::glUniform1i(m_normalMappingLocation,
+                      material.normalTexture != 0 ? 1 : 0);
+  }
+
+  // Skip texture binds of submeshes that share the atlas
+  if (previous == nullptr ||
+      previous->diffuseTexture != material.diffuseTexture) {
+    abcg::glActiveTexture(GL_TEXTURE0);
+    abcg::glBindTexture(GL_TEXTURE_2D, material.diffuseTexture);
+  }
+  if (previous == nullptr ||
+      previous->normalTexture != material.normalTexture) {
+    abcg::glActiveTexture(GL_TEXTURE1);
+    abcg::glBindTexture(GL_TEXTURE_2D, material.normalTexture);
+  }
+}
+
+/**
+ * @brief Renders the full-detail level of the model.
+ *
+ * Must be called with the program passed to setupVAO() in use.
+ *
+ * @param numTriangles Number of triangles to render, counted across
+ * submeshes. If negative, all triangles are rendered.
+ */
+void abcg::Model::render(int numTriangles) const {
+  auto remaining{numTriangles < 0 ? std::numeric_limits<std::size_t>::max()
+                                  : static_cast<std::size_t>(numTriangles) * 3};
+  const Material *previous{};
+  for (const auto &submesh : m_submeshes) {
+    if (remaining == 0) break;
+
+    const auto &lod{submesh.lods.front()};
+    const auto count{std::min(remaining, lod.indexCount)};
+    const auto &material{m_materials.at(submesh.materialIndex)};
+    bindMaterial(material, previous);
+    previous = &material;
+    abcg::opengl::drawMeshlets(m_VAOs, m_meshlets, lod.firstIndex, count);
+    remaining -= count;
+  }
+
+  abcg::glBindVertexArray(0);
+}
+
+/**
+ * @brief Renders the model with a level of detail chosen for each submesh.
+ *
+ * Must be called with the program passed to setupVAO() in use.
+ *
+ * @param selectLOD Function that returns the index of the level to render
+ * given the levels of a submesh (see abcg::selectLOD).
+ */
+void abcg::Model::render(const LODSelector &selectLOD) const {
+  const Material *previous{};
+  for (const auto &submesh : m_submeshes) {
+    const auto level{
+        std::min(selectLOD(submesh.lods), submesh.lods.size() - 1)};
+    const auto &lod{submesh.lods.at(level)};
+    const auto &material{m_materials.at(submesh.materialIndex)};
+    bindMaterial(material, previous);
+    previous = &material;
+    abcg::opengl::drawMeshlets(m_VAOs, m_meshlets, lod.firstIndex,
+                               lod.indexCount);
+  }
+
+  abcg::glBindVertexArray(0);
+}
+
+/**
+ * @brief Renders the triangles of the model without binding the materials.
+ *
+ * Used to draw the model with programs that do not shade it, e.g. into
+ * shadow maps (see abcg::CascadedShadowMap). The program must read
+ * `inPosition` at the location it had in the program passed to setupVAO().
+ *
+ * @param selectLOD Function that returns the index of the level to render
+ * given the levels of a submesh (see abcg::selectLOD).
+ */
+void abcg::Model::renderGeometry(const LODSelector &selectLOD) const {
+  for (const auto &submesh : m_submeshes) {
+    const auto level{
+        std::min(selectLOD(submesh.lods), submesh.lods.size() - 1)};
+    const auto &lod{submesh.lods.at(level)};
+    abcg::opengl::drawMeshlets(m_VAOs, m_meshlets, lod.firstIndex,
+                               lod.indexCount);
+  }
+
+  abcg::glBindVertexArray(0);
+}
+
+/**
+ * @brief Releases the OpenGL resources of the model.
+ *
+ */
+void abcg::Model::destroy() {
+  abcg::glDeleteTextures(1, &m_atlas.texture);
+  for (const auto &[path, texture] : m_textures) {
+    abcg::glDeleteTextures(1, &texture);
+  }
+  abcg::glDeleteBuffers(1, &m_EBO);
+  abcg::glDeleteBuffers(1, &m_VBO);
+  abcg::glDeleteVertexArrays(static_cast<GLsizei>(m_VAOs.size()),
+                             m_VAOs.data());
+
+  *this = Model{};
+}
+
+/**
+ * @brief Returns the number of triangles of the full-detail level.
+ *
+ * @return Number of triangles.
+ */
+int abcg::Model::getNumTriangles() const {
+  std::size_t count{};
+  for (const auto &submesh : m_submeshes) {
+    count += submesh.lods.front().indexCount / 3;
+  }
+  return static_cast<int>(count);
+}
@@ -0,0 +1,134 @@
+/**
+ * @file abcg_model.hpp
+ * @brief abcg::Model header file.
+ *
+ * Declaration of abcg::Model class, a mesh loaded from a Wavefront OBJ file
+ * or a glTF 2.0 file and drawn with one submesh per material.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MODEL_HPP_
+#define ABCG_MODEL_HPP_
+
+#include <abcg_external.hpp>
+#include <cstddef>
+#include <functional>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "abcg_image.hpp"
+#include "abcg_mesh.hpp"
+#include "abcg_meshlet.hpp"
+
+namespace abcg {
+class Model;
+struct Material;
+struct Submesh;
+}  // namespace abcg
+
+/**
+ * @brief Material properties of a submesh.
+ *
+ * Default values are used for triangles without a material.
+ */
+struct abcg::Material {
+  std::string name{};
+  glm::vec4 Ka{0.1f, 0.1f, 0.1f, 1.0f};
+  glm::vec4 Kd{0.7f, 0.7f, 0.7f, 1.0f};
+  glm::vec4 Ks{1.0f, 1.0f, 1.0f, 1.0f};
+  float shininess{25.0f};
+  GLuint diffuseTexture{};
+  GLuint normalTexture{};
+};
+
+/**
+ * @brief Triangles of a model that share the same material.
+ *
+ * `lods` are index ranges of the shared index buffer of the model, from the
+ * finest to the coarsest level of detail.
+ */
+struct abcg::Submesh {
+  std::size_t materialIndex{};
+  std::vector<MeshLOD> lods{};
+};
+
+/**
+ * @brief abcg::Model class.
+ *
+ * All submeshes share a single vertex buffer and a single 16-bit index
+ * buffer. Each submesh is drawn with one call per meshlet (usually one).
+ * Small diffuse textures are packed into a texture atlas, so materials that
+ * differ only by their diffuse texture are drawn as a single submesh.
+ *
+ * The shader program is expected to use the attributes of
+ * abcg::getQuantizedVertexLayout and the uniforms `modelMatrix`, `Ka`, `Kd`,
+ * `Ks`, `shininess`, `diffuseTex`, `normalTex` and `normalMapping`. Uniforms
+ * not found in the program are ignored. The model matrix passed to the shader
+ * must be multiplied by getDequantizationMatrix().
+ */
+class abcg::Model {
+ public:
+  using LODSelector = std::function<std::size_t(std::span<const MeshLOD>)>;
+
+  void load(std::string_view path);
+  void loadObj(std::string_view path);
+  void loadGLTF(std::string_view path);
+  void setupVAO(GLuint program);
+  void render(int numTriangles = -1) const;
+  void render(const LODSelector &selectLOD) const;
+  void renderGeometry(const LODSelector &selectLOD) const;
+  void destroy();
+
+  [[nodiscard]] int getNumTriangles() const;
+  [[nodiscard]] glm::mat4 getDequantizationMatrix() const {
+    return m_dequantizationMatrix;
+  }
+  [[nodiscard]] std::span<const Material> getMaterials() const {
+    return m_materials;
+  }
+  [[nodiscard]] std::span<const Submesh> getSubmeshes() const {
+    return m_submeshes;
+  }
+  [[nodiscard]] bool isUVMapped() const { return m_hasTexCoords; }
+
+ private:
+  std::vector<Vertex> m_vertices;
+  std::vector<GLuint> m_indices;
+  std::vector<Material> m_materials;
+  std::vector<Submesh> m_submeshes;
+  std::vector<Meshlet> m_meshlets;
+  glm::mat4 m_dequantizationMatrix{1.0f};
+
+  GLuint m_VBO{};
+  GLuint m_EBO{};
+  std::vector<GLuint> m_VAOs;
+  std::unordered_map<std::string, GLuint> m_textures;
+  TextureAtlas m_atlas;
+
+  GLint m_KaLocation{-1};
+  GLint m_KdLocation{-1};
+  GLint m_KsLocation{-1};
+  GLint m_shininessLocation{-1};
+  GLint m_diffuseTexLocation{-1};
+  GLint m_normalTexLocation{-1};
+  GLint m_normalMappingLocation{-1};
+
+  bool m_hasNormals{false};
+  bool m_hasTexCoords{false};
+
+  [[nodiscard]] GLuint loadTexture(const std::string &path);
+  void loadDiffuseTextures(std::span<const std::string> paths,
+                           std::vector<std::vector<GLuint>> &materialIndices);
+  void createBuffers();
+  void createVertexBuffer();
+  void bindMaterial(const Material &material,
+                    const Material *previous = nullptr) const;
+};
+
+#endif
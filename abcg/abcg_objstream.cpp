@@ -0,0 +1,374 @@
+/**
+ * @file abcg_objstream.cpp
+ * @brief Definition of the streaming Wavefront OBJ reader.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_objstream.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cppitertools/itertools.hpp>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "abcg_exception.hpp"
+#include "abcg_openglfunctions.hpp"
+#include "abcg_pack.hpp"
+#include "abcg_vertexlayout.hpp"
+
+namespace {
+// Indices of the position, texture coordinates and normal of a face vertex,
+// or -1 if absent
+struct CornerIndices {
+  int position{-1};
+  int texCoord{-1};
+  int normal{-1};
+
+  friend bool operator==(const CornerIndices &,
+                         const CornerIndices &) = default;
+};
+
+struct CornerIndicesHash {
+  std::size_t operator()(const CornerIndices &corner) const noexcept {
+    const std::size_t h1{std::hash<int>()(corner.position)};
+    const std::size_t h2{std::hash<int>()(corner.texCoord)};
+    const std::size_t h3{std::hash<int>()(corner.normal)};
+    return h1 ^ (h2 << 1) ^ (h3 << 2);
+  }
+};
+
+void skipSpaces(std::string_view &text) {
+  const auto start{text.find_first_not_of(" \t")};
+  text.remove_prefix(start == std::string_view::npos ? text.size() : start);
+}
+
+template <typename T>
+[[nodiscard]] std::optional<T> parseNumber(std::string_view &text) {
+  skipSpaces(text);
+  if (text.starts_with('+')) text.remove_prefix(1);
+  T value{};
+  const auto [end, error]{
+      std::from_chars(text.data(), text.data() + text.size(), value)};
+  if (error != std::errc{}) return std::nullopt;
+  text.remove_prefix(static_cast<std::size_t>(end - text.data()));
+  return value;
+}
+
+// Incremental parser of the lines of an OBJ file
+class ObjParser {
+ public:
+  explicit ObjParser(const abcg::ObjChunkCallback &onChunk)
+      : m_onChunk(onChunk) {}
+
+  void parseLine(std::string_view line);
+  void flush();
+
+ private:
+  const abcg::ObjChunkCallback &m_onChunk;
+
+  std::vector<glm::vec3> m_positions;
+  std::vector<glm::vec3> m_normals;
+  std::vector<glm::vec2> m_texCoords;
+
+  // Index of each distinct combination of attributes emitted so far
+  std::unordered_map<CornerIndices, GLuint, CornerIndicesHash> m_welded;
+  GLuint m_vertexCount{};
+
+  // Vertices and indices of the current chunk
+  std::vector<abcg::Vertex> m_vertices;
+  std::vector<GLuint> m_indices;
+  std::vector<GLuint> m_face;
+
+  [[nodiscard]] GLuint weld(std::string_view token);
+};
+
+void ObjParser::parseLine(std::string_view line) {
+  if (const auto comment{line.find('#')}; comment != std::string_view::npos) {
+    line = line.substr(0, comment);
+  }
+  skipSpaces(line);
+
+  const auto keywordEnd{std::min(line.find_first_of(" \t"), line.size())};
+  const auto keyword{line.substr(0, keywordEnd)};
+  auto arguments{line.substr(keywordEnd)};
+
+  // Missing components after the required ones are set to zero
+  const auto parseVector{[&](auto vector, int requiredComponents) {
+    for (const auto index : iter::range(vector.length())) {
+      if (const auto value{parseNumber<float>(arguments)}) {
+        vector[index] = *value;
+      } else if (index >= requiredComponents) {
+        break;
+      } else {
+        throw abcg::Exception{abcg::Exception::Runtime(
+            fmt::format("Invalid OBJ line: {}", line))};
+      }
+    }
+    return vector;
+  }};
+
+  if (keyword == "v") {
+    m_positions.push_back(parseVector(glm::vec3{}, 3));
+  } else if (keyword == "vn") {
+    m_normals.push_back(parseVector(glm::vec3{}, 3));
+  } else if (keyword == "vt") {
+    m_texCoords.push_back(parseVector(glm::vec2{}, 1));
+  } else if (keyword == "f") {
+    m_face.clear();
+    for (skipSpaces(arguments); !arguments.empty(); skipSpaces(arguments)) {
+      const auto tokenEnd{
+          std::min(arguments.find_first_of(" \t"), arguments.size())};
+      m_face.push_back(weld(arguments.substr(0, tokenEnd)));
+      arguments.remove_prefix(tokenEnd);
+    }
+
+    // Triangulate polygons as fans
+    for (const auto index : iter::range(std::size_t{2}, m_face.size())) {
+      m_indices.push_back(m_face[0]);
+      m_indices.push_back(m_face[index - 1]);
+      m_indices.push_back(m_face[index]);
+    }
+  }
+  // Other statements (groups, materials, lines, ...) are ignored
+}
+
+GLuint ObjParser::weld(std::string_view token) {
+  // Resolves a 1-based or negative (relative) index
+  const auto resolve{[&](std::string_view &text, std::size_t count) {
+    const auto index{parseNumber<int>(text)};
+    const auto resolved{!index       ? -1
+                        : *index < 0 ? static_cast<int>(count) + *index
+                                     : *index - 1};
+    if (resolved < 0 || static_cast<std::size_t>(resolved) >= count) {
+      throw abcg::Exception{abcg::Exception::Runtime(
+          fmt::format("Invalid OBJ face vertex: {}", token))};
+    }
+    return resolved;
+  }};
+
+  // v, v/vt, v//vn or v/vt/vn
+  CornerIndices corner;
+  auto text{token};
+  corner.position = resolve(text, m_positions.size());
+  if (text.starts_with('/')) {
+    text.remove_prefix(1);
+    if (!text.starts_with('/')) {
+      corner.texCoord = resolve(text, m_texCoords.size());
+    }
+    if (text.starts_with('/')) {
+      text.remove_prefix(1);
+      corner.normal = resolve(text, m_normals.size());
+    }
+  }
+
+  const auto [it, inserted]{m_welded.try_emplace(corner, m_vertexCount)};
+  if (inserted) {
+    abcg::Vertex vertex{};
+    vertex.position = m_positions[static_cast<std::size_t>(corner.position)];
+    if (corner.texCoord >= 0) {
+      vertex.texCoord = m_texCoords[static_cast<std::size_t>(corner.texCoord)];
+    }
+    if (corner.normal >= 0) {
+      vertex.normal = m_normals[static_cast<std::size_t>(corner.normal)];
+    }
+    m_vertices.push_back(vertex);
+    ++m_vertexCount;
+  }
+  return it->second;
+}
+
+void ObjParser::flush() {
+  if (m_vertices.empty() && m_indices.empty()) return;
+
+  m_onChunk(m_vertices, m_indices);
+  m_vertices.clear();
+  m_indices.clear();
+}
+
+// Appends data to a buffer object, reallocating it with geometric growth
+void appendToBuffer(GLuint &buffer, std::size_t &capacity, std::size_t size,
+                    std::span<const std::byte> data) {
+  if (size + data.size() > capacity) {
+    constexpr std::size_t minCapacity{std::size_t{1} << 16};
+    const auto newCapacity{
+        std::max({capacity * 2, size + data.size(), minCapacity})};
+
+    GLuint newBuffer{};
+    abcg::glGenBuffers(1, &newBuffer);
+    abcg::glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    abcg::glBufferData(GL_COPY_WRITE_BUFFER,
+                       static_cast<GLsizeiptr>(newCapacity), nullptr,
+                       GL_STATIC_DRAW);
+    if (size > 0) {
+      abcg::glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+      abcg::glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                                0, static_cast<GLsizeiptr>(size));
+      abcg::glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    abcg::glDeleteBuffers(1, &buffer);
+    buffer = newBuffer;
+    capacity = newCapacity;
+  }
+
+  abcg::glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  abcg::glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(size),
+                        static_cast<GLsizeiptr>(data.size()), data.data());
+  abcg::glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+}  // namespace
+
+/**
+ * @brief Reads a Wavefront OBJ file in chunks.
+ *
+ * The file is read `chunkSize` bytes at a time. After each chunk, the vertices
+ * first referenced by the faces of the chunk and the indices of these faces
+ * are passed to `onChunk`. Vertices with the same position, texture
+ * coordinates and normal indices are welded. Indices refer to all vertices
+ * emitted so far, so the vertices of each chunk must be appended to those of
+ * the previous chunks.
+ *
+ * Polygons are triangulated as fans. Materials, groups and other statements
+ * are ignored. Reads from a mounted pack file if it has the file.
+ *
+ * @param path Path to the OBJ file.
+ * @param onChunk Function called with the vertices and indices of each chunk.
+ * @param chunkSize Size of the chunks in bytes. Lines longer than a chunk are
+ * read in a single larger chunk.
+ *
+ * @throw abcg::Exception if the file cannot be read or is malformed.
+ */
+void abcg::readObjChunks(std::string_view path, const ObjChunkCallback &onChunk,
+                         std::size_t chunkSize) {
+  const auto asset{readPackedAsset(path)};
+  AssetStreamBuffer assetBuffer{asset ? asset->data()
+                                      : std::span<const std::byte>{}};
+  std::istream assetStream{&assetBuffer};
+  std::ifstream fileStream;
+  std::istream *stream{&assetStream};
+  if (!asset) {
+    fileStream.open(path.data(), std::ios::binary);
+    if (!fileStream) {
+      throw abcg::Exception{abcg::Exception::Runtime(
+          fmt::format("Failed to open model {}", path))};
+    }
+    stream = &fileStream;
+  }
+
+  ObjParser parser{onChunk};
+  std::vector<char> buffer(std::max(chunkSize, std::size_t{1}));
+  std::size_t carried{};
+  for (auto done{false}; !done;) {
+    // Grow the buffer if a single line does not fit
+    if (carried == buffer.size()) buffer.resize(buffer.size() * 2);
+
+    stream->read(buffer.data() + carried,
+                 static_cast<std::streamsize>(buffer.size() - carried));
+    const auto size{carried + static_cast<std::size_t>(stream->gcount())};
+    done = !*stream;
+
+    // Parse complete lines only, and carry the rest over to the next chunk
+    const std::string_view text{buffer.data(), size};
+    const auto lastNewline{text.rfind('\n')};
+    const auto end{done ? size
+                   : lastNewline == std::string_view::npos
+                       ? 0
+                       : lastNewline + 1};
+
+    for (auto lines{text.substr(0, end)}; !lines.empty();) {
+      const auto lineEnd{std::min(lines.find('\n'), lines.size())};
+      auto line{lines.substr(0, lineEnd)};
+      if (line.ends_with('\r')) line.remove_suffix(1);
+      parser.parseLine(line);
+      lines.remove_prefix(std::min(lineEnd + 1, lines.size()));
+    }
+    parser.flush();
+
+    carried = size - end;
+    std::memmove(buffer.data(), buffer.data() + end, carried);
+  }
+}
+
+/**
+ * @brief Imports a mesh from a Wavefront OBJ file in chunks.
+ *
+ * Must be called with an OpenGL context.
+ *
+ * @param path Path to the OBJ file.
+ * @param chunkSize Size of the chunks read from the file, in bytes.
+ *
+ * @throw abcg::Exception if the file cannot be read or is malformed.
+ *
+ * @sa abcg::readObjChunks
+ */
+void abcg::StreamedMesh::loadObj(std::string_view path,
+                                 std::size_t chunkSize) {
+  destroy();
+
+  readObjChunks(
+      path,
+      [&](std::span<const Vertex> vertices, std::span<const GLuint> indices) {
+        appendToBuffer(m_VBO, m_VBOCapacity, m_vertexCount * sizeof(Vertex),
+                       std::as_bytes(vertices));
+        appendToBuffer(m_EBO, m_EBOCapacity, m_indexCount * sizeof(GLuint),
+                       std::as_bytes(indices));
+        m_vertexCount += vertices.size();
+        m_indexCount += indices.size();
+      },
+      chunkSize);
+}
+
+/**
+ * @brief Creates the VAO of the mesh for a shader program.
+ *
+ * @param program Shader program used to render the mesh.
+ */
+void abcg::StreamedMesh::setupVAO(GLuint program) {
+  // Release previous VAO
+  abcg::glDeleteVertexArrays(1, &m_VAO);
+
+  abcg::glGenVertexArrays(1, &m_VAO);
+  abcg::glBindVertexArray(m_VAO);
+
+  // Bind EBO and VBO
+  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+
+  // Bind vertex attributes
+  abcg::opengl::setupVertexAttributes(program, getVertexLayout());
+
+  // End of binding
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+  abcg::glBindVertexArray(0);
+}
+
+/**
+ * @brief Renders the mesh.
+ *
+ * Must be called with the program passed to setupVAO() in use.
+ */
+void abcg::StreamedMesh::render() const {
+  abcg::glBindVertexArray(m_VAO);
+  abcg::glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(m_indexCount),
+                       GL_UNSIGNED_INT, nullptr);
+  abcg::glBindVertexArray(0);
+}
+
+/**
+ * @brief Releases the OpenGL resources of the mesh.
+ *
+ */
+void abcg::StreamedMesh::destroy() {
+  abcg::glDeleteBuffers(1, &m_EBO);
+  abcg::glDeleteBuffers(1, &m_VBO);
+  abcg::glDeleteVertexArrays(1, &m_VAO);
+
+  *this = StreamedMesh{};
+}
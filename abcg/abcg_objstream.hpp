@@ -0,0 +1,71 @@
+/**
+ * @file abcg_objstream.hpp
+ * @brief Declaration of the streaming Wavefront OBJ reader.
+ *
+ * Reads OBJ files in fixed-size chunks and emits welded vertices and indices
+ * as they are parsed, so that meshes much larger than the available memory
+ * can be uploaded to the GPU. Only the attribute arrays of the file and the
+ * table of welded vertices are kept in memory.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OBJSTREAM_HPP_
+#define ABCG_OBJSTREAM_HPP_
+
+#include <abcg_external.hpp>
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <string_view>
+
+#include "abcg_mesh.hpp"
+
+namespace abcg {
+class StreamedMesh;
+
+using ObjChunkCallback = std::function<void(std::span<const Vertex> vertices,
+                                            std::span<const GLuint> indices)>;
+
+constexpr std::size_t defaultObjChunkSize{std::size_t{1} << 20};
+
+void readObjChunks(std::string_view path, const ObjChunkCallback &onChunk,
+                   std::size_t chunkSize = defaultObjChunkSize);
+}  // namespace abcg
+
+/**
+ * @brief abcg::StreamedMesh class.
+ *
+ * Mesh imported with abcg::readObjChunks into a vertex buffer and a 32-bit
+ * index buffer that grow as chunks are read. The whole mesh is never held in
+ * client memory.
+ *
+ * Unlike abcg::Model, materials are ignored, and normals, tangents and levels
+ * of detail are not computed, since they need the whole mesh. The shader
+ * program is expected to use the attributes of abcg::getVertexLayout.
+ */
+class abcg::StreamedMesh {
+ public:
+  void loadObj(std::string_view path,
+               std::size_t chunkSize = defaultObjChunkSize);
+  void setupVAO(GLuint program);
+  void render() const;
+  void destroy();
+
+  [[nodiscard]] std::size_t getNumVertices() const { return m_vertexCount; }
+  [[nodiscard]] int getNumTriangles() const {
+    return static_cast<int>(m_indexCount / 3);
+  }
+
+ private:
+  GLuint m_VAO{};
+  GLuint m_VBO{};
+  GLuint m_EBO{};
+
+  std::size_t m_vertexCount{};
+  std::size_t m_indexCount{};
+  std::size_t m_VBOCapacity{};
+  std::size_t m_EBOCapacity{};
+};
+
+#endif
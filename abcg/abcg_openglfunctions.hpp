@@ -1265,6 +1265,22 @@ inline void glGetDoublev(GLenum pname, GLdouble* params,
 
 #endif
 
+#if !defined(__EMSCRIPTEN__)
+
+// OpenGL 3.3+ function definitions
+
+inline void glQueryCounter(GLuint id, GLenum target,
+                           const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, ::glQueryCounter, id, target);
+}
+
+inline void glGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64* params,
+                                  const sl& sourceLocation = sl::current()) {
+  callGL(sourceLocation, ::glGetQueryObjectui64v, id, pname, params);
+}
+
+#endif
+
 }  // namespace abcg
 
 #endif
\ No newline at end of file
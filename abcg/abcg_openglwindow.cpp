@@ -13,6 +13,7 @@
 #include <imgui_impl_sdl.h>
 
 #include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <regex>
 #include <sstream>
@@ -22,8 +23,25 @@
 #include "SDL_video.h"
 #include "abcg_application.hpp"
 #include "abcg_embeddedfonts.hpp"
+#include "abcg_pack.hpp"
 #include "abcg_string.hpp"
 
+namespace {
+// Reads a shader from a mounted pack file, or else from the file system
+bool readShaderSource(std::string_view path, std::stringstream &source) {
+  if (const auto asset{abcg::readPackedAsset(path)}) {
+    const auto data{asset->data()};
+    source.write(reinterpret_cast<const char *>(data.data()),
+                 static_cast<std::streamsize>(data.size()));
+    return true;
+  }
+
+  std::ifstream stream(path.data());
+  if (!stream) return false;
+  source << stream.rdbuf();
+  return true;
+}
+
 void printShaderInfoLog(GLuint shader, std::string_view prefix) {
   GLint infoLogLength{};
   glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLogLength);
@@ -48,6 +66,13 @@ void printProgramInfoLog(GLuint program) {
   }
 }
 
+// Event pushed by abcg::OpenGLWindow::requestRedraw to wake up the main loop
+Uint32 getRedrawEventType() {
+  static const auto type{SDL_RegisterEvents(1)};
+  return type;
+}
+}  // namespace
+
 ImVec4 ColorAlpha(const ImVec4 &color, float alpha) {
   return ImVec4(color.x, color.y, color.z, alpha);
 }
@@ -163,11 +188,16 @@ EM_BOOL abcg::fullscreenchangeCallback(
 
 abcg::OpenGLWindow::~OpenGLWindow() {
   if (m_window != nullptr) {
-    if (ImGui::GetCurrentContext() != nullptr) {
+    if (m_imGuiContext != nullptr) {
+      makeCurrent();
+      m_capture.reset();
       terminateGL();
+      m_postProcess.destroy();
+      m_sceneTarget.destroy();
+      m_gpuTimer.destroy();
       ImGui_ImplOpenGL3_Shutdown();
       ImGui_ImplSDL2_Shutdown();
-      ImGui::DestroyContext();
+      ImGui::DestroyContext(m_imGuiContext);
     }
 
     if (m_GLContext != nullptr) {
@@ -175,6 +205,9 @@ abcg::OpenGLWindow::~OpenGLWindow() {
     }
     SDL_DestroyWindow(m_window);
   }
+
+  // Pack files are mounted by the main window
+  if (m_mainWindow == nullptr) abcg::unmountPackFiles();
 }
 
 abcg::OpenGLSettings abcg::OpenGLWindow::getOpenGLSettings() noexcept {
@@ -215,9 +248,9 @@ void abcg::OpenGLWindow::paintUI() {
   if (m_windowSettings.showFPS) {
     float fps = ImGui::GetIO().Framerate;
 
-    static size_t offset{0};
-    static double refreshTime = ImGui::GetTime();
-    static std::array<float, 150> frames{};
+    auto &offset{m_fpsOffset};
+    auto &refreshTime{m_fpsRefreshTime};
+    auto &frames{m_fpsHistory};
 
     while (refreshTime < ImGui::GetTime()) {
       const auto refreshFrequency{60.0};
@@ -232,6 +265,10 @@ void abcg::OpenGLWindow::paintUI() {
                      ImGuiWindowFlags_NoBringToFrontOnFocus |
                      ImGuiWindowFlags_NoFocusOnAppearing);
     std::string label{fmt::format("avg {:.1f} FPS", fps)};
+    if (m_openGLSettings.dynamicResolution) {
+      label += fmt::format(", {:.0f}% res",
+                           m_resolutionScaler.getScale() * 100.0f);
+    }
     ImGui::PlotLines("", &frames[0], static_cast<int>(frames.size()),
                      static_cast<int>(offset), label.c_str(), 0.0f,
                      *std::max_element(frames.begin(), frames.end()) * 2,
@@ -281,23 +318,19 @@ void abcg::OpenGLWindow::resizeGL(int width, int height) {
 
 void abcg::OpenGLWindow::terminateGL() {}
 
+void abcg::OpenGLWindow::update([[maybe_unused]] double deltaTime) {}
+
 GLuint abcg::OpenGLWindow::createProgramFromFile(
     std::string_view pathToVertexShader,
     std::string_view pathToFragmentShader) {
   std::stringstream vertexShaderSource;
-  if (std::ifstream stream(pathToVertexShader.data()); stream) {
-    vertexShaderSource << stream.rdbuf();
-    stream.close();
-  } else {
+  if (!readShaderSource(pathToVertexShader, vertexShaderSource)) {
     throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
         "Failed to read vertex shader file {}", pathToVertexShader))};
   }
 
   std::stringstream fragmentShaderSource;
-  if (std::ifstream stream(pathToFragmentShader.data()); stream) {
-    fragmentShaderSource << stream.rdbuf();
-    stream.close();
-  } else {
+  if (!readShaderSource(pathToFragmentShader, fragmentShaderSource)) {
     throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
         "Failed to read fragment shader file {}", pathToFragmentShader))};
   }
@@ -395,12 +428,87 @@ GLuint abcg::OpenGLWindow::createProgramFromString(
 
 std::string abcg::OpenGLWindow::getAssetsPath() { return m_assetsPath; }
 
+abcg::Input &abcg::OpenGLWindow::getInput() { return m_input; }
+
+abcg::ResourceManager &abcg::OpenGLWindow::getResourceManager() {
+  return m_resourceManager;
+}
+
 double abcg::OpenGLWindow::getDeltaTime() const { return m_lastDeltaTime; }
 
 double abcg::OpenGLWindow::getElapsedTime() const {
+  if (m_fixedElapsedTime) return *m_fixedElapsedTime;
   return m_windowStartTime.elapsed();
 }
 
+double abcg::OpenGLWindow::getUpdateAlpha() const { return m_updateAlpha; }
+
+/**
+ * @brief Requests a new frame in on-demand rendering mode.
+ *
+ * Call this function when the contents of the window change without an
+ * input event, e.g. at the end of paintGL while an animation runs. It can be
+ * called from any thread.
+ *
+ * @sa abcg::OpenGLSettings::renderOnDemand.
+ */
+void abcg::OpenGLWindow::requestRedraw() {
+  // A single pending event per window is enough to wake up the main loop
+  const auto type{getRedrawEventType()};
+  std::array<SDL_Event, 16> pending{};
+  const auto count{SDL_PeepEvents(pending.data(),
+                                  static_cast<int>(pending.size()),
+                                  SDL_PEEKEVENT, type, type)};
+  if (std::any_of(pending.begin(), pending.begin() + std::max(count, 0),
+                  [this](const SDL_Event &pendingEvent) {
+                    return pendingEvent.user.windowID == m_windowID;
+                  })) {
+    return;
+  }
+
+  SDL_Event event{};
+  event.type = type;
+  event.user.windowID = m_windowID;
+  SDL_PushEvent(&event);
+}
+
+/**
+ * @brief Starts writing the frames of the window to image files or to a
+ * video.
+ *
+ * Frames are captured after paintUI and paintGL, including the ImGui
+ * widgets. With a fixed time step, abcg::OpenGLWindow::getDeltaTime and
+ * abcg::OpenGLWindow::getElapsedTime advance by the frame period of the
+ * video at each frame, so that animations in the video have the same speed
+ * as in the application however long each frame takes. Updates also follow
+ * this time.
+ *
+ * @param settings Capture settings.
+ *
+ * @throw abcg::Exception if the output cannot be opened.
+ *
+ * @sa abcg::FrameCapture.
+ */
+void abcg::OpenGLWindow::startCapture(const CaptureSettings &settings) {
+  stopCapture();
+  m_capture = std::make_unique<FrameCapture>(settings);
+}
+
+/**
+ * @brief Writes the remaining captured frames and stops capturing.
+ *
+ * @throw abcg::Exception if a frame could not be written.
+ */
+void abcg::OpenGLWindow::stopCapture() {
+  if (m_capture == nullptr) return;
+
+  makeCurrent();
+  // The window is back to real time
+  const auto capture{std::move(m_capture)};
+  if (capture->getSettings().fixedTimeStep) m_fixedElapsedTime.reset();
+  capture->finish();
+}
+
 void abcg::OpenGLWindow::toggleFullscreen() {
 #if defined(__EMSCRIPTEN__)
   EM_ASM(toggleFullscreen(););
@@ -430,6 +538,19 @@ void abcg::OpenGLWindow::toggleFullscreen() {
 }
 
 void abcg::OpenGLWindow::handleEvent(SDL_Event &event, bool &done) {
+  makeCurrent();
+
+  // The time spent waiting for events is not part of the next frame
+  if (m_openGLSettings.renderOnDemand && m_pendingFrames == 0) {
+    m_deltaTime.restart();
+  }
+
+  // ImGui may take a few frames to settle after an event, e.g. to size new
+  // windows
+  const auto framesAfterEvent{3};
+  m_pendingFrames = framesAfterEvent;
+  if (event.type == getRedrawEventType()) return;
+
   ImGui_ImplSDL2_ProcessEvent(&event);
 
   if (event.window.windowID != m_windowID) return;
@@ -502,12 +623,29 @@ void abcg::OpenGLWindow::handleEvent(SDL_Event &event, bool &done) {
   if (useCustomEventHandler) handleEvent(event);
 }
 
-void abcg::OpenGLWindow::initialize(std::string_view basePath) {
+void abcg::OpenGLWindow::initialize(std::string_view basePath,
+                                    OpenGLWindow *mainWindow) {
   m_deltaTime.restart();
   m_windowStartTime.restart();
+  m_mainWindow = mainWindow;
 
   m_assetsPath = std::string(basePath) + "/assets/";
 
+  // Read assets from a pack file, if any (see abcg::writePackFile)
+  if (const auto packPath{std::string(basePath) + "/assets.pack"};
+      m_mainWindow == nullptr && std::ifstream{packPath}) {
+    abcg::mountPackFile(packPath, m_assetsPath);
+  }
+
+  // Contexts that share objects must have the same version
+  if (m_mainWindow != nullptr) {
+    m_openGLSettings.profile = m_mainWindow->m_openGLSettings.profile;
+    m_openGLSettings.majorVersion =
+        m_mainWindow->m_openGLSettings.majorVersion;
+    m_openGLSettings.minorVersion =
+        m_mainWindow->m_openGLSettings.minorVersion;
+  }
+
 #if defined(__EMSCRIPTEN__)
   if (m_openGLSettings.preserveWebGLDrawingBuffer) {
     emscripten_run_script(
@@ -569,7 +707,9 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
   SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
   SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, m_openGLSettings.depthBufferSize);
   SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, m_openGLSettings.stencilSize);
-  if (m_openGLSettings.samples > 0) {
+  // With dynamic resolution, the samples are taken by the scene target, and
+  // the window framebuffer must be single-sampled to be blitted to
+  if (m_openGLSettings.samples > 0 && !m_openGLSettings.dynamicResolution) {
     // Enable multisample
     SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
     // Can be 2, 4, 8 or 16
@@ -584,7 +724,8 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
                                 SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
                                 m_windowSettings.width, m_windowSettings.height,
                                 SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE);
-    if (m_window == nullptr && m_openGLSettings.samples > 0) {
+    if (m_window == nullptr && m_openGLSettings.samples > 0 &&
+        !m_openGLSettings.dynamicResolution) {
       // Try again, but this time with multisampling disabled
       m_openGLSettings.samples = 0;
       SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 0);
@@ -606,14 +747,26 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
                                            fullscreenchangeCallback);
 #endif
 
-  // Create OpenGL context
+  // Create OpenGL context, sharing the objects of the main window
+  if (m_mainWindow != nullptr) {
+    SDL_GL_MakeCurrent(m_mainWindow->m_window, m_mainWindow->m_GLContext);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+  } else {
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+  }
   m_GLContext = SDL_GL_CreateContext(m_window);
   if (m_GLContext == nullptr) {
     throw abcg::Exception{abcg::Exception::SDL("SDL_GL_CreateContext failed")};
   }
 
 #if !defined(__EMSCRIPTEN__)
-  SDL_GL_SetSwapInterval(m_openGLSettings.vsync ? 1 : 0);  // Disable vsync
+  if (!m_openGLSettings.vsync) {
+    SDL_GL_SetSwapInterval(0);
+  } else if (!m_openGLSettings.adaptiveVsync ||
+             SDL_GL_SetSwapInterval(-1) != 0) {
+    // Adaptive vsync is not supported by all drivers
+    SDL_GL_SetSwapInterval(1);
+  }
 #endif
 
 #if !defined(__EMSCRIPTEN__)
@@ -630,10 +783,13 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
   fmt::print("OpenGL renderer: {}\n", glGetString(GL_RENDERER));
   fmt::print("OpenGL version.: {}\n", glGetString(GL_VERSION));
   fmt::print("GLSL version...: {}\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
+  m_gpuTiming = abcg::GPUTimer::isSupported();
 
   // Setup Dear ImGui context
   IMGUI_CHECKVERSION();
-  ImGui::CreateContext();
+  m_imGuiContext = ImGui::CreateContext();
+  ImGui::SetCurrentContext(m_imGuiContext);
+  m_input.m_windowID = m_windowID;
   ImGuiIO &io{ImGui::GetIO()};
   // Enable keyboard vontrols
   io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
@@ -663,6 +819,18 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
     throw abcg::Exception{abcg::Exception::Runtime("Failed to load font file")};
   }
 
+  m_resourceManager.setProgramFactory(
+      [this](std::string_view pathToVertexShader,
+             std::string_view pathToFragmentShader) {
+        return createProgramFromFile(pathToVertexShader, pathToFragmentShader);
+      });
+  // Windows share the textures and programs of the main window, since their
+  // contexts share OpenGL objects. Models are not shared, since their VAOs
+  // belong to the context of each window
+  if (m_mainWindow != nullptr) {
+    m_resourceManager.shareWith(m_mainWindow->m_resourceManager);
+  }
+
   initializeGL();
 
   if (io.DisplaySize.x >= 0 && io.DisplaySize.y >= 0) {
@@ -672,12 +840,24 @@ void abcg::OpenGLWindow::initialize(std::string_view basePath) {
     m_viewportHeight = height;
     resizeGL(width, height);
   } else {
+    // The scene target of dynamic resolution is sized from the viewport
+    // before any resize event arrives
+    m_viewportWidth = m_windowSettings.width;
+    m_viewportHeight = m_windowSettings.height;
     resizeGL(m_windowSettings.width, m_windowSettings.height);
   }
 }
 
+// Makes the OpenGL and ImGui contexts of the window current
+void abcg::OpenGLWindow::makeCurrent() {
+  if (SDL_GL_GetCurrentContext() != m_GLContext) {
+    SDL_GL_MakeCurrent(m_window, m_GLContext);
+  }
+  ImGui::SetCurrentContext(m_imGuiContext);
+}
+
 void abcg::OpenGLWindow::paint() {
-  SDL_GL_MakeCurrent(m_window, m_GLContext);
+  makeCurrent();
 
 #if defined(__EMSCRIPTEN__)
   // Force window size in windowed mode
@@ -689,18 +869,177 @@ void abcg::OpenGLWindow::paint() {
   }
 #endif
 
+  m_paintTime.restart();
+  runUpdates();
+  if (m_pendingFrames > 0) --m_pendingFrames;
+
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplSDL2_NewFrame();
   ImGui::NewFrame();
   paintUI();
   ImGui::Render();
+  m_wantTextInput = ImGui::GetIO().WantTextInput;
+  beginScene();
   paintGL();
+  endScene();
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  m_gpuTimer.end();
+  captureFrame();
   SDL_GL_SwapWindow(m_window);
+  m_input.endFrame();
+  if (m_openGLSettings.dynamicResolution) {
+    updateResolutionScale(m_paintTime.elapsed());
+  }
 
-  // Cap to 480 Hz
-  if (m_deltaTime.elapsed() >= 1.0 / 480.0) {
-    m_lastDeltaTime = m_deltaTime.restart();
-  } else
-    m_lastDeltaTime = 0.0;
-}
\ No newline at end of file
+  m_lastDeltaTime = m_deltaTime.restart();
+  if (m_capture != nullptr && m_capture->getSettings().fixedTimeStep) {
+    m_lastDeltaTime = 1.0 / m_capture->getSettings().frameRate;
+    m_fixedElapsedTime = getElapsedTime() + m_lastDeltaTime;
+  }
+
+  // Late frames start a new schedule instead of rushing the next frames
+  m_nextFrameTime = std::max(m_nextFrameTime + getFrameInterval(),
+                             clock::now());
+}
+
+// Calls update() with a fixed time step for the time of the last frame. The
+// time left over is kept for the next frame and gives the interpolation
+// factor between the last two updates.
+void abcg::OpenGLWindow::runUpdates() {
+  if (m_windowSettings.updateRate <= 0.0) {
+    m_updateTime = 0.0;
+    m_updateAlpha = 1.0;
+    return;
+  }
+
+  // Slow frames drop time instead of running more updates, which would make
+  // the next frames even slower
+  const auto maxUpdatesPerFrame{8};
+  const auto timeStep{1.0 / m_windowSettings.updateRate};
+  m_updateTime =
+      std::min(m_updateTime + m_lastDeltaTime, maxUpdatesPerFrame * timeStep);
+
+  while (m_updateTime >= timeStep) {
+    update(timeStep);
+    m_updateTime -= timeStep;
+  }
+  m_updateAlpha = m_updateTime / timeStep;
+}
+
+// Minimum time between frames, from the frame rate settings
+abcg::OpenGLWindow::clock::duration abcg::OpenGLWindow::getFrameInterval()
+    const {
+#if defined(__EMSCRIPTEN__)
+  // The browser schedules the frames
+  return clock::duration::zero();
+#else
+  auto frameRate{m_openGLSettings.maxFrameRate};
+  if (const auto hiddenFlags{SDL_WINDOW_MINIMIZED | SDL_WINDOW_HIDDEN};
+      m_openGLSettings.idleFrameRate > 0 &&
+      (SDL_GetWindowFlags(m_window) & hiddenFlags) != 0) {
+    frameRate = m_openGLSettings.idleFrameRate;
+  }
+  if (frameRate <= 0) return clock::duration::zero();
+  return std::chrono::duration_cast<clock::duration>(
+      std::chrono::duration<double>{1.0 / frameRate});
+#endif
+}
+
+// Time when the window must be painted next, or nothing if it waits for an
+// event in on-demand rendering mode
+std::optional<abcg::OpenGLWindow::clock::time_point>
+abcg::OpenGLWindow::getNextFrameTime() const {
+  if (m_openGLSettings.renderOnDemand && m_pendingFrames == 0) {
+    if (!m_wantTextInput) return std::nullopt;
+    // Keep the text cursor blinking
+    return m_nextFrameTime + std::chrono::milliseconds{400};
+  }
+  return m_nextFrameTime;
+}
+
+// Captures the frame before the buffer swap
+void abcg::OpenGLWindow::captureFrame() {
+  if (m_capture == nullptr) return;
+
+  int width{};
+  int height{};
+  SDL_GL_GetDrawableSize(m_window, &width, &height);
+  m_capture->capture(width, height);
+}
+
+// Binds the offscreen target of paintGL, if the scene is scaled or
+// post-processed, and starts timing the frame
+void abcg::OpenGLWindow::beginScene() {
+  m_sceneTargetBound = m_openGLSettings.dynamicResolution ||
+                       m_postProcess.hasEnabledPasses();
+  if (!m_sceneTargetBound) {
+    m_renderWidth = m_viewportWidth;
+    m_renderHeight = m_viewportHeight;
+    return;
+  }
+
+  if (m_openGLSettings.dynamicResolution && m_gpuTiming) m_gpuTimer.begin();
+
+  const auto scale{m_openGLSettings.dynamicResolution
+                       ? m_resolutionScaler.getScale()
+                       : 1.0f};
+  const auto scaleSize{[scale](int size) {
+    return std::max(static_cast<int>(std::lround(static_cast<float>(size) *
+                                                 scale)),
+                    1);
+  }};
+  m_renderWidth = scaleSize(m_viewportWidth);
+  m_renderHeight = scaleSize(m_viewportHeight);
+
+  if (m_sceneTarget.getFramebuffer() == 0) {
+    GLenum depthFormat{GL_NONE};
+    if (m_openGLSettings.depthBufferSize > 0) {
+      depthFormat = m_openGLSettings.stencilSize > 0 ? GL_DEPTH24_STENCIL8
+                                                     : GL_DEPTH_COMPONENT24;
+    }
+    m_sceneTarget.create(m_renderWidth, m_renderHeight,
+                         {.depthFormat = depthFormat,
+                          .samples = m_openGLSettings.samples});
+  } else {
+    m_sceneTarget.resize(m_renderWidth, m_renderHeight);
+  }
+  m_sceneTarget.bind();
+}
+
+// Upscales or post-processes the output of paintGL to the window
+// framebuffer, where ImGui is drawn at native resolution
+void abcg::OpenGLWindow::endScene() {
+  if (!m_sceneTargetBound) return;
+
+  m_sceneTarget.resolve();
+  if (m_postProcess.hasEnabledPasses()) {
+    m_postProcess.apply(m_sceneTarget.getColorTexture(),
+                        m_sceneTarget.getWidth(), m_sceneTarget.getHeight(),
+                        0, m_viewportWidth, m_viewportHeight);
+  } else {
+    m_sceneTarget.blit(0, m_viewportWidth, m_viewportHeight);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+}
+
+// Adjusts the resolution scale to the GPU time of the latest finished
+// frame, or to the time taken to paint the last frame where timer queries
+// are not supported
+void abcg::OpenGLWindow::updateResolutionScale(double paintTime) {
+  auto frameRate{m_openGLSettings.targetFrameRate};
+  if (frameRate <= 0) frameRate = m_openGLSettings.maxFrameRate;
+  if (frameRate <= 0) frameRate = 60;
+  m_resolutionScaler.setSettings(
+      {.minScale = m_openGLSettings.minResolutionScale,
+       .targetFrameTime = 1.0 / frameRate});
+
+  // Captured frames must not depend on the speed of the machine
+  if (m_capture != nullptr) return;
+
+  if (!m_gpuTiming) {
+    m_resolutionScaler.update(paintTime);
+  } else if (const auto gpuTime{m_gpuTimer.poll()}) {
+    m_resolutionScaler.update(*gpuTime);
+  }
+}
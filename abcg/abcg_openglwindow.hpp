@@ -10,10 +10,21 @@
 #ifndef ABCG_OPENGLWINDOW_HPP_
 #define ABCG_OPENGLWINDOW_HPP_
 
+#include <array>
+#include <chrono>
+#include <memory>
+#include <optional>
 #include <string>
 
+#include "abcg_capture.hpp"
 #include "abcg_elapsedtimer.hpp"
+#include "abcg_gputimer.hpp"
+#include "abcg_input.hpp"
 #include "abcg_openglfunctions.hpp"
+#include "abcg_postprocess.hpp"
+#include "abcg_rendertarget.hpp"
+#include "abcg_resolutionscaler.hpp"
+#include "abcg_resourcemanager.hpp"
 
 namespace abcg {
 enum class OpenGLProfile;
@@ -28,6 +39,8 @@ EM_BOOL fullscreenchangeCallback(int eventType,
 #endif
 }  // namespace abcg
 
+struct ImGuiContext;
+
 /**
  * @brief Enumeration of OpenGL profiles.
  *
@@ -43,6 +56,27 @@ struct alignas(32) abcg::OpenGLSettings {
   int samples{0};
   bool vsync{false};
   bool preserveWebGLDrawingBuffer{false};
+  // With vsync, present late frames immediately instead of waiting for the
+  // next vertical blank, if supported
+  bool adaptiveVsync{false};
+  // Maximum frames per second. Zero disables the frame limiter
+  int maxFrameRate{0};
+  // Frames per second while the window is minimized or hidden. Zero disables
+  // the idle mode
+  int idleFrameRate{10};
+  // Render only after events, while ImGui animates, or when
+  // OpenGLWindow::requestRedraw is called
+  bool renderOnDemand{false};
+  // Render paintGL into an offscreen target whose size is scaled between
+  // minResolutionScale and 100% of the viewport to hold targetFrameRate,
+  // measured in GPU time where timer queries are supported. The scene is
+  // upscaled before ImGui is drawn at native resolution, and samples apply
+  // to the offscreen target. Set before the window is created
+  bool dynamicResolution{false};
+  float minResolutionScale{0.5f};
+  // Frame rate held by the dynamic resolution. Zero uses maxFrameRate, or
+  // 60 if there is no limit
+  int targetFrameRate{0};
 };
 
 struct alignas(64) abcg::WindowSettings {
@@ -50,6 +84,8 @@ struct alignas(64) abcg::WindowSettings {
   int height{600};
   bool showFPS{true};
   bool showFullscreenButton{true};
+  // Calls per second of OpenGLWindow::update. Zero disables the updates
+  double updateRate{60.0};
   std::string title{"ABCg Window"};
 };
 
@@ -79,6 +115,7 @@ class abcg::OpenGLWindow {
   virtual void paintUI();
   virtual void resizeGL(int width, int height);
   virtual void terminateGL();
+  virtual void update(double deltaTime);
 
   [[nodiscard]] GLuint createProgramFromFile(
       std::string_view pathToVertexShader,
@@ -87,14 +124,37 @@ class abcg::OpenGLWindow {
       std::string_view vertexShaderSource,
       std::string_view fragmentShaderSource);
   std::string getAssetsPath();
+  [[nodiscard]] Input& getInput();
+  [[nodiscard]] ResourceManager& getResourceManager();
   [[nodiscard]] double getDeltaTime() const;
   [[nodiscard]] double getElapsedTime() const;
+  [[nodiscard]] double getUpdateAlpha() const;
+  void requestRedraw();
   void toggleFullscreen();
+  void startCapture(const CaptureSettings& settings);
+  void stopCapture();
+  [[nodiscard]] bool isCapturing() const { return m_capture != nullptr; }
+  // Passes applied to the output of paintGL before ImGui is drawn
+  [[nodiscard]] PostProcess& getPostProcess() { return m_postProcess; }
+  // Size of the framebuffer drawn by paintGL, a fraction of the viewport
+  // size with dynamic resolution
+  [[nodiscard]] int getRenderWidth() const { return m_renderWidth; }
+  [[nodiscard]] int getRenderHeight() const { return m_renderHeight; }
 
  private:
+  using clock = std::chrono::steady_clock;
+
   void handleEvent(SDL_Event& event, bool& done);
-  void initialize(std::string_view basePath);
+  void initialize(std::string_view basePath, OpenGLWindow* mainWindow);
+  void makeCurrent();
   void paint();
+  void runUpdates();
+  [[nodiscard]] clock::duration getFrameInterval() const;
+  [[nodiscard]] std::optional<clock::time_point> getNextFrameTime() const;
+  void captureFrame();
+  void beginScene();
+  void endScene();
+  void updateResolutionScale(double paintTime);
 
   WindowSettings m_windowSettings{};
   OpenGLSettings m_openGLSettings{};
@@ -102,8 +162,16 @@ class abcg::OpenGLWindow {
   std::string m_assetsPath{};
   std::string m_GLSLVersion{};
 
+  ResourceManager m_resourceManager;
+  Input m_input;
+
+  // Window whose OpenGL objects and resources are shared, if this is not the
+  // main window
+  OpenGLWindow* m_mainWindow{};
+
   SDL_Window* m_window{};
   SDL_GLContext m_GLContext{};
+  ImGuiContext* m_imGuiContext{};
   Uint32 m_windowID{};
 
   int m_viewportWidth{};
@@ -112,6 +180,34 @@ class abcg::OpenGLWindow {
   ElapsedTimer m_deltaTime;
   ElapsedTimer m_windowStartTime;
   double m_lastDeltaTime{0.0};
+  // Elapsed time of the frame when the time is not the real time, i.e.,
+  // while playing back a recording or capturing with a fixed time step
+  std::optional<double> m_fixedElapsedTime;
+  double m_updateTime{0.0};
+  double m_updateAlpha{0.0};
+  // Frames still to be rendered in on-demand mode
+  int m_pendingFrames{};
+  bool m_wantTextInput{};
+  clock::time_point m_nextFrameTime{};
+
+  // FPS counter
+  std::array<float, 150> m_fpsHistory{};
+  std::size_t m_fpsOffset{};
+  double m_fpsRefreshTime{};
+
+  std::unique_ptr<FrameCapture> m_capture;
+
+  // Offscreen target of paintGL, used with dynamic resolution or
+  // post-processing passes
+  RenderTarget m_sceneTarget;
+  PostProcess m_postProcess;
+  bool m_sceneTargetBound{};
+  int m_renderWidth{};
+  int m_renderHeight{};
+  ResolutionScaler m_resolutionScaler;
+  GPUTimer m_gpuTimer;
+  bool m_gpuTiming{};
+  ElapsedTimer m_paintTime;
 
   friend Application;
 
@@ -0,0 +1,564 @@
+/**
+ * @file abcg_pack.cpp
+ * @brief Definition of asset pack files.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_pack.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <ranges>
+
+#include "abcg_exception.hpp"
+
+#if !defined(__EMSCRIPTEN__) && (defined(__unix__) || defined(__APPLE__))
+#define ABCG_PACK_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// Layout of a pack file (all integers are little-endian):
+//
+// Header (32 bytes):
+//   char[8] magic, u32 version, u32 entry count, u64 index offset,
+//   u64 index size
+// Data of each entry, aligned to 16 bytes
+// Index, one record per entry:
+//   u64 offset, u64 stored size, u64 size, u32 flags, u32 path length,
+//   path (without null terminator)
+constexpr std::array magic{'A', 'B', 'C', 'G', 'P', 'A', 'C', 'K'};
+constexpr std::uint32_t version{1};
+constexpr std::uint64_t headerSize{32};
+constexpr std::uint64_t alignment{16};
+constexpr std::uint32_t compressedFlag{1};
+
+template <typename T>
+void appendValue(std::vector<std::byte> &bytes, T value) {
+  const auto size{bytes.size()};
+  bytes.resize(size + sizeof(T));
+  std::memcpy(&bytes[size], &value, sizeof(T));
+}
+
+template <typename T>
+[[nodiscard]] T readValue(std::span<const std::byte> bytes,
+                          std::uint64_t &offset) {
+  if (offset + sizeof(T) > bytes.size()) {
+    throw abcg::Exception{abcg::Exception::Runtime("Truncated pack file")};
+  }
+  T value{};
+  std::memcpy(&value, &bytes[offset], sizeof(T));
+  offset += sizeof(T);
+  return value;
+}
+
+[[nodiscard]] std::vector<std::byte> readFile(
+    const std::filesystem::path &path) {
+  std::ifstream stream(path, std::ios::binary | std::ios::ate);
+  if (!stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to read file {}", path.string()))};
+  }
+  std::vector<std::byte> contents(static_cast<std::size_t>(stream.tellg()));
+  stream.seekg(0);
+  stream.read(reinterpret_cast<char *>(contents.data()),
+              static_cast<std::streamsize>(contents.size()));
+  return contents;
+}
+
+// LZ4 block format constants
+constexpr std::size_t minMatch{4};
+constexpr std::size_t lastLiterals{5};
+constexpr std::size_t matchFindLimit{12};
+constexpr std::size_t maxOffset{65535};
+constexpr int hashBits{12};
+
+[[nodiscard]] std::uint32_t read32(std::span<const std::byte> bytes,
+                                   std::size_t offset) {
+  std::uint32_t value{};
+  std::memcpy(&value, &bytes[offset], sizeof(value));
+  return value;
+}
+
+// Writes a length of a sequence: 15 in the token, then bytes of 255 and the
+// remainder
+void appendLength(std::vector<std::byte> &output, std::size_t length) {
+  for (length -= 15; length >= 255; length -= 255) {
+    output.push_back(std::byte{255});
+  }
+  output.push_back(static_cast<std::byte>(length));
+}
+
+void appendSequence(std::vector<std::byte> &output,
+                    std::span<const std::byte> literals, std::size_t offset,
+                    std::size_t matchLength) {
+  const auto literalToken{std::min<std::size_t>(literals.size(), 15)};
+  const auto matchToken{
+      matchLength == 0 ? 0 : std::min<std::size_t>(matchLength - minMatch, 15)};
+  output.push_back(static_cast<std::byte>((literalToken << 4) | matchToken));
+  if (literalToken == 15) appendLength(output, literals.size());
+  output.insert(output.end(), literals.begin(), literals.end());
+
+  // The last sequence has only literals
+  if (matchLength == 0) return;
+
+  output.push_back(static_cast<std::byte>(offset & 0xFFU));
+  output.push_back(static_cast<std::byte>(offset >> 8));
+  if (matchToken == 15) appendLength(output, matchLength - minMatch);
+}
+
+struct MountedPack {
+  std::filesystem::path root;
+  std::unique_ptr<abcg::PackFile> pack;
+};
+
+std::vector<MountedPack> &getMountedPacks() {
+  static std::vector<MountedPack> packs;
+  return packs;
+}
+
+// Path of an asset relative to the mount path of a pack, or an empty string
+// if the asset is not under the mount path
+[[nodiscard]] std::string getEntryName(const std::filesystem::path &root,
+                                       std::string_view path) {
+  const auto relative{
+      std::filesystem::path{path}.lexically_normal().lexically_relative(root)};
+  if (relative.empty() || *relative.begin() == "..") return {};
+  return relative.generic_string();
+}
+}  // namespace
+
+/**
+ * @brief Compresses data with the LZ4 block format.
+ *
+ * Uses a greedy parse with a single-entry hash table, which favors speed of
+ * compression over ratio. The output can be decompressed by any LZ4 block
+ * decoder.
+ *
+ * @param source Data to compress.
+ *
+ * @return Compressed data.
+ */
+std::vector<std::byte> abcg::compressLZ4(std::span<const std::byte> source) {
+  std::vector<std::byte> output;
+  output.reserve(source.size() + source.size() / 255 + 16);
+
+  std::size_t anchor{};
+  if (source.size() > matchFindLimit) {
+    // Position plus one of the last occurrence of each hashed 4-byte sequence
+    std::vector<std::size_t> table(std::size_t{1} << hashBits);
+    const auto limit{source.size() - matchFindLimit};
+
+    std::size_t position{};
+    while (position < limit) {
+      const auto sequence{read32(source, position)};
+      const auto hash{(sequence * 2654435761U) >> (32 - hashBits)};
+      const auto candidate{table[hash]};
+      table[hash] = position + 1;
+
+      if (candidate == 0 || position - (candidate - 1) > maxOffset ||
+          read32(source, candidate - 1) != sequence) {
+        ++position;
+        continue;
+      }
+
+      // Extend the match, leaving the last bytes as literals
+      const auto match{candidate - 1};
+      const auto maxLength{source.size() - lastLiterals - position};
+      auto length{minMatch};
+      while (length < maxLength &&
+             source[match + length] == source[position + length]) {
+        ++length;
+      }
+
+      appendSequence(output, source.subspan(anchor, position - anchor),
+                     position - match, length);
+      position += length;
+      anchor = position;
+    }
+  }
+
+  appendSequence(output, source.subspan(anchor), 0, 0);
+  return output;
+}
+
+/**
+ * @brief Decompresses data in the LZ4 block format.
+ *
+ * @param source Compressed data.
+ * @param destination Buffer with the exact size of the decompressed data.
+ *
+ * @throw abcg::Exception if the compressed data is malformed.
+ */
+void abcg::decompressLZ4(std::span<const std::byte> source,
+                         std::span<std::byte> destination) {
+  const auto malformed{[] {
+    return abcg::Exception{abcg::Exception::Runtime("Malformed LZ4 data")};
+  }};
+
+  std::size_t input{};
+  std::size_t output{};
+  const auto readLength{[&](std::size_t length) {
+    if (length != 15) return length;
+    std::byte byte{};
+    do {
+      if (input >= source.size()) throw malformed();
+      byte = source[input++];
+      length += static_cast<std::size_t>(byte);
+    } while (byte == std::byte{255});
+    return length;
+  }};
+
+  while (input < source.size()) {
+    const auto token{static_cast<std::size_t>(source[input++])};
+
+    const auto literals{readLength(token >> 4)};
+    if (literals > source.size() - input ||
+        literals > destination.size() - output) {
+      throw malformed();
+    }
+    std::copy_n(source.data() + input, literals, destination.data() + output);
+    input += literals;
+    output += literals;
+
+    // The last sequence has only literals
+    if (input == source.size()) break;
+
+    if (input + 2 > source.size()) throw malformed();
+    const auto offset{static_cast<std::size_t>(source[input]) |
+                      (static_cast<std::size_t>(source[input + 1]) << 8)};
+    input += 2;
+    const auto length{readLength(token & 0xFU) + minMatch};
+    if (offset == 0 || offset > output ||
+        length > destination.size() - output) {
+      throw malformed();
+    }
+
+    // Byte by byte, since the match may overlap the output
+    for (const auto index : std::views::iota(output, output + length)) {
+      destination[index] = destination[index - offset];
+    }
+    output += length;
+  }
+
+  if (output != destination.size()) throw malformed();
+}
+
+/**
+ * @brief Creates a pack file with all files of a directory.
+ *
+ * Files are stored in lexicographic order of their paths. Each file is
+ * compressed only if its compressed size is smaller than the original.
+ *
+ * @param packPath Path of the pack file to create.
+ * @param directory Directory to pack, usually an `assets` directory.
+ * @param compress Whether to compress entries with LZ4.
+ *
+ * @throw abcg::Exception if a file cannot be read or written.
+ */
+void abcg::writePackFile(std::string_view packPath, std::string_view directory,
+                         bool compress) {
+  namespace fs = std::filesystem;
+
+  std::vector<fs::path> files;
+  for (const auto &entry : fs::recursive_directory_iterator{directory}) {
+    if (entry.is_regular_file()) files.push_back(entry.path());
+  }
+  std::ranges::sort(files);
+
+  std::ofstream stream(packPath.data(), std::ios::binary);
+  if (!stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to create pack file {}", packPath))};
+  }
+
+  const auto write{[&](std::span<const std::byte> bytes) {
+    stream.write(reinterpret_cast<const char *>(bytes.data()),
+                 static_cast<std::streamsize>(bytes.size()));
+  }};
+  const std::array<std::byte, alignment> padding{};
+
+  // Header is written last, when the index offset is known
+  std::uint64_t offset{headerSize};
+  stream.seekp(static_cast<std::streamoff>(offset));
+
+  std::vector<std::byte> index;
+  for (const auto &file : files) {
+    const auto contents{readFile(file)};
+    auto compressed{compress ? compressLZ4(contents)
+                             : std::vector<std::byte>{}};
+    const auto isCompressed{!compressed.empty() &&
+                            compressed.size() < contents.size()};
+    const std::span<const std::byte> stored{isCompressed ? compressed
+                                                         : contents};
+
+    const auto name{file.lexically_relative(directory).generic_string()};
+    appendValue<std::uint64_t>(index, offset);
+    appendValue<std::uint64_t>(index, stored.size());
+    appendValue<std::uint64_t>(index, contents.size());
+    appendValue<std::uint32_t>(index, isCompressed ? compressedFlag : 0);
+    appendValue<std::uint32_t>(index, static_cast<std::uint32_t>(name.size()));
+    const auto *nameBytes{reinterpret_cast<const std::byte *>(name.data())};
+    index.insert(index.end(), nameBytes, nameBytes + name.size());
+
+    write(stored);
+    offset += stored.size();
+    const auto paddingSize{(alignment - offset % alignment) % alignment};
+    write(std::span{padding}.first(paddingSize));
+    offset += paddingSize;
+  }
+  write(index);
+
+  std::vector<std::byte> header;
+  const auto *magicBytes{reinterpret_cast<const std::byte *>(magic.data())};
+  header.insert(header.end(), magicBytes, magicBytes + magic.size());
+  appendValue<std::uint32_t>(header, version);
+  appendValue<std::uint32_t>(header, static_cast<std::uint32_t>(files.size()));
+  appendValue<std::uint64_t>(header, offset);
+  appendValue<std::uint64_t>(header, index.size());
+  stream.seekp(0);
+  write(header);
+
+  if (!stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to write pack file {}", packPath))};
+  }
+}
+
+abcg::MappedFile::~MappedFile() { close(); }
+
+abcg::PackFile::~PackFile() { close(); }
+
+/**
+ * @brief Opens a file for reading.
+ *
+ * The file is memory-mapped on Linux and macOS, and read into memory on other
+ * platforms or if it cannot be mapped.
+ *
+ * @param path Path to the file.
+ *
+ * @throw abcg::Exception if the file cannot be opened.
+ */
+void abcg::MappedFile::open(std::string_view path) {
+  close();
+
+#if defined(ABCG_PACK_MMAP)
+  const auto fileDescriptor{::open(path.data(), O_RDONLY)};
+  struct stat status {};
+  if (fileDescriptor < 0 || ::fstat(fileDescriptor, &status) != 0) {
+    if (fileDescriptor >= 0) ::close(fileDescriptor);
+    throw abcg::Exception{
+        abcg::Exception::Runtime(fmt::format("Failed to open file {}", path))};
+  }
+  const auto size{static_cast<std::size_t>(status.st_size)};
+  if (size > 0) {
+    auto *mapping{
+        ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0)};
+    if (mapping != MAP_FAILED) {
+      // Files are usually read once, right after being opened
+      ::posix_madvise(mapping, size, POSIX_MADV_WILLNEED);
+      m_mapping = mapping;
+      m_data = {static_cast<const std::byte *>(mapping), size};
+    }
+  }
+  ::close(fileDescriptor);
+#endif
+
+  if (m_mapping == nullptr) {
+    m_buffer = readFile(std::filesystem::path{path});
+    m_data = m_buffer;
+  }
+}
+
+/**
+ * @brief Closes the file.
+ *
+ * Views returned by data() are no longer valid.
+ */
+void abcg::MappedFile::close() {
+#if defined(ABCG_PACK_MMAP)
+  if (m_mapping != nullptr) ::munmap(m_mapping, m_data.size());
+#endif
+  m_mapping = nullptr;
+  m_data = {};
+  m_buffer.clear();
+}
+
+/**
+ * @brief Opens a pack file and reads its index.
+ *
+ * @param path Path to the pack file.
+ *
+ * @throw abcg::Exception if the file cannot be opened or is not a valid pack
+ * file.
+ */
+void abcg::PackFile::open(std::string_view path) {
+  close();
+  m_file.open(path);
+  const auto data{m_file.data()};
+
+  try {
+    std::uint64_t offset{};
+    std::array<char, magic.size()> fileMagic{};
+    for (auto &character : fileMagic) {
+      character = readValue<char>(data, offset);
+    }
+    if (fileMagic != magic || readValue<std::uint32_t>(data, offset) !=
+                                  version) {
+      throw abcg::Exception{abcg::Exception::Runtime(
+          fmt::format("{} is not a valid pack file", path))};
+    }
+    const auto entryCount{readValue<std::uint32_t>(data, offset)};
+    offset = readValue<std::uint64_t>(data, offset);
+
+    for ([[maybe_unused]] const auto index : std::views::iota(0U, entryCount)) {
+      Entry entry;
+      entry.offset = readValue<std::uint64_t>(data, offset);
+      entry.storedSize = readValue<std::uint64_t>(data, offset);
+      entry.size = readValue<std::uint64_t>(data, offset);
+      entry.flags = readValue<std::uint32_t>(data, offset);
+      const auto nameSize{readValue<std::uint32_t>(data, offset)};
+      if (offset + nameSize > data.size() ||
+          entry.offset + entry.storedSize > data.size()) {
+        throw abcg::Exception{abcg::Exception::Runtime("Truncated pack file")};
+      }
+      std::string name(reinterpret_cast<const char *>(&data[offset]), nameSize);
+      offset += nameSize;
+      m_entries.insert_or_assign(std::move(name), entry);
+    }
+  } catch (...) {
+    close();
+    throw;
+  }
+}
+
+/**
+ * @brief Closes the pack file.
+ *
+ * Views returned by read() are no longer valid.
+ */
+void abcg::PackFile::close() {
+  m_file.close();
+  m_entries.clear();
+}
+
+/**
+ * @brief Returns whether the pack file has an entry.
+ *
+ * @param name Path of the entry relative to the packed directory.
+ *
+ * @return True if the entry exists.
+ */
+bool abcg::PackFile::contains(std::string_view name) const {
+  return m_entries.contains(std::string{name});
+}
+
+/**
+ * @brief Reads an entry of the pack file.
+ *
+ * @param name Path of the entry relative to the packed directory.
+ *
+ * @return Contents of the entry, or an empty optional if there is no such
+ * entry.
+ *
+ * @throw abcg::Exception if a compressed entry is malformed.
+ */
+std::optional<abcg::AssetBuffer> abcg::PackFile::read(
+    std::string_view name) const {
+  const auto it{m_entries.find(std::string{name})};
+  if (it == m_entries.end()) return std::nullopt;
+
+  const auto &entry{it->second};
+  const auto stored{m_file.data().subspan(entry.offset, entry.storedSize)};
+  if ((entry.flags & compressedFlag) == 0) {
+    return AssetBuffer{.mapped = stored};
+  }
+
+  AssetBuffer buffer;
+  buffer.decompressed.resize(entry.size);
+  decompressLZ4(stored, buffer.decompressed);
+  return buffer;
+}
+
+/**
+ * @brief Mounts a pack file to a directory.
+ *
+ * Assets under the mount path are read from the pack file when it has them.
+ * Pack files mounted later take precedence.
+ *
+ * @param packPath Path to the pack file.
+ * @param mountPath Directory that corresponds to the root of the pack file,
+ * usually the assets path of the application.
+ *
+ * @throw abcg::Exception if the pack file cannot be opened.
+ */
+void abcg::mountPackFile(std::string_view packPath,
+                         std::string_view mountPath) {
+  auto pack{std::make_unique<PackFile>()};
+  pack->open(packPath);
+
+  auto root{std::filesystem::path{mountPath}.lexically_normal()};
+  if (!root.has_filename()) root = root.parent_path();
+  getMountedPacks().push_back({.root = root, .pack = std::move(pack)});
+}
+
+/**
+ * @brief Unmounts and closes all pack files.
+ *
+ */
+void abcg::unmountPackFiles() { getMountedPacks().clear(); }
+
+/**
+ * @brief Returns whether an asset is in a mounted pack file.
+ *
+ * @param path Path to the asset.
+ *
+ * @return True if the asset is in a mounted pack file.
+ */
+bool abcg::hasPackedAsset(std::string_view path) {
+  const auto &packs{getMountedPacks()};
+  return std::any_of(packs.rbegin(), packs.rend(), [&](const auto &mounted) {
+    const auto name{getEntryName(mounted.root, path)};
+    return !name.empty() && mounted.pack->contains(name);
+  });
+}
+
+/**
+ * @brief Reads an asset from the mounted pack files.
+ *
+ * @param path Path to the asset.
+ *
+ * @return Contents of the asset, or an empty optional if no mounted pack file
+ * has the asset.
+ */
+std::optional<abcg::AssetBuffer> abcg::readPackedAsset(std::string_view path) {
+  const auto &packs{getMountedPacks()};
+  for (const auto &mounted : packs | std::views::reverse) {
+    if (const auto name{getEntryName(mounted.root, path)}; !name.empty()) {
+      if (auto buffer{mounted.pack->read(name)}) return buffer;
+    }
+  }
+  return std::nullopt;
+}
+
+/**
+ * @brief Returns whether an asset is in a mounted pack file or exists as a
+ * file.
+ *
+ * @param path Path to the asset.
+ *
+ * @return True if the asset exists.
+ */
+bool abcg::assetExists(std::string_view path) {
+  return hasPackedAsset(path) || std::filesystem::exists(path);
+}
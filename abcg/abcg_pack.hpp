@@ -0,0 +1,143 @@
+/**
+ * @file abcg_pack.hpp
+ * @brief Declaration of asset pack files.
+ *
+ * A pack file stores the contents of an assets directory in a single indexed
+ * file. Entries are aligned to 16 bytes and optionally compressed with the
+ * LZ4 block format. Pack files are memory-mapped when supported, so that
+ * uncompressed entries are read without copies.
+ *
+ * Mounted pack files take precedence over loose files in the texture, shader
+ * and model loaders of abcg.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_PACK_HPP_
+#define ABCG_PACK_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace abcg {
+class AssetStreamBuffer;
+class MappedFile;
+class PackFile;
+struct AssetBuffer;
+
+void writePackFile(std::string_view packPath, std::string_view directory,
+                   bool compress = true);
+void mountPackFile(std::string_view packPath, std::string_view mountPath);
+void unmountPackFiles();
+[[nodiscard]] bool hasPackedAsset(std::string_view path);
+[[nodiscard]] std::optional<AssetBuffer> readPackedAsset(std::string_view path);
+[[nodiscard]] bool assetExists(std::string_view path);
+
+[[nodiscard]] std::vector<std::byte> compressLZ4(
+    std::span<const std::byte> source);
+void decompressLZ4(std::span<const std::byte> source,
+                   std::span<std::byte> destination);
+}  // namespace abcg
+
+/**
+ * @brief Contents of an entry of a pack file.
+ *
+ * Uncompressed entries are views of the mapped pack file and are valid while
+ * the pack file is open. Compressed entries own their decompressed contents.
+ */
+struct abcg::AssetBuffer {
+  std::span<const std::byte> mapped{};
+  std::vector<std::byte> decompressed{};
+
+  [[nodiscard]] std::span<const std::byte> data() const {
+    return decompressed.empty() ? mapped : std::span{decompressed};
+  }
+};
+
+/**
+ * @brief Read-only stream buffer over the contents of an asset.
+ *
+ * Used to parse packed assets with `std::istream` without copies.
+ */
+class abcg::AssetStreamBuffer : public std::streambuf {
+ public:
+  explicit AssetStreamBuffer(std::span<const std::byte> data) {
+    // The get area is never written to
+    auto *begin{
+        const_cast<char *>(reinterpret_cast<const char *>(data.data()))};
+    setg(begin, begin, begin + data.size());
+  }
+};
+
+/**
+ * @brief Read-only view of the contents of a file.
+ *
+ * The file is memory-mapped when supported, and read into memory otherwise.
+ */
+class abcg::MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile(MappedFile &&) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile &operator=(MappedFile &&) = delete;
+
+  void open(std::string_view path);
+  void close();
+
+  [[nodiscard]] std::span<const std::byte> data() const { return m_data; }
+
+ private:
+  std::span<const std::byte> m_data;
+
+  // Contents of the file when it cannot be memory-mapped
+  std::vector<std::byte> m_buffer;
+  void *m_mapping{};
+};
+
+/**
+ * @brief abcg::PackFile class.
+ *
+ * Read-only access to the entries of a pack file created by
+ * abcg::writePackFile. Entries are identified by their paths relative to the
+ * packed directory, with `/` as separator.
+ */
+class abcg::PackFile {
+ public:
+  PackFile() = default;
+  ~PackFile();
+
+  PackFile(const PackFile &) = delete;
+  PackFile(PackFile &&) = delete;
+  PackFile &operator=(const PackFile &) = delete;
+  PackFile &operator=(PackFile &&) = delete;
+
+  void open(std::string_view path);
+  void close();
+
+  [[nodiscard]] bool contains(std::string_view name) const;
+  [[nodiscard]] std::optional<AssetBuffer> read(std::string_view name) const;
+  [[nodiscard]] std::size_t size() const { return m_entries.size(); }
+
+ private:
+  struct Entry {
+    std::uint64_t offset{};
+    std::uint64_t storedSize{};
+    std::uint64_t size{};
+    std::uint32_t flags{};
+  };
+
+  std::unordered_map<std::string, Entry> m_entries;
+  MappedFile m_file;
+};
+
+#endif
@@ -0,0 +1,329 @@
+/**
+ * @file abcg_postprocess.cpp
+ * @brief Definition of abcg::PostProcess members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_postprocess.hpp"
+
+#include <algorithm>
+#include <cppitertools/itertools.hpp>
+#include <utility>
+
+#include "abcg_openglfunctions.hpp"
+
+namespace {
+// Capabilities disabled while the passes are drawn
+constexpr std::array<GLenum, 4> disabledCapabilities{
+    GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST, GL_SCISSOR_TEST};
+
+// Triangle with vertices (-1, -1), (3, -1) and (-1, 3), which covers the
+// viewport with a single primitive and no diagonal seam
+constexpr std::string_view vertexShader{R"glsl(
+out vec2 fragTexCoord;
+
+void main() {
+  vec2 position = vec2(float((gl_VertexID & 1) << 2) - 1.0,
+                       float((gl_VertexID & 2) << 1) - 1.0);
+  fragTexCoord = position * 0.5 + 0.5;
+  gl_Position = vec4(position, 0.0, 1.0);
+}
+)glsl"};
+
+constexpr std::string_view copyShader{R"glsl(
+in vec2 fragTexCoord;
+
+uniform sampler2D inputTexture;
+
+out vec4 outColor;
+
+void main() { outColor = texture(inputTexture, fragTexCoord); }
+)glsl"};
+
+// Fast approximate antialiasing, after FXAA 3.11 by Timothy Lottes: finds
+// the direction of the edge through each pixel from the luma of its
+// neighbors, searches along the edge for its ends, and blends the pixel
+// with its neighbor across the edge by its distance to the nearest end
+constexpr std::string_view fxaaShader{R"glsl(
+// Texture coordinates need more precision than mediump at large sizes
+precision highp float;
+
+in vec2 fragTexCoord;
+
+uniform sampler2D inputTexture;
+uniform vec2 inputTexelSize;
+
+out vec4 outColor;
+
+const float edgeThreshold = 0.125;
+const float edgeThresholdMin = 0.0312;
+const float subpixelQuality = 0.75;
+const int searchSteps = 5;
+const float stepSizes[searchSteps] = float[](1.5, 2.0, 2.0, 4.0, 12.0);
+
+float lumaAt(vec2 texCoord) {
+  vec3 color = textureLod(inputTexture, texCoord, 0.0).rgb;
+  return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
+float lumaAt(vec2 texCoord, vec2 offset) {
+  return lumaAt(texCoord + offset * inputTexelSize);
+}
+
+void main() {
+  vec2 texCoord = fragTexCoord;
+  vec4 center = textureLod(inputTexture, texCoord, 0.0);
+  float lumaM = dot(center.rgb, vec3(0.299, 0.587, 0.114));
+  float lumaN = lumaAt(texCoord, vec2(0.0, 1.0));
+  float lumaS = lumaAt(texCoord, vec2(0.0, -1.0));
+  float lumaE = lumaAt(texCoord, vec2(1.0, 0.0));
+  float lumaW = lumaAt(texCoord, vec2(-1.0, 0.0));
+
+  float lumaMax = max(lumaM, max(max(lumaN, lumaS), max(lumaE, lumaW)));
+  float lumaMin = min(lumaM, min(min(lumaN, lumaS), min(lumaE, lumaW)));
+  float range = lumaMax - lumaMin;
+  if (range < max(edgeThresholdMin, lumaMax * edgeThreshold)) {
+    outColor = center;
+    return;
+  }
+
+  float lumaNE = lumaAt(texCoord, vec2(1.0, 1.0));
+  float lumaNW = lumaAt(texCoord, vec2(-1.0, 1.0));
+  float lumaSE = lumaAt(texCoord, vec2(1.0, -1.0));
+  float lumaSW = lumaAt(texCoord, vec2(-1.0, -1.0));
+
+  float edgeHorizontal = abs(lumaNW + lumaNE - 2.0 * lumaN) +
+                         2.0 * abs(lumaW + lumaE - 2.0 * lumaM) +
+                         abs(lumaSW + lumaSE - 2.0 * lumaS);
+  float edgeVertical = abs(lumaNW + lumaSW - 2.0 * lumaW) +
+                       2.0 * abs(lumaN + lumaS - 2.0 * lumaM) +
+                       abs(lumaNE + lumaSE - 2.0 * lumaE);
+  bool horizontal = edgeHorizontal >= edgeVertical;
+
+  // Pick the side of the edge with the steepest gradient
+  float luma1 = horizontal ? lumaS : lumaW;
+  float luma2 = horizontal ? lumaN : lumaE;
+  float gradient1 = abs(luma1 - lumaM);
+  float gradient2 = abs(luma2 - lumaM);
+  bool negative = gradient1 >= gradient2;
+  float gradientScaled = 0.25 * max(gradient1, gradient2);
+
+  float stepLength = horizontal ? inputTexelSize.y : inputTexelSize.x;
+  float lumaLocalAverage = 0.5 * (lumaM + (negative ? luma1 : luma2));
+  if (negative) stepLength = -stepLength;
+
+  // Search both ends of the edge, starting from its middle
+  vec2 edgeTexCoord = texCoord;
+  if (horizontal) {
+    edgeTexCoord.y += stepLength * 0.5;
+  } else {
+    edgeTexCoord.x += stepLength * 0.5;
+  }
+  vec2 offset = horizontal ? vec2(inputTexelSize.x, 0.0)
+                           : vec2(0.0, inputTexelSize.y);
+  vec2 texCoord1 = edgeTexCoord - offset;
+  vec2 texCoord2 = edgeTexCoord + offset;
+  float lumaEnd1 = lumaAt(texCoord1) - lumaLocalAverage;
+  float lumaEnd2 = lumaAt(texCoord2) - lumaLocalAverage;
+  bool reached1 = abs(lumaEnd1) >= gradientScaled;
+  bool reached2 = abs(lumaEnd2) >= gradientScaled;
+  for (int i = 0; i < searchSteps && !(reached1 && reached2); ++i) {
+    if (!reached1) {
+      texCoord1 -= offset * stepSizes[i];
+      lumaEnd1 = lumaAt(texCoord1) - lumaLocalAverage;
+      reached1 = abs(lumaEnd1) >= gradientScaled;
+    }
+    if (!reached2) {
+      texCoord2 += offset * stepSizes[i];
+      lumaEnd2 = lumaAt(texCoord2) - lumaLocalAverage;
+      reached2 = abs(lumaEnd2) >= gradientScaled;
+    }
+  }
+
+  float distance1 =
+      horizontal ? texCoord.x - texCoord1.x : texCoord.y - texCoord1.y;
+  float distance2 =
+      horizontal ? texCoord2.x - texCoord.x : texCoord2.y - texCoord.y;
+  bool closerToEnd1 = distance1 < distance2;
+  float pixelOffset = 0.5 - min(distance1, distance2) / (distance1 + distance2);
+
+  // Blend only if the luma at the nearest end varies toward the center
+  bool centerSmaller = lumaM < lumaLocalAverage;
+  bool correctVariation =
+      ((closerToEnd1 ? lumaEnd1 : lumaEnd2) < 0.0) != centerSmaller;
+  float finalOffset = correctVariation ? pixelOffset : 0.0;
+
+  // Subpixel antialiasing of thin lines and single pixels
+  float lumaAverage = (2.0 * (lumaN + lumaS + lumaE + lumaW) + lumaNE +
+                       lumaNW + lumaSE + lumaSW) / 12.0;
+  float subpixel = clamp(abs(lumaAverage - lumaM) / range, 0.0, 1.0);
+  subpixel = (-2.0 * subpixel + 3.0) * subpixel * subpixel;
+  finalOffset = max(finalOffset, subpixel * subpixel * subpixelQuality);
+
+  if (horizontal) {
+    texCoord.y += finalOffset * stepLength;
+  } else {
+    texCoord.x += finalOffset * stepLength;
+  }
+  outColor = textureLod(inputTexture, texCoord, 0.0);
+}
+)glsl"};
+}  // namespace
+
+/**
+ * @brief Adds a pass at the end of the chain.
+ *
+ * @param pass Pass to add. The chain takes ownership of its program.
+ *
+ * @return Index of the pass.
+ */
+std::size_t abcg::PostProcess::addPass(PostProcessPass pass) {
+  m_passes.push_back(std::move(pass));
+  return m_passes.size() - 1;
+}
+
+/**
+ * @brief Enables or disables a pass.
+ *
+ * Disabled passes are skipped. If the last pass is disabled, the last
+ * enabled pass renders to the output framebuffer.
+ *
+ * @param index Index of the pass.
+ * @param enabled Whether the pass is enabled.
+ */
+void abcg::PostProcess::setPassEnabled(std::size_t index, bool enabled) {
+  m_passes.at(index).enabled = enabled;
+}
+
+/**
+ * @brief Returns whether any pass is enabled.
+ *
+ */
+bool abcg::PostProcess::hasEnabledPasses() const {
+  return std::ranges::any_of(
+      m_passes, [](const PostProcessPass &pass) { return pass.enabled; });
+}
+
+/**
+ * @brief Draws the enabled passes.
+ *
+ * Blending, face culling, depth and scissor tests are disabled while the
+ * passes are drawn, and restored afterwards. Leaves the output framebuffer
+ * bound. Nothing is drawn if no pass is enabled.
+ *
+ * @param inputTexture Texture read by the first pass, e.g. the color
+ * texture of a resolved abcg::RenderTarget.
+ * @param inputWidth Width of the input texture.
+ * @param inputHeight Height of the input texture.
+ * @param framebuffer Framebuffer drawn by the last pass, e.g. 0 for the
+ * window.
+ * @param width Width of the output viewport.
+ * @param height Height of the output viewport.
+ */
+void abcg::PostProcess::apply(GLuint inputTexture, int inputWidth,
+                              int inputHeight, GLuint framebuffer, int width,
+                              int height) {
+  const auto lastPass{std::ranges::find_if(
+      m_passes.rbegin(), m_passes.rend(),
+      [](const PostProcessPass &pass) { return pass.enabled; })};
+  if (lastPass == m_passes.rend()) return;
+
+  std::array<GLboolean, disabledCapabilities.size()> wasEnabled{};
+  for (const auto index : iter::range(disabledCapabilities.size())) {
+    wasEnabled.at(index) = abcg::glIsEnabled(disabledCapabilities.at(index));
+    abcg::glDisable(disabledCapabilities.at(index));
+  }
+
+  if (m_VAO == 0) abcg::glGenVertexArrays(1, &m_VAO);
+  abcg::glBindVertexArray(m_VAO);
+  abcg::glActiveTexture(GL_TEXTURE0);
+
+  auto texture{inputTexture};
+  std::size_t target{};
+  for (auto &pass : m_passes) {
+    if (!pass.enabled) continue;
+
+    const auto isLast{&pass == &*lastPass};
+    if (isLast) {
+      abcg::glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+      abcg::glViewport(0, 0, width, height);
+    } else {
+      auto &renderTarget{m_targets.at(target)};
+      if (renderTarget.getFramebuffer() == 0) {
+        renderTarget.create(inputWidth, inputHeight,
+                            {.depthFormat = GL_NONE});
+      } else {
+        renderTarget.resize(inputWidth, inputHeight);
+      }
+      renderTarget.bind();
+    }
+
+    abcg::glUseProgram(pass.program);
+    abcg::glUniform1i(
+        abcg::glGetUniformLocation(pass.program, "inputTexture"), 0);
+    abcg::glUniform2f(
+        abcg::glGetUniformLocation(pass.program, "inputTexelSize"),
+        1.0f / static_cast<float>(inputWidth),
+        1.0f / static_cast<float>(inputHeight));
+    if (pass.setUniforms) pass.setUniforms(pass.program);
+
+    abcg::glBindTexture(GL_TEXTURE_2D, texture);
+    abcg::glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    if (!isLast) {
+      texture = m_targets.at(target).getColorTexture();
+      target = 1 - target;
+    }
+  }
+
+  abcg::glBindTexture(GL_TEXTURE_2D, 0);
+  abcg::glUseProgram(0);
+  abcg::glBindVertexArray(0);
+
+  for (const auto index : iter::range(disabledCapabilities.size())) {
+    if (wasEnabled.at(index) == GL_TRUE) {
+      abcg::glEnable(disabledCapabilities.at(index));
+    }
+  }
+}
+
+/**
+ * @brief Deletes the programs of the passes and the OpenGL objects of the
+ * chain, and removes all passes.
+ *
+ */
+void abcg::PostProcess::destroy() {
+  for (const auto &pass : m_passes) {
+    abcg::glDeleteProgram(pass.program);
+  }
+  m_passes.clear();
+  for (auto &renderTarget : m_targets) {
+    renderTarget.destroy();
+  }
+  abcg::glDeleteVertexArrays(1, &m_VAO);
+  m_VAO = 0;
+}
+
+/**
+ * @brief Returns the vertex shader of the passes, without version header.
+ *
+ * Outputs the texture coordinates of the viewport in `fragTexCoord`.
+ */
+std::string_view abcg::PostProcess::getVertexShader() { return vertexShader; }
+
+/**
+ * @brief Returns a fragment shader that copies the input texture.
+ *
+ * As the last pass, it scales the input to the output size with the filter
+ * of the input texture.
+ */
+std::string_view abcg::PostProcess::getCopyShader() { return copyShader; }
+
+/**
+ * @brief Returns a fragment shader of fast approximate antialiasing (FXAA).
+ *
+ * Expects colors in the range [0, 1] after tone mapping. As a cheap
+ * alternative to MSAA, render the scene without samples and add this pass.
+ */
+std::string_view abcg::PostProcess::getFXAAShader() { return fxaaShader; }
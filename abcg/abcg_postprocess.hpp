@@ -0,0 +1,95 @@
+/**
+ * @file abcg_postprocess.hpp
+ * @brief Declaration of abcg::PostProcess.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_POSTPROCESS_HPP_
+#define ABCG_POSTPROCESS_HPP_
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "abcg_rendertarget.hpp"
+
+namespace abcg {
+class PostProcess;
+struct PostProcessPass;
+}  // namespace abcg
+
+/**
+ * @brief Pass of abcg::PostProcess.
+ *
+ */
+struct abcg::PostProcessPass {
+  // Program made of getVertexShader() and a fragment shader
+  GLuint program{};
+  // Called after the program is in use, to set its own uniforms
+  std::function<void(GLuint program)> setUniforms{};
+  bool enabled{true};
+};
+
+/**
+ * @brief abcg::PostProcess class.
+ *
+ * Chain of fullscreen passes applied to the color texture of a scene, e.g.
+ * of an abcg::RenderTarget. Each pass draws a single triangle that covers
+ * the viewport with the vertex shader of getVertexShader(). Its fragment
+ * shader reads the output of the previous pass from
+ *
+ * @code
+ * in vec2 fragTexCoord;
+ * uniform sampler2D inputTexture;
+ * uniform vec2 inputTexelSize;  // 1 / size of inputTexture
+ * out vec4 outColor;
+ * @endcode
+ *
+ * All passes but the last render at the size of the input into
+ * intermediate targets. The last pass renders to the output framebuffer,
+ * so a scene rendered at a lower resolution is upscaled only once, at the
+ * end. getCopyShader() and getFXAAShader() are fragment shaders of common
+ * passes.
+ *
+ * The chain owns the programs of its passes. All functions must be called
+ * with the OpenGL context of the window current. OpenGL objects are deleted
+ * by destroy(), not by the destructor.
+ */
+class abcg::PostProcess {
+ public:
+  PostProcess() = default;
+  ~PostProcess() = default;
+
+  PostProcess(const PostProcess &) = delete;
+  PostProcess(PostProcess &&) = delete;
+  PostProcess &operator=(const PostProcess &) = delete;
+  PostProcess &operator=(PostProcess &&) = delete;
+
+  std::size_t addPass(PostProcessPass pass);
+  void setPassEnabled(std::size_t index, bool enabled);
+  void apply(GLuint inputTexture, int inputWidth, int inputHeight,
+             GLuint framebuffer, int width, int height);
+  void destroy();
+
+  [[nodiscard]] std::size_t getPassCount() const { return m_passes.size(); }
+  [[nodiscard]] bool isPassEnabled(std::size_t index) const {
+    return m_passes.at(index).enabled;
+  }
+  [[nodiscard]] bool hasEnabledPasses() const;
+
+  [[nodiscard]] static std::string_view getVertexShader();
+  [[nodiscard]] static std::string_view getCopyShader();
+  [[nodiscard]] static std::string_view getFXAAShader();
+
+ private:
+  std::vector<PostProcessPass> m_passes;
+  // Empty vertex array, as vertices are generated from gl_VertexID
+  GLuint m_VAO{};
+  // Intermediate targets, used alternately by consecutive passes
+  std::array<RenderTarget, 2> m_targets;
+};
+
+#endif
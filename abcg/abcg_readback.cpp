@@ -0,0 +1,240 @@
+/**
+ * @file abcg_readback.cpp
+ * @brief Definition of abcg::FrameReader members and image file functions.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_readback.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cppitertools/itertools.hpp>
+#include <cstring>
+#include <span>
+#include <utility>
+
+#include "SDL_image.h"
+#include "abcg_exception.hpp"
+#include "abcg_openglfunctions.hpp"
+
+namespace {
+constexpr std::size_t bytesPerPixel{4};
+
+// Copies rows ordered from bottom to top, as returned by glReadPixels, to an
+// image with rows ordered from top to bottom
+void copyRowsFlipped(std::span<const std::uint8_t> source,
+                     abcg::Image &image) {
+  const auto rowSize{static_cast<std::size_t>(image.width) * bytesPerPixel};
+  const auto height{static_cast<std::size_t>(image.height)};
+  image.pixels.resize(rowSize * height);
+  for (const auto row : iter::range(height)) {
+    std::memcpy(&image.pixels[row * rowSize],
+                &source[(height - row - 1) * rowSize], rowSize);
+  }
+}
+}  // namespace
+
+/**
+ * @brief Loads an image file.
+ *
+ * @param path Path to the image file, in any format supported by SDL_image.
+ *
+ * @return RGBA image.
+ *
+ * @throw abcg::Exception if the file cannot be loaded.
+ */
+abcg::Image abcg::readImage(std::string_view path) {
+  SDL_Surface *surface{IMG_Load(path.data())};
+  if (surface == nullptr) {
+    throw abcg::Exception{abcg::Exception::SDLImage(
+        fmt::format("Failed to load image {}", path))};
+  }
+  SDL_Surface *formattedSurface{
+      SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0)};
+  SDL_FreeSurface(surface);
+  if (formattedSurface == nullptr) {
+    throw abcg::Exception{abcg::Exception::SDL(
+        fmt::format("Failed to convert image {}", path))};
+  }
+
+  Image image{.width = formattedSurface->w, .height = formattedSurface->h};
+  const auto rowSize{static_cast<std::size_t>(image.width) * bytesPerPixel};
+  image.pixels.resize(rowSize * static_cast<std::size_t>(image.height));
+  for (const auto row : iter::range(image.height)) {
+    std::memcpy(&image.pixels[static_cast<std::size_t>(row) * rowSize],
+                static_cast<std::uint8_t *>(formattedSurface->pixels) +
+                    row * formattedSurface->pitch,
+                rowSize);
+  }
+  SDL_FreeSurface(formattedSurface);
+
+  return image;
+}
+
+/**
+ * @brief Writes an image to a PNG file.
+ *
+ * @param path Path of the PNG file.
+ * @param image RGBA image.
+ *
+ * @throw abcg::Exception if the file cannot be written, or in WebAssembly.
+ */
+void abcg::writeImage(std::string_view path, const Image &image) {
+#if defined(__EMSCRIPTEN__)
+  throw abcg::Exception{abcg::Exception::Runtime(
+      fmt::format("Cannot write image {} in WebAssembly", path))};
+#else
+  // The surface does not modify the pixels
+  auto *pixels{const_cast<std::uint8_t *>(image.pixels.data())};
+  SDL_Surface *surface{SDL_CreateRGBSurfaceWithFormatFrom(
+      pixels, image.width, image.height, 32,
+      image.width * static_cast<int>(bytesPerPixel), SDL_PIXELFORMAT_RGBA32)};
+  if (surface == nullptr) {
+    throw abcg::Exception{abcg::Exception::SDL(
+        fmt::format("Failed to create surface for image {}", path))};
+  }
+  const auto result{IMG_SavePNG(surface, path.data())};
+  SDL_FreeSurface(surface);
+  if (result != 0) {
+    throw abcg::Exception{abcg::Exception::SDLImage(
+        fmt::format("Failed to write image {}", path))};
+  }
+#endif
+}
+
+/**
+ * @brief Constructs a frame reader.
+ *
+ * @param bufferCount Number of readbacks that can be pending at a time.
+ * Buffers are created by the first readbacks.
+ */
+abcg::FrameReader::FrameReader(std::size_t bufferCount)
+    : m_readbacks(std::max(bufferCount, std::size_t{1})) {}
+
+/**
+ * @brief Starts reading the pixels of the bound read framebuffer.
+ *
+ * @param width Width of the region to read, starting at the lower left
+ * corner.
+ * @param height Height of the region to read.
+ */
+void abcg::FrameReader::read(int width, int height) {
+  const auto size{static_cast<GLsizeiptr>(width) * height *
+                  static_cast<GLsizeiptr>(bytesPerPixel)};
+
+#if defined(__EMSCRIPTEN__)
+  Image image{.width = width, .height = height};
+  std::vector<std::uint8_t> pixels(static_cast<std::size_t>(size));
+  abcg::glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                     pixels.data());
+  copyRowsFlipped(pixels, image);
+  m_completed.push_back(std::move(image));
+#else
+  // Free the oldest buffer
+  if (m_pendingCount == m_readbacks.size()) {
+    m_completed.push_back(finish(m_readbacks[m_firstPending]));
+    m_firstPending = (m_firstPending + 1) % m_readbacks.size();
+    --m_pendingCount;
+  }
+
+  auto &readback{
+      m_readbacks[(m_firstPending + m_pendingCount) % m_readbacks.size()]};
+  if (readback.buffer == 0) abcg::glGenBuffers(1, &readback.buffer);
+  abcg::glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+  if (readback.capacity < size) {
+    abcg::glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    readback.capacity = size;
+  }
+  abcg::glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  abcg::glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  readback.fence = abcg::glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  // Make sure the fence is eventually signaled, as poll() does not flush
+  abcg::glFlush();
+  readback.width = width;
+  readback.height = height;
+  ++m_pendingCount;
+#endif
+}
+
+/**
+ * @brief Returns the oldest readback if it is finished.
+ *
+ * Does not wait for the GPU.
+ *
+ * @return Image read, or an empty optional if there is no finished readback.
+ */
+std::optional<abcg::Image> abcg::FrameReader::poll() {
+  if (!m_completed.empty()) {
+    auto image{std::move(m_completed.front())};
+    m_completed.pop_front();
+    return image;
+  }
+  if (m_pendingCount == 0) return std::nullopt;
+
+  if (const auto status{abcg::glClientWaitSync(
+          m_readbacks[m_firstPending].fence, 0, 0)};
+      status == GL_TIMEOUT_EXPIRED) {
+    return std::nullopt;
+  }
+  return wait();
+}
+
+/**
+ * @brief Returns the oldest readback, waiting for the GPU if needed.
+ *
+ * @return Image read, or an empty optional if there is no pending readback.
+ */
+std::optional<abcg::Image> abcg::FrameReader::wait() {
+  if (!m_completed.empty()) {
+    auto image{std::move(m_completed.front())};
+    m_completed.pop_front();
+    return image;
+  }
+  if (m_pendingCount == 0) return std::nullopt;
+
+  auto image{finish(m_readbacks[m_firstPending])};
+  m_firstPending = (m_firstPending + 1) % m_readbacks.size();
+  --m_pendingCount;
+  return image;
+}
+
+/**
+ * @brief Releases the OpenGL objects and discards pending readbacks.
+ */
+void abcg::FrameReader::destroy() {
+  for (auto &readback : m_readbacks) {
+    if (readback.fence != nullptr) abcg::glDeleteSync(readback.fence);
+    if (readback.buffer != 0) abcg::glDeleteBuffers(1, &readback.buffer);
+    readback = {};
+  }
+  m_firstPending = 0;
+  m_pendingCount = 0;
+  m_completed.clear();
+}
+
+// Waits for a readback and copies its pixels
+abcg::Image abcg::FrameReader::finish(Readback &readback) {
+  // Timeout of one second per wait, in nanoseconds
+  const GLuint64 timeout{1'000'000'000};
+  while (abcg::glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                timeout) == GL_TIMEOUT_EXPIRED) {
+  }
+  abcg::glDeleteSync(std::exchange(readback.fence, nullptr));
+
+  Image image{.width = readback.width, .height = readback.height};
+  const auto size{static_cast<std::size_t>(readback.width) *
+                  static_cast<std::size_t>(readback.height) * bytesPerPixel};
+  abcg::glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+  const auto *mapped{static_cast<const std::uint8_t *>(abcg::glMapBufferRange(
+      GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size),
+      GL_MAP_READ_BIT))};
+  if (mapped != nullptr) {
+    copyRowsFlipped({mapped, size}, image);
+    abcg::glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  abcg::glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  return image;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file abcg_readback.hpp
+ * @brief Declaration of abcg::FrameReader and image file functions.
+ *
+ * Frames are read back from the framebuffer asynchronously: pixels are
+ * copied to pixel buffer objects and mapped only after a fence tells that
+ * the copy is finished, so that reading a frame does not wait for the GPU.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_READBACK_HPP_
+#define ABCG_READBACK_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "abcg_external.hpp"
+
+namespace abcg {
+class FrameReader;
+struct Image;
+
+[[nodiscard]] Image readImage(std::string_view path);
+void writeImage(std::string_view path, const Image &image);
+}  // namespace abcg
+
+/**
+ * @brief RGBA image with 8 bits per channel.
+ *
+ * Rows are ordered from top to bottom.
+ */
+struct abcg::Image {
+  int width{};
+  int height{};
+  std::vector<std::uint8_t> pixels{};
+};
+
+/**
+ * @brief abcg::FrameReader class.
+ *
+ * Reads the pixels of the framebuffer bound for reading, usually the back
+ * buffer before the buffer swap, into a ring of pixel buffer objects. The
+ * oldest readback is returned by poll() once the GPU has finished it. If
+ * every buffer is in use, read() waits for the oldest readback.
+ *
+ * In WebGL, buffers cannot be mapped for reading and pixels are read
+ * synchronously.
+ *
+ * All functions must be called with the OpenGL context of the framebuffer
+ * current.
+ */
+class abcg::FrameReader {
+ public:
+  explicit FrameReader(std::size_t bufferCount = 3);
+  ~FrameReader() = default;
+
+  FrameReader(const FrameReader &) = delete;
+  FrameReader(FrameReader &&) = delete;
+  FrameReader &operator=(const FrameReader &) = delete;
+  FrameReader &operator=(FrameReader &&) = delete;
+
+  void read(int width, int height);
+  [[nodiscard]] std::optional<Image> poll();
+  [[nodiscard]] std::optional<Image> wait();
+  void destroy();
+
+  [[nodiscard]] std::size_t getPendingCount() const {
+    return m_pendingCount + m_completed.size();
+  }
+
+ private:
+  struct Readback {
+    GLuint buffer{};
+    GLsizeiptr capacity{};
+    GLsync fence{};
+    int width{};
+    int height{};
+  };
+
+  std::vector<Readback> m_readbacks;
+  // Index of the oldest pending readback and number of pending readbacks
+  std::size_t m_firstPending{};
+  std::size_t m_pendingCount{};
+  // Readbacks that were finished to free their buffers
+  std::deque<Image> m_completed;
+
+  [[nodiscard]] Image finish(Readback &readback);
+};
+
+#endif
@@ -0,0 +1,280 @@
+/**
+ * @file abcg_rendertarget.cpp
+ * @brief Definition of abcg::RenderTarget members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_rendertarget.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <string_view>
+
+#include "abcg_exception.hpp"
+#include "abcg_openglfunctions.hpp"
+
+namespace {
+struct TextureFormat {
+  GLenum format{};
+  GLenum type{};
+};
+
+// Format and type of the pixel data of glTexImage2D for an internal format
+TextureFormat getTextureFormat(GLenum internalFormat) {
+  switch (internalFormat) {
+    case GL_RGBA8:
+    case GL_SRGB8_ALPHA8:
+      return {GL_RGBA, GL_UNSIGNED_BYTE};
+    case GL_RGB10_A2:
+      return {GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV};
+    case GL_RGBA16F:
+      return {GL_RGBA, GL_HALF_FLOAT};
+    case GL_R11F_G11F_B10F:
+      return {GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV};
+    case GL_DEPTH_COMPONENT16:
+      return {GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT};
+    case GL_DEPTH_COMPONENT24:
+      return {GL_DEPTH_COMPONENT, GL_UNSIGNED_INT};
+    case GL_DEPTH_COMPONENT32F:
+      return {GL_DEPTH_COMPONENT, GL_FLOAT};
+    case GL_DEPTH24_STENCIL8:
+      return {GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8};
+    default:
+      throw abcg::Exception{abcg::Exception::Runtime(fmt::format(
+          "Unsupported render target format {:#x}", internalFormat))};
+  }
+}
+
+GLenum getDepthAttachment(GLenum depthFormat) {
+  return depthFormat == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT
+                                            : GL_DEPTH_ATTACHMENT;
+}
+
+// Sets the draw and read buffers of the bound framebuffer
+void setColorBuffer(bool hasColor) {
+  const GLenum buffer{hasColor ? GLenum{GL_COLOR_ATTACHMENT0}
+                               : GLenum{GL_NONE}};
+  abcg::glDrawBuffers(1, &buffer);
+  abcg::glReadBuffer(buffer);
+}
+
+void checkFramebufferStatus(std::string_view name) {
+  if (const auto status{abcg::glCheckFramebufferStatus(GL_FRAMEBUFFER)};
+      status != GL_FRAMEBUFFER_COMPLETE) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("{} framebuffer is incomplete ({:#x})", name, status))};
+  }
+}
+}  // namespace
+
+/**
+ * @brief Creates the framebuffers and attachments of the render target.
+ *
+ * Deletes the previous ones, if any. The framebuffer bound to GL_FRAMEBUFFER
+ * is kept.
+ *
+ * @param width Width of the attachments.
+ * @param height Height of the attachments.
+ * @param settings Formats, samples and filter of the attachments.
+ *
+ * @throw abcg::Exception if the size or a format is not supported, or if
+ * the framebuffer is incomplete.
+ */
+void abcg::RenderTarget::create(int width, int height,
+                                const RenderTargetSettings &settings) {
+  destroy();
+  if (width <= 0 || height <= 0) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Invalid render target size {}x{}", width, height))};
+  }
+
+  m_settings = settings;
+  m_width = width;
+  m_height = height;
+  GLint maxSamples{};
+  abcg::glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+  m_samples = std::clamp(settings.samples, 0, maxSamples);
+
+  const auto hasColor{settings.colorFormat != GL_NONE};
+  const auto hasDepth{settings.depthFormat != GL_NONE};
+  const auto depthAttachment{getDepthAttachment(settings.depthFormat)};
+
+  GLint previousFramebuffer{};
+  abcg::glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+  // Framebuffer with the textures. Without MSAA, it is also rendered to and
+  // holds the depth renderbuffer
+  abcg::glGenFramebuffers(1, &m_resolveFramebuffer);
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, m_resolveFramebuffer);
+  if (hasColor) {
+    m_colorTexture = createTexture(settings.colorFormat);
+    abcg::glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                 GL_TEXTURE_2D, m_colorTexture, 0);
+  }
+  if (hasDepth && settings.depthTexture) {
+    m_depthTexture = createTexture(settings.depthFormat);
+    abcg::glFramebufferTexture2D(GL_FRAMEBUFFER, depthAttachment,
+                                 GL_TEXTURE_2D, m_depthTexture, 0);
+  } else if (hasDepth && m_samples == 0) {
+    m_depthRenderbuffer = createRenderbuffer(settings.depthFormat, 0);
+    abcg::glFramebufferRenderbuffer(GL_FRAMEBUFFER, depthAttachment,
+                                    GL_RENDERBUFFER, m_depthRenderbuffer);
+  }
+  setColorBuffer(hasColor);
+  checkFramebufferStatus("Render target");
+  m_framebuffer = m_resolveFramebuffer;
+
+  if (m_samples > 0) {
+    abcg::glGenFramebuffers(1, &m_framebuffer);
+    abcg::glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    if (hasColor) {
+      m_colorRenderbuffer =
+          createRenderbuffer(settings.colorFormat, m_samples);
+      abcg::glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                      GL_RENDERBUFFER, m_colorRenderbuffer);
+    }
+    if (hasDepth) {
+      m_depthRenderbuffer =
+          createRenderbuffer(settings.depthFormat, m_samples);
+      abcg::glFramebufferRenderbuffer(GL_FRAMEBUFFER, depthAttachment,
+                                      GL_RENDERBUFFER, m_depthRenderbuffer);
+    }
+    setColorBuffer(hasColor);
+    checkFramebufferStatus("Multisampled render target");
+  }
+
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER,
+                          static_cast<GLuint>(previousFramebuffer));
+}
+
+/**
+ * @brief Recreates the attachments with a new size and the same settings.
+ *
+ * Creates the target with default settings if it was not created yet. Does
+ * nothing if the size did not change or is empty, e.g., while the window is
+ * minimized.
+ *
+ * @param width New width.
+ * @param height New height.
+ */
+void abcg::RenderTarget::resize(int width, int height) {
+  if (width <= 0 || height <= 0) return;
+  if (width == m_width && height == m_height && m_resolveFramebuffer != 0)
+    return;
+  create(width, height, m_settings);
+}
+
+/**
+ * @brief Deletes the framebuffers and attachments.
+ *
+ */
+void abcg::RenderTarget::destroy() {
+  if (m_framebuffer != m_resolveFramebuffer) {
+    abcg::glDeleteFramebuffers(1, &m_framebuffer);
+  }
+  abcg::glDeleteFramebuffers(1, &m_resolveFramebuffer);
+  abcg::glDeleteTextures(1, &m_colorTexture);
+  abcg::glDeleteTextures(1, &m_depthTexture);
+  abcg::glDeleteRenderbuffers(1, &m_colorRenderbuffer);
+  abcg::glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+
+  m_framebuffer = m_resolveFramebuffer = 0;
+  m_colorTexture = m_depthTexture = 0;
+  m_colorRenderbuffer = m_depthRenderbuffer = 0;
+  m_width = m_height = 0;
+}
+
+/**
+ * @brief Binds the framebuffer for rendering and sets the viewport to the
+ * size of the target.
+ *
+ */
+void abcg::RenderTarget::bind() const {
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  abcg::glViewport(0, 0, m_width, m_height);
+}
+
+/**
+ * @brief Copies the multisampled renderbuffers to the textures.
+ *
+ * Must be called after rendering and before sampling the textures. Does
+ * nothing without MSAA. Leaves the framebuffer with the textures bound.
+ *
+ * The depth buffer is resolved only if it is a texture.
+ */
+void abcg::RenderTarget::resolve() const {
+  if (m_samples == 0) return;
+
+  GLbitfield mask{};
+  if (m_colorTexture != 0) mask |= GL_COLOR_BUFFER_BIT;
+  if (m_depthTexture != 0) {
+    mask |= GL_DEPTH_BUFFER_BIT;
+    if (m_settings.depthFormat == GL_DEPTH24_STENCIL8) {
+      mask |= GL_STENCIL_BUFFER_BIT;
+    }
+  }
+
+  abcg::glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+  abcg::glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_resolveFramebuffer);
+  abcg::glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height,
+                          mask, GL_NEAREST);
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, m_resolveFramebuffer);
+}
+
+/**
+ * @brief Copies the color texture to another framebuffer, scaling it to the
+ * given size with the filter of the target.
+ *
+ * This is the cheapest way to upscale a scene rendered at a lower
+ * resolution. Call resolve() before, if the target has MSAA. Leaves the
+ * destination framebuffer bound.
+ *
+ * @param framebuffer Destination framebuffer, e.g. 0 for the window.
+ * @param width Width of the destination.
+ * @param height Height of the destination.
+ */
+void abcg::RenderTarget::blit(GLuint framebuffer, int width,
+                              int height) const {
+  abcg::glBindFramebuffer(GL_READ_FRAMEBUFFER, m_resolveFramebuffer);
+  abcg::glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+  abcg::glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, width, height,
+                          GL_COLOR_BUFFER_BIT, m_settings.filter);
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+GLuint abcg::RenderTarget::createTexture(GLenum internalFormat) const {
+  const auto [format, type]{getTextureFormat(internalFormat)};
+
+  GLuint texture{};
+  abcg::glGenTextures(1, &texture);
+  abcg::glBindTexture(GL_TEXTURE_2D, texture);
+  abcg::glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(internalFormat),
+                     m_width, m_height, 0, format, type, nullptr);
+  const auto filter{static_cast<GLint>(m_settings.filter)};
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  abcg::glBindTexture(GL_TEXTURE_2D, 0);
+
+  return texture;
+}
+
+GLuint abcg::RenderTarget::createRenderbuffer(GLenum internalFormat,
+                                              int samples) const {
+  GLuint renderbuffer{};
+  abcg::glGenRenderbuffers(1, &renderbuffer);
+  abcg::glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+  if (samples > 0) {
+    abcg::glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples,
+                                           internalFormat, m_width, m_height);
+  } else {
+    abcg::glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, m_width,
+                                m_height);
+  }
+  abcg::glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  return renderbuffer;
+}
@@ -0,0 +1,102 @@
+/**
+ * @file abcg_rendertarget.hpp
+ * @brief Declaration of abcg::RenderTarget.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_RENDERTARGET_HPP_
+#define ABCG_RENDERTARGET_HPP_
+
+#include "abcg_external.hpp"
+
+namespace abcg {
+class RenderTarget;
+struct RenderTargetSettings;
+}  // namespace abcg
+
+/**
+ * @brief Settings of abcg::RenderTarget.
+ *
+ */
+struct abcg::RenderTargetSettings {
+  // Internal format of the color attachment: GL_RGBA8, GL_SRGB8_ALPHA8,
+  // GL_RGB10_A2, GL_RGBA16F or GL_R11F_G11F_B10F. GL_NONE creates a
+  // depth-only target
+  GLenum colorFormat{GL_RGBA8};
+  // Internal format of the depth attachment: GL_DEPTH_COMPONENT16,
+  // GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT32F or GL_DEPTH24_STENCIL8.
+  // GL_NONE creates a target without depth buffer
+  GLenum depthFormat{GL_DEPTH_COMPONENT24};
+  // Create the depth attachment as a texture that can be sampled, instead
+  // of a renderbuffer
+  bool depthTexture{false};
+  // Number of MSAA samples, limited to GL_MAX_SAMPLES. Zero disables MSAA
+  int samples{0};
+  // Minification and magnification filter of the textures
+  GLenum filter{GL_LINEAR};
+};
+
+/**
+ * @brief abcg::RenderTarget class.
+ *
+ * Offscreen framebuffer with a color texture and an optional depth
+ * attachment. Scenes can be rendered to a render target at a resolution
+ * other than the window's, and then upscaled with blit() or post-processed
+ * with abcg::PostProcess.
+ *
+ * With MSAA, rendering goes to multisampled renderbuffers, which resolve()
+ * copies to the textures.
+ *
+ * All functions must be called with the OpenGL context of the target
+ * current. OpenGL objects are deleted by destroy(), not by the destructor.
+ */
+class abcg::RenderTarget {
+ public:
+  RenderTarget() = default;
+  ~RenderTarget() = default;
+
+  RenderTarget(const RenderTarget &) = delete;
+  RenderTarget(RenderTarget &&) = delete;
+  RenderTarget &operator=(const RenderTarget &) = delete;
+  RenderTarget &operator=(RenderTarget &&) = delete;
+
+  void create(int width, int height, const RenderTargetSettings &settings);
+  void resize(int width, int height);
+  void destroy();
+
+  void bind() const;
+  void resolve() const;
+  void blit(GLuint framebuffer, int width, int height) const;
+
+  [[nodiscard]] GLuint getColorTexture() const { return m_colorTexture; }
+  [[nodiscard]] GLuint getDepthTexture() const { return m_depthTexture; }
+  [[nodiscard]] GLuint getFramebuffer() const { return m_resolveFramebuffer; }
+  [[nodiscard]] int getWidth() const { return m_width; }
+  [[nodiscard]] int getHeight() const { return m_height; }
+  [[nodiscard]] int getSamples() const { return m_samples; }
+  [[nodiscard]] const RenderTargetSettings &getSettings() const {
+    return m_settings;
+  }
+
+ private:
+  RenderTargetSettings m_settings{};
+  int m_width{};
+  int m_height{};
+  int m_samples{};
+
+  // Framebuffer rendered to. Same as m_resolveFramebuffer without MSAA
+  GLuint m_framebuffer{};
+  // Framebuffer with the textures
+  GLuint m_resolveFramebuffer{};
+  GLuint m_colorTexture{};
+  GLuint m_depthTexture{};
+  GLuint m_colorRenderbuffer{};
+  GLuint m_depthRenderbuffer{};
+
+  [[nodiscard]] GLuint createTexture(GLenum internalFormat) const;
+  [[nodiscard]] GLuint createRenderbuffer(GLenum internalFormat,
+                                          int samples) const;
+};
+
+#endif
@@ -0,0 +1,235 @@
+/**
+ * @file abcg_replay.cpp
+ * @brief Definition of abcg::EventRecorder and abcg::EventPlayer members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_replay.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <ranges>
+#include <utility>
+
+#include "abcg_exception.hpp"
+#include "abcg_pack.hpp"
+
+namespace {
+// Layout of a recording (all integers are little-endian):
+//
+// Header:
+//   char[8] magic, u32 version, u32 event size, u32 window count,
+//   i32 width and i32 height of each window, u64 records size,
+//   u64 stored size
+// Records, compressed with LZ4 if the stored size is smaller than the
+// records size. Each record is:
+//   u8 type, u8 window index, then the SDL_Event of Event and Sample
+//   records, or f64 delta time and f64 elapsed time of Frame records
+constexpr std::array magic{'A', 'B', 'C', 'G', 'R', 'P', 'L', 'Y'};
+constexpr std::uint32_t version{1};
+
+template <typename T>
+void appendValue(std::vector<std::byte> &bytes, T value) {
+  const auto size{bytes.size()};
+  bytes.resize(size + sizeof(T));
+  std::memcpy(&bytes[size], &value, sizeof(T));
+}
+
+template <typename T>
+[[nodiscard]] T readValue(std::span<const std::byte> bytes,
+                          std::uint64_t &offset) {
+  if (offset + sizeof(T) > bytes.size()) {
+    throw abcg::Exception{abcg::Exception::Runtime("Truncated recording")};
+  }
+  T value{};
+  std::memcpy(&value, &bytes[offset], sizeof(T));
+  offset += sizeof(T);
+  return value;
+}
+}  // namespace
+
+/**
+ * @brief Starts a recording.
+ *
+ * @param path Path of the file to create when the recorder is closed.
+ * @param windowSizes Size of each window when the recording starts.
+ */
+void abcg::EventRecorder::open(std::string_view path,
+                               std::span<const glm::ivec2> windowSizes) {
+  m_path = path;
+  m_windowSizes.assign(windowSizes.begin(), windowSizes.end());
+  m_records.clear();
+}
+
+/**
+ * @brief Writes the recording to its file and closes the recorder.
+ *
+ * @throw abcg::Exception if the file cannot be written.
+ */
+void abcg::EventRecorder::close() {
+  if (!isOpen()) return;
+  const auto path{std::exchange(m_path, {})};
+
+  auto compressed{compressLZ4(m_records)};
+  const auto isCompressed{!compressed.empty() &&
+                          compressed.size() < m_records.size()};
+  const std::span<const std::byte> stored{isCompressed ? compressed
+                                                       : m_records};
+
+  std::vector<std::byte> header;
+  const auto *magicBytes{reinterpret_cast<const std::byte *>(magic.data())};
+  header.insert(header.end(), magicBytes, magicBytes + magic.size());
+  appendValue<std::uint32_t>(header, version);
+  appendValue<std::uint32_t>(header, sizeof(SDL_Event));
+  appendValue<std::uint32_t>(header,
+                             static_cast<std::uint32_t>(m_windowSizes.size()));
+  for (const auto &size : m_windowSizes) {
+    appendValue<std::int32_t>(header, size.x);
+    appendValue<std::int32_t>(header, size.y);
+  }
+  appendValue<std::uint64_t>(header, m_records.size());
+  appendValue<std::uint64_t>(header, stored.size());
+
+  std::ofstream stream(path, std::ios::binary);
+  stream.write(reinterpret_cast<const char *>(header.data()),
+               static_cast<std::streamsize>(header.size()));
+  stream.write(reinterpret_cast<const char *>(stored.data()),
+               static_cast<std::streamsize>(stored.size()));
+  m_records.clear();
+  if (!stream) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Failed to write recording {}", path))};
+  }
+}
+
+/**
+ * @brief Appends a record to the recording.
+ *
+ * @param record Record to append.
+ */
+void abcg::EventRecorder::write(const ReplayRecord &record) {
+  if (!isOpen()) return;
+
+  appendValue(m_records, record.type);
+  appendValue(m_records, record.window);
+  switch (record.type) {
+    case ReplayRecord::Type::Event:
+    case ReplayRecord::Type::Sample:
+      appendValue(m_records, record.event);
+      break;
+    case ReplayRecord::Type::Frame:
+      appendValue(m_records, record.deltaTime);
+      appendValue(m_records, record.elapsedTime);
+      break;
+    case ReplayRecord::Type::EndOfIteration:
+      break;
+  }
+}
+
+/**
+ * @brief Reads a recording created by abcg::EventRecorder.
+ *
+ * @param path Path to the recording.
+ *
+ * @throw abcg::Exception if the file cannot be read or is not a valid
+ * recording of the same platform.
+ */
+void abcg::EventPlayer::open(std::string_view path) {
+  close();
+
+  MappedFile file;
+  file.open(path);
+  const auto data{file.data()};
+
+  std::uint64_t offset{};
+  std::array<char, magic.size()> fileMagic{};
+  for (auto &character : fileMagic) {
+    character = readValue<char>(data, offset);
+  }
+  if (fileMagic != magic || readValue<std::uint32_t>(data, offset) != version ||
+      readValue<std::uint32_t>(data, offset) != sizeof(SDL_Event)) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("{} is not a valid recording", path))};
+  }
+
+  const auto windowCount{readValue<std::uint32_t>(data, offset)};
+  for ([[maybe_unused]] const auto index : std::views::iota(0U, windowCount)) {
+    glm::ivec2 size{};
+    size.x = readValue<std::int32_t>(data, offset);
+    size.y = readValue<std::int32_t>(data, offset);
+    m_windowSizes.push_back(size);
+  }
+
+  const auto recordsSize{readValue<std::uint64_t>(data, offset)};
+  const auto storedSize{readValue<std::uint64_t>(data, offset)};
+  if (offset + storedSize > data.size()) {
+    throw abcg::Exception{abcg::Exception::Runtime("Truncated recording")};
+  }
+  const auto stored{data.subspan(offset, storedSize)};
+  std::vector<std::byte> records(recordsSize);
+  if (storedSize < recordsSize) {
+    decompressLZ4(stored, records);
+  } else {
+    std::ranges::copy(stored, records.begin());
+  }
+
+  offset = 0;
+  while (offset < records.size()) {
+    ReplayRecord record;
+    record.type = readValue<ReplayRecord::Type>(records, offset);
+    record.window = readValue<std::uint8_t>(records, offset);
+    switch (record.type) {
+      case ReplayRecord::Type::Event:
+      case ReplayRecord::Type::Sample:
+        record.event = readValue<SDL_Event>(records, offset);
+        break;
+      case ReplayRecord::Type::Frame:
+        record.deltaTime = readValue<double>(records, offset);
+        record.elapsedTime = readValue<double>(records, offset);
+        break;
+      case ReplayRecord::Type::EndOfIteration:
+        break;
+      default:
+        throw abcg::Exception{abcg::Exception::Runtime(
+            fmt::format("{} is not a valid recording", path))};
+    }
+    m_records.push_back(record);
+  }
+  m_open = true;
+}
+
+/**
+ * @brief Closes the recording.
+ */
+void abcg::EventPlayer::close() {
+  m_windowSizes.clear();
+  m_records.clear();
+  m_position = 0;
+  m_open = false;
+}
+
+/**
+ * @brief Returns the next record without consuming it.
+ *
+ * @return Pointer to the next record, or nullptr at the end of the
+ * recording.
+ */
+const abcg::ReplayRecord *abcg::EventPlayer::peek() const {
+  return atEnd() ? nullptr : &m_records[m_position];
+}
+
+/**
+ * @brief Consumes the next record.
+ *
+ * @return Next record, or an end of iteration record at the end of the
+ * recording.
+ */
+abcg::ReplayRecord abcg::EventPlayer::read() {
+  if (atEnd()) return {.type = ReplayRecord::Type::EndOfIteration};
+  return m_records[m_position++];
+}
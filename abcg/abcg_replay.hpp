@@ -0,0 +1,99 @@
+/**
+ * @file abcg_replay.hpp
+ * @brief Declaration of abcg::EventRecorder and abcg::EventPlayer.
+ *
+ * A recording stores the input events and the time steps of each frame of
+ * an application, so that a session can be played back with the same
+ * updates, e.g. to compare frame times across builds.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_REPLAY_HPP_
+#define ABCG_REPLAY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/vec2.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "abcg_external.hpp"
+
+namespace abcg {
+class EventPlayer;
+class EventRecorder;
+struct ReplayRecord;
+}  // namespace abcg
+
+/**
+ * @brief Entry of a recording.
+ *
+ * Each iteration of the main loop is stored as the events received from SDL,
+ * followed by the frames painted in that iteration and an end of iteration
+ * marker. Each frame is followed by the mouse motion events sampled during
+ * the frame with abcg::Input::sample.
+ */
+struct abcg::ReplayRecord {
+  enum class Type : std::uint8_t { Event, Sample, Frame, EndOfIteration };
+
+  Type type{};
+  // Index of the window in the list passed to abcg::Application::run
+  std::uint8_t window{};
+  // Event and Sample records
+  SDL_Event event{};
+  // Frame records, in seconds
+  double deltaTime{};
+  double elapsedTime{};
+};
+
+/**
+ * @brief abcg::EventRecorder class.
+ *
+ * Records are kept in memory and written to the file, compressed with LZ4,
+ * when the recorder is closed. Recordings store events as they are laid out
+ * in memory, so they can only be played back by builds for the same
+ * platform.
+ */
+class abcg::EventRecorder {
+ public:
+  void open(std::string_view path, std::span<const glm::ivec2> windowSizes);
+  void close();
+  void write(const ReplayRecord &record);
+
+  [[nodiscard]] bool isOpen() const { return !m_path.empty(); }
+
+ private:
+  std::string m_path;
+  std::vector<glm::ivec2> m_windowSizes;
+  std::vector<std::byte> m_records;
+};
+
+/**
+ * @brief abcg::EventPlayer class.
+ *
+ * Reads a recording created by abcg::EventRecorder.
+ */
+class abcg::EventPlayer {
+ public:
+  void open(std::string_view path);
+  void close();
+  [[nodiscard]] const ReplayRecord *peek() const;
+  ReplayRecord read();
+
+  [[nodiscard]] bool isOpen() const { return m_open; }
+  [[nodiscard]] bool atEnd() const { return m_position >= m_records.size(); }
+  [[nodiscard]] std::span<const glm::ivec2> getWindowSizes() const {
+    return m_windowSizes;
+  }
+
+ private:
+  std::vector<glm::ivec2> m_windowSizes;
+  std::vector<ReplayRecord> m_records;
+  std::size_t m_position{};
+  bool m_open{};
+};
+
+#endif
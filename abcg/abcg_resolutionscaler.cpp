@@ -0,0 +1,86 @@
+/**
+ * @file abcg_resolutionscaler.cpp
+ * @brief Definition of abcg::ResolutionScaler members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_resolutionscaler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr float scaleStep{0.05f};
+// Frames to wait after a change, as GPU times arrive a few frames late
+constexpr int settleFrames{8};
+// Weight of the latest frame time in the moving average
+constexpr double averageWeight{0.1};
+// Fraction of the target frame time below which the scale rises
+constexpr double raiseThreshold{0.75};
+}  // namespace
+
+/**
+ * @brief Updates the scale with the time of the last frame.
+ *
+ * @param frameTime Time of the last frame, in seconds.
+ *
+ * @return Whether the scale changed.
+ */
+bool abcg::ResolutionScaler::update(double frameTime) {
+  if (frameTime <= 0.0) return false;
+
+  m_averageFrameTime =
+      m_averageFrameTime == 0.0
+          ? frameTime
+          : std::lerp(m_averageFrameTime, frameTime, averageWeight);
+  if (++m_framesSinceChange < settleFrames) return false;
+
+  const auto target{m_settings.targetFrameTime};
+  auto scale{m_scale};
+  if (m_averageFrameTime > target) {
+    // Pixels to drop for the frame time to reach the target
+    const auto ratio{std::sqrt(target / m_averageFrameTime)};
+    // Round down, with a tolerance for the rounding errors of the steps
+    scale = std::floor(m_scale * static_cast<float>(ratio) / scaleStep +
+                       1.0e-3f) *
+            scaleStep;
+  } else if (m_averageFrameTime < target * raiseThreshold) {
+    scale = m_scale + scaleStep;
+  }
+  scale = std::clamp(scale, m_settings.minScale, m_settings.maxScale);
+  if (std::abs(scale - m_scale) < scaleStep * 0.5f) return false;
+
+  // Expected frame time at the new scale, until new times arrive
+  const auto pixelRatio{static_cast<double>(scale / m_scale)};
+  m_averageFrameTime *= pixelRatio * pixelRatio;
+  m_scale = scale;
+  m_framesSinceChange = 0;
+  return true;
+}
+
+/**
+ * @brief Restores the maximum scale and discards the frame times.
+ *
+ */
+void abcg::ResolutionScaler::reset() {
+  m_scale = m_settings.maxScale;
+  m_averageFrameTime = 0.0;
+  m_framesSinceChange = 0;
+}
+
+/**
+ * @brief Sets the range of the scale and the target frame time.
+ *
+ * The scale is clamped to the new range.
+ *
+ * @param settings Scaler settings.
+ */
+void abcg::ResolutionScaler::setSettings(
+    const ResolutionScalerSettings &settings) {
+  m_settings = settings;
+  m_settings.minScale = std::clamp(m_settings.minScale, scaleStep, 1.0f);
+  m_settings.maxScale =
+      std::clamp(m_settings.maxScale, m_settings.minScale, 1.0f);
+  m_scale = std::clamp(m_scale, m_settings.minScale, m_settings.maxScale);
+}
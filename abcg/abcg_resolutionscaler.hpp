@@ -0,0 +1,60 @@
+/**
+ * @file abcg_resolutionscaler.hpp
+ * @brief Declaration of abcg::ResolutionScaler.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_RESOLUTIONSCALER_HPP_
+#define ABCG_RESOLUTIONSCALER_HPP_
+
+namespace abcg {
+class ResolutionScaler;
+struct ResolutionScalerSettings;
+}  // namespace abcg
+
+/**
+ * @brief Settings of abcg::ResolutionScaler.
+ *
+ */
+struct abcg::ResolutionScalerSettings {
+  // Range of the scale of the width and height of the rendering
+  float minScale{0.5f};
+  float maxScale{1.0f};
+  // Frame time to hold, in seconds
+  double targetFrameTime{1.0 / 60.0};
+};
+
+/**
+ * @brief abcg::ResolutionScaler class.
+ *
+ * Chooses the scale of the rendering resolution from measured frame times,
+ * assuming that the frame time is proportional to the number of pixels.
+ * The scale drops as soon as frames are slower than the target, and rises
+ * one step at a time while they are well below it. The scale changes in
+ * steps of 5%, and only after the previous change shows in the frame times,
+ * so that render targets are not resized on every frame.
+ */
+class abcg::ResolutionScaler {
+ public:
+  bool update(double frameTime);
+  void reset();
+
+  void setSettings(const ResolutionScalerSettings &settings);
+  [[nodiscard]] const ResolutionScalerSettings &getSettings() const {
+    return m_settings;
+  }
+  [[nodiscard]] float getScale() const { return m_scale; }
+  [[nodiscard]] double getAverageFrameTime() const {
+    return m_averageFrameTime;
+  }
+
+ private:
+  ResolutionScalerSettings m_settings{};
+  float m_scale{1.0f};
+  // Moving average of the frame time, or zero before the first frame
+  double m_averageFrameTime{};
+  int m_framesSinceChange{};
+};
+
+#endif
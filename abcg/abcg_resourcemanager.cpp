@@ -0,0 +1,196 @@
+/**
+ * @file abcg_resourcemanager.cpp
+ * @brief Definition of abcg::ResourceManager members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_resourcemanager.hpp"
+
+#include <initializer_list>
+#include <utility>
+
+#include "abcg_exception.hpp"
+#include "abcg_image.hpp"
+#include "abcg_model.hpp"
+#include "abcg_openglfunctions.hpp"
+
+namespace {
+// Cache key made of file paths and loading parameters
+[[nodiscard]] std::string makeKey(
+    std::initializer_list<std::string_view> parts) {
+  std::string key;
+  for (const auto part : parts) {
+    key += part;
+    key += '\n';
+  }
+  return key;
+}
+
+// Returns the cached resource of the given key, or loads and caches it
+template <typename T, typename Loader>
+[[nodiscard]] std::shared_ptr<T> acquire(
+    std::unordered_map<std::string, std::weak_ptr<T>> &cache,
+    const std::string &key, Loader &&load) {
+  if (auto it{cache.find(key)}; it != cache.end()) {
+    if (auto resource{it->second.lock()}) return resource;
+  }
+
+  // Forget resources that are no longer in use
+  std::erase_if(cache, [](const auto &item) { return item.second.expired(); });
+
+  std::shared_ptr<T> resource{std::forward<Loader>(load)()};
+  cache.insert_or_assign(key, resource);
+  return resource;
+}
+
+// OpenGL objects can only be deleted while a context is current
+[[nodiscard]] bool hasContext() {
+  return SDL_GL_GetCurrentContext() != nullptr;
+}
+
+[[nodiscard]] abcg::TextureHandle makeTextureHandle(GLuint textureID) {
+  return {new GLuint{textureID}, [](const GLuint *texture) {
+            if (hasContext()) abcg::glDeleteTextures(1, texture);
+            delete texture;
+          }};
+}
+}  // namespace
+
+/**
+ * @brief Returns a handle to a 2D texture loaded from an image file.
+ *
+ * @param path Path to the image file.
+ * @param generateMipmaps Whether to generate mipmap levels.
+ *
+ * @return Handle to the texture.
+ *
+ * @throw abcg::Exception if the image cannot be loaded.
+ *
+ * @sa abcg::opengl::loadTexture
+ */
+abcg::TextureHandle abcg::ResourceManager::loadTexture(std::string_view path,
+                                                       bool generateMipmaps) {
+  if (m_shared != nullptr) return m_shared->loadTexture(path, generateMipmaps);
+  return acquire(m_textures, makeKey({"2D", path, generateMipmaps ? "1" : "0"}),
+                 [&] {
+                   return makeTextureHandle(
+                       abcg::opengl::loadTexture(path, generateMipmaps));
+                 });
+}
+
+/**
+ * @brief Returns a handle to a cube map texture loaded from six image files.
+ *
+ * @param paths Paths to the images of the faces, in the order expected by
+ * abcg::opengl::loadCubemap.
+ * @param generateMipmaps Whether to generate mipmap levels.
+ * @param rightHandedSystem Whether to use a right-handed coordinate system.
+ *
+ * @return Handle to the texture.
+ *
+ * @throw abcg::Exception if an image cannot be loaded.
+ *
+ * @sa abcg::opengl::loadCubemap
+ */
+abcg::TextureHandle abcg::ResourceManager::loadCubemap(
+    std::array<std::string_view, 6> paths, bool generateMipmaps,
+    bool rightHandedSystem) {
+  if (m_shared != nullptr) {
+    return m_shared->loadCubemap(paths, generateMipmaps, rightHandedSystem);
+  }
+  return acquire(
+      m_textures,
+      makeKey({"Cube", paths[0], paths[1], paths[2], paths[3], paths[4],
+               paths[5], generateMipmaps ? "1" : "0",
+               rightHandedSystem ? "1" : "0"}),
+      [&] {
+        return makeTextureHandle(abcg::opengl::loadCubemap(
+            paths, generateMipmaps, rightHandedSystem));
+      });
+}
+
+/**
+ * @brief Returns a handle to a model loaded from a Wavefront OBJ or glTF
+ * file.
+ *
+ * @param path Path to the model file.
+ *
+ * @return Handle to the model.
+ *
+ * @throw abcg::Exception if the file cannot be loaded.
+ *
+ * @sa abcg::Model::load
+ */
+abcg::ModelHandle abcg::ResourceManager::loadModel(std::string_view path) {
+  return acquire(m_models, makeKey({path}), [&] {
+    ModelHandle model{new Model, [](Model *pointer) {
+                        if (hasContext()) pointer->destroy();
+                        delete pointer;
+                      }};
+    model->load(path);
+    return model;
+  });
+}
+
+/**
+ * @brief Returns a handle to a shader program created from shader files.
+ *
+ * @param pathToVertexShader Path to the vertex shader source.
+ * @param pathToFragmentShader Path to the fragment shader source.
+ *
+ * @return Handle to the program.
+ *
+ * @throw abcg::Exception if no program factory is set or if the program
+ * cannot be created.
+ *
+ * @sa setProgramFactory
+ */
+abcg::ProgramHandle abcg::ResourceManager::loadProgram(
+    std::string_view pathToVertexShader,
+    std::string_view pathToFragmentShader) {
+  if (m_shared != nullptr) {
+    return m_shared->loadProgram(pathToVertexShader, pathToFragmentShader);
+  }
+  return acquire(
+      m_programs, makeKey({pathToVertexShader, pathToFragmentShader}), [&] {
+        if (!m_createProgram) {
+          throw abcg::Exception{
+              abcg::Exception::Runtime("Program factory not set")};
+        }
+        return ProgramHandle{
+            new GLuint{m_createProgram(pathToVertexShader,
+                                       pathToFragmentShader)},
+            [](const GLuint *program) {
+              if (hasContext()) abcg::glDeleteProgram(*program);
+              delete program;
+            }};
+      });
+}
+
+/**
+ * @brief Sets the function used to create shader programs from files.
+ *
+ * abcg::OpenGLWindow sets it to abcg::OpenGLWindow::createProgramFromFile, so
+ * that shaders get the GLSL version header of the window.
+ *
+ * @param createProgram Function that takes the paths to the vertex and
+ * fragment shaders and returns the program.
+ */
+void abcg::ResourceManager::setProgramFactory(ProgramFactory createProgram) {
+  m_createProgram = std::move(createProgram);
+}
+
+/**
+ * @brief Takes textures and programs from another manager.
+ *
+ * Textures and programs are then loaded by `shared`, with its program
+ * factory, and cached there. Models are still loaded and cached by this
+ * manager, since their VAOs belong to the context they were created in.
+ *
+ * @param shared Manager whose OpenGL context shares objects with the context
+ * of this manager. It must outlive this manager.
+ */
+void abcg::ResourceManager::shareWith(ResourceManager &shared) {
+  m_shared = &shared;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file abcg_resourcemanager.hpp
+ * @brief abcg::ResourceManager header file.
+ *
+ * Declaration of abcg::ResourceManager class, a cache of OpenGL resources
+ * (textures, models and shader programs) shared by reference-counted
+ * handles.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_RESOURCEMANAGER_HPP_
+#define ABCG_RESOURCEMANAGER_HPP_
+
+#include <abcg_external.hpp>
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace abcg {
+class Model;
+class ResourceManager;
+
+using TextureHandle = std::shared_ptr<const GLuint>;
+using ProgramHandle = std::shared_ptr<const GLuint>;
+using ModelHandle = std::shared_ptr<Model>;
+}  // namespace abcg
+
+/**
+ * @brief abcg::ResourceManager class.
+ *
+ * Resources are identified by their file paths and loading parameters.
+ * Requesting a resource that is already loaded returns a new handle to the
+ * same resource instead of loading it again. The OpenGL objects of a
+ * resource are deleted when its last handle is released.
+ *
+ * Handles must be released while the OpenGL context is current, usually in
+ * abcg::OpenGLWindow::terminateGL. Handles released after the context is
+ * destroyed do not delete their OpenGL objects.
+ *
+ * Models are shared between all handles to the same file. Since VAOs are
+ * created by abcg::Model::setupVAO, handles to the same model should be used
+ * with the same shader program.
+ *
+ * VAOs are not shared between OpenGL contexts, even contexts that share
+ * other objects. A manager whose contexts share objects with the context of
+ * another manager can take its textures and programs with shareWith(), but
+ * keeps a cache of models of its own.
+ */
+class abcg::ResourceManager {
+ public:
+  using ProgramFactory =
+      std::function<GLuint(std::string_view, std::string_view)>;
+
+  [[nodiscard]] TextureHandle loadTexture(std::string_view path,
+                                          bool generateMipmaps = true);
+  [[nodiscard]] TextureHandle loadCubemap(
+      std::array<std::string_view, 6> paths, bool generateMipmaps = true,
+      bool rightHandedSystem = true);
+  [[nodiscard]] ModelHandle loadModel(std::string_view path);
+  [[nodiscard]] ProgramHandle loadProgram(
+      std::string_view pathToVertexShader,
+      std::string_view pathToFragmentShader);
+
+  void setProgramFactory(ProgramFactory createProgram);
+  void shareWith(ResourceManager &shared);
+
+ private:
+  std::unordered_map<std::string, std::weak_ptr<const GLuint>> m_textures;
+  std::unordered_map<std::string, std::weak_ptr<Model>> m_models;
+  std::unordered_map<std::string, std::weak_ptr<const GLuint>> m_programs;
+
+  ProgramFactory m_createProgram;
+
+  // Manager that owns the textures and programs, if not this one
+  ResourceManager *m_shared{};
+};
+
+#endif
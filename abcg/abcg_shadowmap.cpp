@@ -0,0 +1,393 @@
+/**
+ * @file abcg_shadowmap.cpp
+ * @brief Definition of abcg::CascadedShadowMap members.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_shadowmap.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cppitertools/itertools.hpp>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/vec4.hpp>
+
+#include "abcg_exception.hpp"
+#include "abcg_openglfunctions.hpp"
+
+namespace {
+// Casters are transformed by the light only. No fragment work is done, as
+// only the depth is written
+constexpr std::string_view depthVertexShader{R"glsl(
+layout(location = 0) in vec3 inPosition;
+
+uniform mat4 modelMatrix;
+uniform mat4 lightViewProjMatrix;
+
+void main() {
+  gl_Position = lightViewProjMatrix * modelMatrix * vec4(inPosition, 1.0);
+}
+)glsl"};
+
+constexpr std::string_view depthFragmentShader{R"glsl(
+void main() {}
+)glsl"};
+
+// Maps clip space [-1, 1] to texture space [0, 1]
+const glm::mat4 biasMatrix{0.5f, 0.0f, 0.0f, 0.0f,  //
+                           0.0f, 0.5f, 0.0f, 0.0f,  //
+                           0.0f, 0.0f, 0.5f, 0.0f,  //
+                           0.5f, 0.5f, 0.5f, 1.0f};
+
+int getFilterRadius(abcg::ShadowFilter filter) {
+  switch (filter) {
+    case abcg::ShadowFilter::PCF3x3:
+      return 1;
+    case abcg::ShadowFilter::PCF5x5:
+      return 2;
+    default:
+      return 0;
+  }
+}
+}  // namespace
+
+/**
+ * @brief Creates the depth texture array of the cascades.
+ *
+ * Deletes the previous one, if any.
+ *
+ * @param depthProgram Program made of getDepthVertexShader() and
+ * getDepthFragmentShader(). The shadow map takes ownership of it.
+ * @param settings Cascades, resolution budget and filter of the shadows.
+ *
+ * @throw abcg::Exception if the framebuffer is incomplete.
+ */
+void abcg::CascadedShadowMap::create(GLuint depthProgram,
+                                     const ShadowMapSettings &settings) {
+  destroy();
+
+  m_program = depthProgram;
+  m_modelMatrixLocation =
+      abcg::glGetUniformLocation(m_program, "modelMatrix");
+  m_lightViewProjMatrixLocation =
+      abcg::glGetUniformLocation(m_program, "lightViewProjMatrix");
+  abcg::glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_maxTextureSize);
+
+  setSettings(settings);
+}
+
+/**
+ * @brief Changes the settings of the shadow map.
+ *
+ * The texture is recreated only if the number of cascades or their
+ * resolution changes, e.g. when the window is resized with a texel budget
+ * that follows its size. Avoid budgets that change often, as each new
+ * resolution reallocates the texture.
+ *
+ * @param settings Cascades, resolution budget and filter of the shadows.
+ */
+void abcg::CascadedShadowMap::setSettings(const ShadowMapSettings &settings) {
+  const auto previousFilter{m_settings.filter};
+  m_settings = settings;
+  if (m_program == 0) return;
+
+  const auto cascadeCount{static_cast<std::size_t>(std::clamp(
+      settings.cascadeCount, 1, static_cast<int>(maxCascades)))};
+
+  const auto maxResolution{std::min(settings.maxResolution, m_maxTextureSize)};
+  const auto minResolution{std::min(settings.minResolution, maxResolution)};
+  const auto share{std::max(settings.texelBudget, 0) /
+                   static_cast<int>(cascadeCount)};
+  const auto resolution{std::clamp(
+      static_cast<int>(std::sqrt(static_cast<double>(share))) / 128 * 128,
+      minResolution, maxResolution)};
+
+  if (m_texture == 0 || cascadeCount != m_cascadeCount ||
+      resolution != m_resolution) {
+    m_cascadeCount = cascadeCount;
+    m_resolution = resolution;
+    createTexture();
+  } else if (settings.filter != previousFilter) {
+    applyFilter();
+  }
+}
+
+/**
+ * @brief Deletes the program, texture and framebuffer of the shadow map.
+ *
+ */
+void abcg::CascadedShadowMap::destroy() {
+  abcg::glDeleteProgram(m_program);
+  abcg::glDeleteTextures(1, &m_texture);
+  abcg::glDeleteFramebuffers(1, &m_framebuffer);
+
+  m_program = m_texture = m_framebuffer = 0;
+  m_modelMatrixLocation = m_lightViewProjMatrixLocation = -1;
+  m_cascadeCount = 0;
+  m_resolution = 0;
+}
+
+/**
+ * @brief Fits the cascades to the view frustum of the camera.
+ *
+ * The frustum is split at distances between a uniform and a logarithmic
+ * distribution (see ShadowMapSettings::splitLambda). Each cascade covers
+ * the bounding sphere of its slice, extended toward the light to include
+ * every caster.
+ *
+ * @param viewMatrix View matrix of the camera.
+ * @param projMatrix Perspective projection matrix of the camera.
+ * @param lightDirection Direction the light travels, in world space.
+ * @param casterBounds Sphere that contains every shadow caster.
+ */
+void abcg::CascadedShadowMap::update(const glm::mat4 &viewMatrix,
+                                     const glm::mat4 &projMatrix,
+                                     const glm::vec3 &lightDirection,
+                                     const BoundingSphere &casterBounds) {
+  if (m_resolution == 0) return;
+
+  // Near and far distances and half-angle tangents of the frustum
+  const auto nearDistance{projMatrix[3][2] / (projMatrix[2][2] - 1.0f)};
+  const auto farDistance{projMatrix[3][2] / (projMatrix[2][2] + 1.0f)};
+  const glm::vec2 tanHalfFOV{1.0f / projMatrix[0][0],
+                             1.0f / projMatrix[1][1]};
+
+  const auto direction{glm::normalize(lightDirection)};
+  const glm::vec3 up{std::abs(direction.y) > 0.99f ? glm::vec3{1, 0, 0}
+                                                   : glm::vec3{0, 1, 0}};
+  m_lightViewMatrix = glm::lookAt(glm::vec3{0.0f}, direction, up);
+
+  const auto inverseViewMatrix{glm::inverse(viewMatrix)};
+  const auto casterDepth{
+      (m_lightViewMatrix * glm::vec4{casterBounds.center, 1.0f}).z +
+      casterBounds.radius};
+
+  auto previousSplit{nearDistance};
+  for (const auto index : iter::range(m_cascadeCount)) {
+    auto &cascade{m_cascades.at(index)};
+
+    const auto fraction{static_cast<float>(index + 1) /
+                        static_cast<float>(m_cascadeCount)};
+    const auto uniformSplit{nearDistance +
+                            (farDistance - nearDistance) * fraction};
+    const auto logSplit{nearDistance *
+                        std::pow(farDistance / nearDistance, fraction)};
+    const auto split{
+        glm::mix(uniformSplit, logSplit, m_settings.splitLambda)};
+
+    // Bounding sphere of the slice in view space. Its radius does not
+    // change as the camera turns, so neither does the texel size
+    const glm::vec3 center{0.0f, 0.0f, -(previousSplit + split) * 0.5f};
+    float radius{};
+    for (const auto distance : {previousSplit, split}) {
+      const glm::vec3 corner{tanHalfFOV * distance, -distance};
+      radius = std::max(radius, glm::distance(center, corner));
+    }
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+
+    // Snap the center to texels of the light view
+    auto lightCenter{glm::vec3{m_lightViewMatrix * inverseViewMatrix *
+                               glm::vec4{center, 1.0f}}};
+    const auto texelSize{2.0f * radius / static_cast<float>(m_resolution)};
+    lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+    lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+    cascade.min = glm::vec2{lightCenter} - radius;
+    cascade.max = glm::vec2{lightCenter} + radius;
+    cascade.minDepth = lightCenter.z - radius;
+    cascade.splitDistance = split;
+
+    const auto maxDepth{std::max(lightCenter.z + radius, casterDepth)};
+    const auto projection{glm::ortho(cascade.min.x, cascade.max.x,
+                                     cascade.min.y, cascade.max.y,
+                                     -maxDepth, -cascade.minDepth)};
+    cascade.viewProjMatrix = projection * m_lightViewMatrix;
+
+    previousSplit = split;
+  }
+}
+
+/**
+ * @brief Renders the shadow casters into each cascade.
+ *
+ * The depth program is in use while the casters are rendered. Both faces
+ * are rendered, so that open and single-sided casters also cast shadows.
+ * The framebuffer and viewport are restored afterwards, so this can be
+ * called during OpenGLWindow::paintGL.
+ *
+ * @param renderCasters Function that renders the casters of a cascade. It
+ * must set the model matrix of each caster at the given uniform location
+ * and should skip casters for which isVisible() is false.
+ */
+void abcg::CascadedShadowMap::render(
+    const CasterRenderer &renderCasters) const {
+  if (m_framebuffer == 0) return;
+
+  GLint previousFramebuffer{};
+  abcg::glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+  std::array<GLint, 4> previousViewport{};
+  abcg::glGetIntegerv(GL_VIEWPORT, previousViewport.data());
+  const auto depthTest{abcg::glIsEnabled(GL_DEPTH_TEST)};
+  const auto cullFace{abcg::glIsEnabled(GL_CULL_FACE)};
+
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  abcg::glViewport(0, 0, m_resolution, m_resolution);
+  abcg::glEnable(GL_DEPTH_TEST);
+  abcg::glDisable(GL_CULL_FACE);
+  abcg::glEnable(GL_POLYGON_OFFSET_FILL);
+  abcg::glPolygonOffset(m_settings.slopeBias, m_settings.constantBias);
+  abcg::glUseProgram(m_program);
+
+  for (const auto index : iter::range(m_cascadeCount)) {
+    abcg::glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                    m_texture, 0, static_cast<GLint>(index));
+    abcg::glClear(GL_DEPTH_BUFFER_BIT);
+    abcg::glUniformMatrix4fv(
+        m_lightViewProjMatrixLocation, 1, GL_FALSE,
+        glm::value_ptr(m_cascades.at(index).viewProjMatrix));
+    renderCasters(index, m_modelMatrixLocation);
+  }
+
+  abcg::glUseProgram(0);
+  abcg::glDisable(GL_POLYGON_OFFSET_FILL);
+  if (depthTest == GL_FALSE) abcg::glDisable(GL_DEPTH_TEST);
+  if (cullFace == GL_TRUE) abcg::glEnable(GL_CULL_FACE);
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER,
+                          static_cast<GLuint>(previousFramebuffer));
+  abcg::glViewport(previousViewport[0], previousViewport[1],
+                   previousViewport[2], previousViewport[3]);
+}
+
+/**
+ * @brief Binds the shadow map and sets the uniforms of the shadows.
+ *
+ * Must be called with the program that shades the receivers in use.
+ * Uniforms that are not found in the program are ignored.
+ *
+ * @param program Program of the receivers.
+ * @param textureUnit Texture unit of the shadow map.
+ */
+void abcg::CascadedShadowMap::bindTexture(GLuint program,
+                                          GLint textureUnit) const {
+  abcg::glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(textureUnit));
+  abcg::glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+
+  std::array<glm::mat4, maxCascades> shadowMatrices{};
+  glm::vec4 splits{0.0f};
+  for (const auto index : iter::range(m_cascadeCount)) {
+    const auto &cascade{m_cascades.at(index)};
+    shadowMatrices.at(index) = biasMatrix * cascade.viewProjMatrix;
+    splits[static_cast<glm::length_t>(index)] = cascade.splitDistance;
+  }
+
+  abcg::glUniform1i(abcg::glGetUniformLocation(program, "shadowMap"),
+                    textureUnit);
+  abcg::glUniformMatrix4fv(
+      abcg::glGetUniformLocation(program, "shadowMatrices"),
+      static_cast<GLsizei>(m_cascadeCount), GL_FALSE,
+      glm::value_ptr(shadowMatrices.front()));
+  abcg::glUniform4fv(abcg::glGetUniformLocation(program, "cascadeSplits"), 1,
+                     glm::value_ptr(splits));
+  abcg::glUniform1i(abcg::glGetUniformLocation(program, "cascadeCount"),
+                    static_cast<GLint>(m_cascadeCount));
+  abcg::glUniform1i(abcg::glGetUniformLocation(program, "shadowFilterRadius"),
+                    getFilterRadius(m_settings.filter));
+}
+
+/**
+ * @brief Returns whether a caster can cast shadows into a cascade.
+ *
+ * Casters outside the cascade, or behind all of its receivers as seen from
+ * the light, are culled.
+ *
+ * @param cascade Index of the cascade.
+ * @param bounds Bounding sphere of the caster in world space.
+ */
+bool abcg::CascadedShadowMap::isVisible(std::size_t cascade,
+                                        const BoundingSphere &bounds) const {
+  if (cascade >= m_cascadeCount) return false;
+
+  const auto &bound{m_cascades.at(cascade)};
+  const auto center{
+      glm::vec3{m_lightViewMatrix * glm::vec4{bounds.center, 1.0f}}};
+  return center.x + bounds.radius >= bound.min.x &&
+         center.x - bounds.radius <= bound.max.x &&
+         center.y + bounds.radius >= bound.min.y &&
+         center.y - bounds.radius <= bound.max.y &&
+         center.z + bounds.radius >= bound.minDepth;
+}
+
+/**
+ * @brief Returns the vertex shader of the depth program.
+ *
+ * Reads the position at location 0, as abcg::Model::renderGeometry expects.
+ */
+std::string_view abcg::CascadedShadowMap::getDepthVertexShader() {
+  return depthVertexShader;
+}
+
+/**
+ * @brief Returns the fragment shader of the depth program, which does
+ * nothing.
+ *
+ */
+std::string_view abcg::CascadedShadowMap::getDepthFragmentShader() {
+  return depthFragmentShader;
+}
+
+void abcg::CascadedShadowMap::createTexture() {
+  abcg::glDeleteTextures(1, &m_texture);
+  abcg::glDeleteFramebuffers(1, &m_framebuffer);
+
+  abcg::glGenTextures(1, &m_texture);
+  abcg::glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+  abcg::glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24,
+                     m_resolution, m_resolution,
+                     static_cast<GLsizei>(m_cascadeCount), 0,
+                     GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+  abcg::glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S,
+                        GL_CLAMP_TO_EDGE);
+  abcg::glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T,
+                        GL_CLAMP_TO_EDGE);
+  abcg::glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE,
+                        GL_COMPARE_REF_TO_TEXTURE);
+  abcg::glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC,
+                        GL_LEQUAL);
+  applyFilter();
+
+  GLint previousFramebuffer{};
+  abcg::glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+  abcg::glGenFramebuffers(1, &m_framebuffer);
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+  abcg::glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                  m_texture, 0, 0);
+  const GLenum buffer{GL_NONE};
+  abcg::glDrawBuffers(1, &buffer);
+  abcg::glReadBuffer(GL_NONE);
+  const auto status{abcg::glCheckFramebufferStatus(GL_FRAMEBUFFER)};
+  abcg::glBindFramebuffer(GL_FRAMEBUFFER,
+                          static_cast<GLuint>(previousFramebuffer));
+
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    throw abcg::Exception{abcg::Exception::Runtime(
+        fmt::format("Shadow map framebuffer is incomplete ({:#x})", status))};
+  }
+}
+
+// Hard shadows take the nearest texel. The other filters take one bilinear
+// comparison per lookup
+void abcg::CascadedShadowMap::applyFilter() const {
+  const auto filter{m_settings.filter == ShadowFilter::Hard ? GL_NEAREST
+                                                            : GL_LINEAR};
+  abcg::glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+  abcg::glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, filter);
+  abcg::glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
+  abcg::glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
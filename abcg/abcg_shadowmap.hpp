@@ -0,0 +1,177 @@
+/**
+ * @file abcg_shadowmap.hpp
+ * @brief Declaration of abcg::CascadedShadowMap.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_SHADOWMAP_HPP_
+#define ABCG_SHADOWMAP_HPP_
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <string_view>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "abcg_external.hpp"
+
+namespace abcg {
+struct BoundingSphere;
+class CascadedShadowMap;
+enum class ShadowFilter;
+struct ShadowMapSettings;
+}  // namespace abcg
+
+/**
+ * @brief Sphere that contains an object, in world space.
+ *
+ */
+struct abcg::BoundingSphere {
+  glm::vec3 center{};
+  float radius{};
+};
+
+/**
+ * @brief Filtering of the shadow map lookups of abcg::CascadedShadowMap.
+ *
+ */
+enum class abcg::ShadowFilter {
+  // One nearest-neighbor comparison per fragment
+  Hard,
+  // One comparison with hardware bilinear filtering
+  Bilinear,
+  // 3x3 bilinear comparisons (percentage-closer filtering)
+  PCF3x3,
+  // 5x5 bilinear comparisons (percentage-closer filtering)
+  PCF5x5
+};
+
+/**
+ * @brief Settings of abcg::CascadedShadowMap.
+ *
+ */
+struct abcg::ShadowMapSettings {
+  // Number of cascades, from 1 to CascadedShadowMap::maxCascades
+  int cascadeCount{3};
+  // Distribution of the split distances, from uniform (0) to logarithmic (1)
+  float splitLambda{0.75f};
+  // Texels of all cascades together. Each cascade gets an equal share, with
+  // a resolution rounded down to a multiple of 128 and clamped to
+  // [minResolution, maxResolution]
+  int texelBudget{3 * 1024 * 1024};
+  int minResolution{256};
+  int maxResolution{2048};
+  ShadowFilter filter{ShadowFilter::PCF3x3};
+  // Polygon offset of the casters, against shadow acne
+  float slopeBias{2.0f};
+  float constantBias{2.0f};
+};
+
+/**
+ * @brief abcg::CascadedShadowMap class.
+ *
+ * Shadow map of a directional light split into cascades along the view
+ * frustum of a camera, so that nearby receivers get more texels than
+ * distant ones. The cascades are layers of a depth texture array.
+ *
+ * Each frame, update() fits the cascades to the camera and render() draws
+ * the casters of each cascade with a depth-only program made of
+ * getDepthVertexShader() and getDepthFragmentShader(). Casters should be
+ * culled against each cascade with isVisible(). Then bindTexture() sets the
+ * following uniforms of the program that shades the receivers:
+ *
+ * @code
+ * uniform mediump sampler2DArrayShadow shadowMap;
+ * uniform mat4 shadowMatrices[4];  // World space to shadow map [0,1]^3
+ * uniform vec4 cascadeSplits;      // Far distance of each cascade
+ * uniform int cascadeCount;
+ * uniform int shadowFilterRadius;  // PCF kernel is (2r+1)x(2r+1)
+ * @endcode
+ *
+ * A receiver at view distance d uses the first cascade i with d <
+ * cascadeSplits[i]. Receivers outside the last cascade are lit.
+ *
+ * The resolution of the cascades follows ShadowMapSettings::texelBudget,
+ * so shadow quality can be tied to the window size instead of being
+ * fixed. The cascades are bounding spheres of the frustum slices
+ * whose centers are snapped to texels, so shadow edges do not shimmer as
+ * the camera moves.
+ *
+ * The shadow map owns its program. All functions must be called with the
+ * OpenGL context of the window current. OpenGL objects are deleted by
+ * destroy(), not by the destructor.
+ */
+class abcg::CascadedShadowMap {
+ public:
+  static constexpr std::size_t maxCascades{4};
+
+  using CasterRenderer =
+      std::function<void(std::size_t cascade, GLint modelMatrixLocation)>;
+
+  CascadedShadowMap() = default;
+  ~CascadedShadowMap() = default;
+
+  CascadedShadowMap(const CascadedShadowMap &) = delete;
+  CascadedShadowMap(CascadedShadowMap &&) = delete;
+  CascadedShadowMap &operator=(const CascadedShadowMap &) = delete;
+  CascadedShadowMap &operator=(CascadedShadowMap &&) = delete;
+
+  void create(GLuint depthProgram, const ShadowMapSettings &settings = {});
+  void setSettings(const ShadowMapSettings &settings);
+  void destroy();
+
+  void update(const glm::mat4 &viewMatrix, const glm::mat4 &projMatrix,
+              const glm::vec3 &lightDirection,
+              const BoundingSphere &casterBounds);
+  void render(const CasterRenderer &renderCasters) const;
+  void bindTexture(GLuint program, GLint textureUnit) const;
+
+  [[nodiscard]] bool isVisible(std::size_t cascade,
+                               const BoundingSphere &bounds) const;
+
+  [[nodiscard]] std::size_t getCascadeCount() const { return m_cascadeCount; }
+  [[nodiscard]] int getResolution() const { return m_resolution; }
+  [[nodiscard]] GLuint getTexture() const { return m_texture; }
+  [[nodiscard]] const ShadowMapSettings &getSettings() const {
+    return m_settings;
+  }
+
+  [[nodiscard]] static std::string_view getDepthVertexShader();
+  [[nodiscard]] static std::string_view getDepthFragmentShader();
+
+ private:
+  struct Cascade {
+    // World space to clip space of the light
+    glm::mat4 viewProjMatrix{1.0f};
+    // Bounds of the cascade in light view space
+    glm::vec2 min{};
+    glm::vec2 max{};
+    float minDepth{};
+    // Far distance of the cascade from the camera
+    float splitDistance{};
+  };
+
+  ShadowMapSettings m_settings{};
+  std::size_t m_cascadeCount{};
+  int m_resolution{};
+  // GL_MAX_TEXTURE_SIZE, queried by create()
+  GLint m_maxTextureSize{};
+
+  GLuint m_program{};
+  GLint m_modelMatrixLocation{-1};
+  GLint m_lightViewProjMatrixLocation{-1};
+  GLuint m_texture{};
+  GLuint m_framebuffer{};
+
+  glm::mat4 m_lightViewMatrix{1.0f};
+  std::array<Cascade, maxCascades> m_cascades{};
+
+  void createTexture();
+  void applyFilter() const;
+};
+
+#endif
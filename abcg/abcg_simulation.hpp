@@ -0,0 +1,304 @@
+/**
+ * @file abcg_simulation.hpp
+ * @brief Declaration of abcg::Simulation, a fixed-tick simulation thread.
+ *
+ * The simulation updates its own copy of the state at a fixed tick rate and
+ * publishes an immutable snapshot after each tick. The render thread reads
+ * the two latest snapshots and interpolates between them, so that a slow
+ * update overlaps with rendering instead of delaying it.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_SIMULATION_HPP_
+#define ABCG_SIMULATION_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "abcg_exception.hpp"
+
+namespace abcg {
+template <typename State>
+class Simulation;
+template <typename State>
+struct SimulationSnapshot;
+}  // namespace abcg
+
+/**
+ * @brief Render state published by abcg::Simulation.
+ *
+ * `current` is the state after the latest tick and `previous` the state
+ * after the tick before it. Rendering is one tick behind the simulation:
+ * the state to render is the interpolation from `previous` to `current` by
+ * `alpha`.
+ */
+template <typename State>
+struct abcg::SimulationSnapshot {
+  std::shared_ptr<const State> previous{};
+  std::shared_ptr<const State> current{};
+  float alpha{};
+};
+
+/**
+ * @brief abcg::Simulation class.
+ *
+ * Runs an update function at a fixed tick rate on its own thread. `State`
+ * must be copyable, and should only hold what rendering needs, such as
+ * transforms, colors and camera parameters, since it is copied after each
+ * tick.
+ *
+ * The state is only touched by the simulation thread. Other threads change
+ * it through commands (see post()), which run before the next tick.
+ *
+ * When the simulation falls behind, it runs up to `maxCatchUpTicks` ticks in
+ * a row and then skips the remaining ones. Without threads, as on
+ * Emscripten, ticks run on the render thread in getSnapshot().
+ *
+ * Typical use in an abcg::OpenGLWindow:
+ *
+ * @code
+ * // initializeGL()
+ * m_simulation.start(initialState, 60.0, [](State &state, double deltaTime) {
+ *   // Update state
+ * });
+ *
+ * // handleEvent()
+ * m_simulation.post([](State &state) { state.jump = true; });
+ *
+ * // paintGL()
+ * const auto snapshot{m_simulation.getSnapshot()};
+ * const auto position{glm::mix(snapshot.previous->position,
+ *                              snapshot.current->position, snapshot.alpha)};
+ *
+ * // terminateGL()
+ * m_simulation.stop();
+ * @endcode
+ */
+template <typename State>
+class abcg::Simulation {
+ public:
+  using UpdateFunction = std::function<void(State &state, double deltaTime)>;
+  using Command = std::function<void(State &state)>;
+
+  static constexpr int maxCatchUpTicks{5};
+
+  Simulation() = default;
+  ~Simulation() { stop(); }
+
+  Simulation(const Simulation &) = delete;
+  Simulation(Simulation &&) = delete;
+  Simulation &operator=(const Simulation &) = delete;
+  Simulation &operator=(Simulation &&) = delete;
+
+  void start(State initialState, double ticksPerSecond, UpdateFunction update,
+             bool threaded = true);
+  void stop();
+  void post(Command command);
+  [[nodiscard]] SimulationSnapshot<State> getSnapshot();
+  [[nodiscard]] bool isRunning() const { return m_state.has_value(); }
+  [[nodiscard]] std::uint64_t getTickCount() const;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // Used only by the simulation thread while it runs
+  std::optional<State> m_state;
+  UpdateFunction m_update;
+  Clock::duration m_tickDuration{};
+  Clock::time_point m_nextTick{};
+
+  mutable std::mutex m_mutex;
+  std::shared_ptr<const State> m_previous;
+  std::shared_ptr<const State> m_current;
+  Clock::time_point m_currentTime{};
+  std::uint64_t m_tickCount{};
+  std::vector<Command> m_commands;
+  std::exception_ptr m_exception;
+  bool m_stop{false};
+
+  std::condition_variable m_wakeUp;
+  std::thread m_thread;
+
+  void runDueTicks();
+  void tick();
+};
+
+/**
+ * @brief Starts the simulation.
+ *
+ * A running simulation is stopped first. An exception of a previous run
+ * that was not rethrown by getSnapshot() yet is discarded.
+ *
+ * @param initialState State before the first tick.
+ * @param ticksPerSecond Number of ticks per second.
+ * @param update Function called at each tick with the state and the fixed
+ * time step in seconds. Exceptions thrown by it stop the simulation and are
+ * rethrown by getSnapshot().
+ * @param threaded Whether to run the simulation on its own thread. Ignored on
+ * Emscripten, where it always runs on the render thread.
+ *
+ * @throw abcg::Exception if `ticksPerSecond` is not positive.
+ */
+template <typename State>
+void abcg::Simulation<State>::start(State initialState, double ticksPerSecond,
+                                    UpdateFunction update,
+                                    [[maybe_unused]] bool threaded) {
+  if (ticksPerSecond <= 0.0) {
+    throw abcg::Exception{abcg::Exception::Runtime("Invalid tick rate")};
+  }
+  stop();
+
+  m_update = std::move(update);
+  m_tickDuration = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>{1.0 / ticksPerSecond});
+  m_current = std::make_shared<const State>(initialState);
+  m_previous = m_current;
+  m_state = std::move(initialState);
+  m_currentTime = Clock::now();
+  m_nextTick = m_currentTime + m_tickDuration;
+  m_tickCount = 0;
+  m_stop = false;
+  // An exception of the previous run would stop the new thread at once
+  m_exception = nullptr;
+
+#if !defined(__EMSCRIPTEN__)
+  if (threaded) {
+    m_thread = std::thread{[this] {
+      std::unique_lock lock{m_mutex};
+      while (!m_stop && !m_exception) {
+        lock.unlock();
+        try {
+          runDueTicks();
+        } catch (...) {
+          lock.lock();
+          m_exception = std::current_exception();
+          break;
+        }
+        lock.lock();
+        m_wakeUp.wait_until(lock, m_nextTick, [this] { return m_stop; });
+      }
+    }};
+  }
+#endif
+}
+
+/**
+ * @brief Stops the simulation and waits for the current tick to finish.
+ *
+ * Commands that were not run yet are discarded. The latest snapshot is still
+ * returned by getSnapshot().
+ */
+template <typename State>
+void abcg::Simulation<State>::stop() {
+  {
+    const std::scoped_lock lock{m_mutex};
+    m_stop = true;
+    m_commands.clear();
+  }
+  m_wakeUp.notify_all();
+  if (m_thread.joinable()) m_thread.join();
+  m_state.reset();
+}
+
+/**
+ * @brief Queues a change of the state.
+ *
+ * Commands run on the simulation thread, in the order they were posted,
+ * before the next tick.
+ *
+ * @param command Function called with the state.
+ */
+template <typename State>
+void abcg::Simulation<State>::post(Command command) {
+  const std::scoped_lock lock{m_mutex};
+  m_commands.push_back(std::move(command));
+}
+
+/**
+ * @brief Returns the two latest states and the interpolation factor between
+ * them for the current time.
+ *
+ * @return Latest snapshot, or an empty snapshot if the simulation was never
+ * started.
+ *
+ * @throw Rethrows the exception thrown by the update function, if any.
+ */
+template <typename State>
+abcg::SimulationSnapshot<State> abcg::Simulation<State>::getSnapshot() {
+  if (isRunning() && !m_thread.joinable()) {
+    try {
+      runDueTicks();
+    } catch (...) {
+      m_state.reset();
+      throw;
+    }
+  }
+
+  const std::scoped_lock lock{m_mutex};
+  if (m_exception) std::rethrow_exception(std::exchange(m_exception, {}));
+  if (!m_current) return {};
+
+  const std::chrono::duration<double> sinceTick{Clock::now() - m_currentTime};
+  const std::chrono::duration<double> tickDuration{m_tickDuration};
+  return {.previous = m_previous,
+          .current = m_current,
+          .alpha = static_cast<float>(
+              std::clamp(sinceTick / tickDuration, 0.0, 1.0))};
+}
+
+/**
+ * @brief Returns the number of ticks since the simulation was started.
+ *
+ * @return Number of ticks.
+ */
+template <typename State>
+std::uint64_t abcg::Simulation<State>::getTickCount() const {
+  const std::scoped_lock lock{m_mutex};
+  return m_tickCount;
+}
+
+template <typename State>
+void abcg::Simulation<State>::runDueTicks() {
+  const auto now{Clock::now()};
+  for (auto ticks{0}; m_nextTick <= now && ticks < maxCatchUpTicks; ++ticks) {
+    tick();
+  }
+  // Skip the ticks that could not be caught up
+  if (m_nextTick <= now) m_nextTick = now + m_tickDuration;
+}
+
+template <typename State>
+void abcg::Simulation<State>::tick() {
+  std::vector<Command> commands;
+  {
+    const std::scoped_lock lock{m_mutex};
+    std::swap(commands, m_commands);
+  }
+  for (const auto &command : commands) command(*m_state);
+
+  m_update(*m_state, std::chrono::duration<double>{m_tickDuration}.count());
+
+  // The snapshot that is no longer needed is released outside the lock
+  auto snapshot{std::make_shared<const State>(*m_state)};
+  {
+    const std::scoped_lock lock{m_mutex};
+    std::swap(m_previous, m_current);
+    std::swap(m_current, snapshot);
+    m_currentTime = m_nextTick;
+    ++m_tickCount;
+  }
+  m_nextTick += m_tickDuration;
+}
+
+#endif
@@ -0,0 +1,181 @@
+/**
+ * @file abcg_vertexlayout.cpp
+ * @brief Definition of vertex layout descriptors and vertex quantization.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include "abcg_vertexlayout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include <limits>
+
+#include "abcg_openglfunctions.hpp"
+
+static_assert(sizeof(abcg::QuantizedVertex) == 20);
+
+namespace {
+// Octahedral encoding of a unit vector (Meyer et al., "On Floating-Point
+// Normal Vectors", EGSR 2010)
+[[nodiscard]] glm::vec2 encodeOctahedral(const glm::vec3 &n) {
+  const auto l1Norm{std::abs(n.x) + std::abs(n.y) + std::abs(n.z)};
+  if (l1Norm <= 0.0f) return {};
+
+  const glm::vec2 p{n.x / l1Norm, n.y / l1Norm};
+  if (n.z >= 0.0f) return p;
+
+  // Fold the lower hemisphere over the diagonals
+  return {(1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+          (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f)};
+}
+}  // namespace
+
+/**
+ * @brief Returns the layout of a vertex buffer of abcg::Vertex.
+ *
+ * @return Layout with attributes `inPosition`, `inNormal`, `inTexCoord` and
+ * `inTangent`.
+ */
+abcg::VertexLayout abcg::getVertexLayout() {
+  return {.stride = sizeof(Vertex),
+          .attributes = {{.name = "inPosition",
+                          .size = 3,
+                          .offset = offsetof(Vertex, position)},
+                         {.name = "inNormal",
+                          .size = 3,
+                          .offset = offsetof(Vertex, normal)},
+                         {.name = "inTexCoord",
+                          .size = 2,
+                          .offset = offsetof(Vertex, texCoord)},
+                         {.name = "inTangent",
+                          .size = 4,
+                          .offset = offsetof(Vertex, tangent)}}};
+}
+
+/**
+ * @brief Returns the layout of a vertex buffer of abcg::QuantizedVertex.
+ *
+ * `inPosition` is read as a normalized vec3 in the range [0, 1] and must be
+ * transformed with abcg::QuantizedMesh::getDequantizationMatrix. `inNormal`
+ * is read as an octahedral-encoded vec2 in the range [-1, 1] and must be
+ * decoded in the vertex shader. `inTangent` is read as a normalized vec4 in
+ * the range [-1, 1].
+ *
+ * @return Layout with attributes `inPosition`, `inNormal`, `inTexCoord` and
+ * `inTangent`.
+ */
+abcg::VertexLayout abcg::getQuantizedVertexLayout() {
+  return {.stride = sizeof(QuantizedVertex),
+          .attributes = {{.name = "inPosition",
+                          .size = 3,
+                          .type = GL_UNSIGNED_SHORT,
+                          .normalized = true,
+                          .offset = offsetof(QuantizedVertex, position)},
+                         {.name = "inNormal",
+                          .size = 2,
+                          .type = GL_SHORT,
+                          .normalized = true,
+                          .offset = offsetof(QuantizedVertex, normal)},
+                         {.name = "inTexCoord",
+                          .size = 2,
+                          .type = GL_HALF_FLOAT,
+                          .offset = offsetof(QuantizedVertex, texCoord)},
+                         {.name = "inTangent",
+                          .size = 4,
+                          .type = GL_BYTE,
+                          .normalized = true,
+                          .offset = offsetof(QuantizedVertex, tangent)}}};
+}
+
+/**
+ * @brief Converts vertices to the compact abcg::QuantizedVertex format.
+ *
+ * @param vertices Vertices to convert.
+ *
+ * @return Quantized vertices and the bounds used for the positions.
+ */
+abcg::QuantizedMesh abcg::quantizeVertices(std::span<const Vertex> vertices) {
+  QuantizedMesh mesh;
+  if (vertices.empty()) return mesh;
+
+  auto min{vertices.front().position};
+  auto max{min};
+  for (const auto &vertex : vertices) {
+    min = glm::min(min, vertex.position);
+    max = glm::max(max, vertex.position);
+  }
+  mesh.boundsMin = min;
+  mesh.boundsExtent = max - min;
+
+  // Avoid division by zero on flat meshes
+  const auto scale{1.0f / glm::max(mesh.boundsExtent,
+                                   glm::vec3{
+                                       std::numeric_limits<float>::min()})};
+
+  mesh.vertices.reserve(vertices.size());
+  for (const auto &vertex : vertices) {
+    const auto position{(vertex.position - min) * scale};
+    const auto normal{encodeOctahedral(vertex.normal)};
+    mesh.vertices.push_back(
+        {.position = {glm::packUnorm1x16(position.x),
+                      glm::packUnorm1x16(position.y),
+                      glm::packUnorm1x16(position.z), 0},
+         .normal = {static_cast<std::int16_t>(glm::packSnorm1x16(normal.x)),
+                    static_cast<std::int16_t>(glm::packSnorm1x16(normal.y))},
+         .texCoord = {glm::packHalf1x16(vertex.texCoord.x),
+                      glm::packHalf1x16(vertex.texCoord.y)},
+         .tangent = {
+             static_cast<std::int8_t>(glm::packSnorm1x8(vertex.tangent.x)),
+             static_cast<std::int8_t>(glm::packSnorm1x8(vertex.tangent.y)),
+             static_cast<std::int8_t>(glm::packSnorm1x8(vertex.tangent.z)),
+             static_cast<std::int8_t>(glm::packSnorm1x8(vertex.tangent.w))}});
+  }
+
+  return mesh;
+}
+
+/**
+ * @brief Returns the matrix that maps quantized positions back to object
+ * space.
+ *
+ * Should be multiplied to the right of the model matrix.
+ *
+ * @return Dequantization matrix.
+ */
+glm::mat4 abcg::QuantizedMesh::getDequantizationMatrix() const {
+  return glm::scale(glm::translate(glm::mat4{1.0f}, boundsMin), boundsExtent);
+}
+
+/**
+ * @brief Sets up the attribute pointers of the currently bound VAO.
+ *
+ * The vertex buffer must be bound to `GL_ARRAY_BUFFER`. Attributes not found
+ * in the program are skipped.
+ *
+ * @param program Shader program.
+ * @param layout Vertex layout.
+ * @param baseVertex Index of the vertex that the attribute pointers start
+ * from. Used to draw meshlets of 16-bit index buffers (see abcg::Meshlet).
+ */
+void abcg::opengl::setupVertexAttributes(GLuint program,
+                                         const VertexLayout &layout,
+                                         GLuint baseVertex) {
+  const auto baseOffset{static_cast<std::size_t>(baseVertex) *
+                        static_cast<std::size_t>(layout.stride)};
+  for (const auto &attribute : layout.attributes) {
+    const GLint location{
+        abcg::glGetAttribLocation(program, attribute.name.c_str())};
+    if (location < 0) continue;
+
+    const auto index{static_cast<GLuint>(location)};
+    abcg::glEnableVertexAttribArray(index);
+    abcg::glVertexAttribPointer(
+        index, attribute.size, attribute.type,
+        attribute.normalized ? GL_TRUE : GL_FALSE, layout.stride,
+        reinterpret_cast<void *>(baseOffset + attribute.offset));
+  }
+}
@@ -0,0 +1,94 @@
+/**
+ * @file abcg_vertexlayout.hpp
+ * @brief Declaration of vertex layout descriptors and vertex quantization.
+ *
+ * A vertex layout describes how the attributes of a vertex are stored in a
+ * vertex buffer, so that the attribute pointers of a VAO can be set up from a
+ * single description.
+ *
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VERTEXLAYOUT_HPP_
+#define ABCG_VERTEXLAYOUT_HPP_
+
+#include <abcg_external.hpp>
+#include <array>
+#include <cstdint>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "abcg_mesh.hpp"
+
+namespace abcg {
+struct QuantizedMesh;
+struct QuantizedVertex;
+struct VertexAttribute;
+struct VertexLayout;
+
+[[nodiscard]] VertexLayout getVertexLayout();
+[[nodiscard]] VertexLayout getQuantizedVertexLayout();
+[[nodiscard]] QuantizedMesh quantizeVertices(std::span<const Vertex> vertices);
+}  // namespace abcg
+
+namespace abcg::opengl {
+void setupVertexAttributes(GLuint program, const VertexLayout &layout,
+                           GLuint baseVertex = 0);
+}  // namespace abcg::opengl
+
+/**
+ * @brief Description of a single vertex attribute.
+ *
+ * `name` is the name of the attribute in the vertex shader. The remaining
+ * members are the arguments of `glVertexAttribPointer`.
+ */
+struct abcg::VertexAttribute {
+  std::string name{};
+  GLint size{};
+  GLenum type{GL_FLOAT};
+  bool normalized{false};
+  std::size_t offset{};
+};
+
+/**
+ * @brief Description of the attributes of an interleaved vertex buffer.
+ *
+ */
+struct abcg::VertexLayout {
+  GLsizei stride{};
+  std::vector<VertexAttribute> attributes{};
+};
+
+/**
+ * @brief Compact version of abcg::Vertex (20 bytes instead of 48).
+ *
+ * - `position`: 16-bit unsigned normalized integers, relative to the bounding
+ * box of the mesh. The fourth component is padding.
+ * - `normal`: octahedral encoding stored as 16-bit signed normalized integers.
+ * - `texCoord`: half-precision floats.
+ * - `tangent`: 8-bit signed normalized integers. The fourth component is the
+ * handedness.
+ */
+struct abcg::QuantizedVertex {
+  std::array<std::uint16_t, 4> position{};
+  std::array<std::int16_t, 2> normal{};
+  std::array<std::uint16_t, 2> texCoord{};
+  std::array<std::int8_t, 4> tangent{};
+};
+
+/**
+ * @brief Quantized vertices plus the bounds needed to dequantize them.
+ *
+ */
+struct abcg::QuantizedMesh {
+  std::vector<QuantizedVertex> vertices{};
+  glm::vec3 boundsMin{};
+  glm::vec3 boundsExtent{};
+
+  [[nodiscard]] glm::mat4 getDequantizationMatrix() const;
+};
+
+#endif
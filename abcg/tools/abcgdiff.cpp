@@ -0,0 +1,111 @@
+/**
+ * @file abcgdiff.cpp
+ * @brief Command-line tool that compares images with golden images.
+ *
+ * Usage: abcgdiff <expected> <actual> [--threshold <value>]
+ *                 [--max-different <fraction>] [--diff <directory>]
+ *
+ * The expected and actual paths are either two image files or two
+ * directories, in which case each PNG file of the expected directory is
+ * compared with the file of same name in the actual directory. Returns 0 if
+ * all images match, and 1 otherwise.
+ *
+ * This project is released under the MIT License.
+ */
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "abcg_imagediff.hpp"
+#include "abcg_readback.hpp"
+
+namespace fs = std::filesystem;
+
+int main(int argc, char **argv) {
+  const std::span arguments{argv, static_cast<std::size_t>(argc)};
+  const auto printUsage{[] {
+    fmt::print(stderr,
+               "Usage: abcgdiff <expected> <actual> [--threshold <value>] "
+               "[--max-different <fraction>] [--diff <directory>]\n");
+  }};
+  if (arguments.size() < 3 || arguments.size() % 2 == 0) {
+    printUsage();
+    return -1;
+  }
+
+  abcg::ImageComparisonSettings settings;
+  fs::path diffDirectory;
+  for (std::size_t index{3}; index < arguments.size(); index += 2) {
+    const std::string_view option{arguments[index]};
+    const std::string value{arguments[index + 1]};
+    if (option == "--threshold") {
+      settings.threshold = std::stod(value);
+    } else if (option == "--max-different") {
+      settings.maxDifferentPixels = std::stod(value);
+    } else if (option == "--diff") {
+      diffDirectory = value;
+      settings.createDiffImage = true;
+    } else {
+      printUsage();
+      return -1;
+    }
+  }
+
+  try {
+    const fs::path expectedPath{arguments[1]};
+    const fs::path actualPath{arguments[2]};
+
+    // Pairs of expected and actual images
+    std::vector<std::pair<fs::path, fs::path>> files;
+    if (fs::is_directory(expectedPath)) {
+      for (const auto &entry : fs::directory_iterator{expectedPath}) {
+        if (entry.path().extension() == ".png") {
+          files.emplace_back(entry.path(),
+                             actualPath / entry.path().filename());
+        }
+      }
+      std::ranges::sort(files);
+    } else {
+      files.emplace_back(expectedPath, actualPath);
+    }
+    if (!diffDirectory.empty()) fs::create_directories(diffDirectory);
+
+    std::size_t failures{};
+    for (const auto &[expectedFile, actualFile] : files) {
+      if (!fs::exists(actualFile)) {
+        fmt::print("{}: missing\n", actualFile.string());
+        ++failures;
+        continue;
+      }
+
+      const auto expected{abcg::readImage(expectedFile.string())};
+      const auto actual{abcg::readImage(actualFile.string())};
+      const auto result{abcg::compareImages(expected, actual, settings)};
+      if (result.matches) continue;
+
+      ++failures;
+      fmt::print("{}: {} different pixels, max difference {:.3f}, mean "
+                 "difference {:.5f}\n",
+                 actualFile.string(), result.differentPixels,
+                 result.maxDifference, result.meanDifference);
+      if (!diffDirectory.empty() && result.diffImage.width > 0) {
+        abcg::writeImage((diffDirectory / actualFile.filename()).string(),
+                         result.diffImage);
+      }
+    }
+
+    fmt::print("{} of {} images match\n", files.size() - failures,
+               files.size());
+    return failures == 0 ? 0 : 1;
+  } catch (const std::exception &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+    return -1;
+  }
+}
@@ -0,0 +1,36 @@
+/**
+ * @file abcgpack.cpp
+ * @brief Command-line tool that creates asset pack files.
+ *
+ * Usage: abcgpack <assets directory> <pack file> [--no-compression]
+ *
+ * This project is released under the MIT License.
+ */
+
+#include <fmt/core.h>
+
+#include <exception>
+#include <span>
+#include <string_view>
+
+#include "abcg_pack.hpp"
+
+int main(int argc, char **argv) {
+  const std::span arguments{argv, static_cast<std::size_t>(argc)};
+  if (arguments.size() < 3 || arguments.size() > 4 ||
+      (arguments.size() == 4 &&
+       std::string_view{arguments[3]} != "--no-compression")) {
+    fmt::print(stderr,
+               "Usage: abcgpack <assets directory> <pack file> "
+               "[--no-compression]\n");
+    return -1;
+  }
+
+  try {
+    abcg::writePackFile(arguments[2], arguments[1], arguments.size() == 3);
+  } catch (const std::exception &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+    return -1;
+  }
+  return 0;
+}
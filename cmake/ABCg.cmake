@@ -89,6 +89,19 @@ function(enable_abcg project_target)
           ${output_dir}/${project_target}.dir/assets)
     endif()
 
+    # Loose assets are still copied for loaders that do not read pack files
+    # (e.g. fonts loaded by Dear ImGui)
+    if(ENABLE_ASSET_PACK AND EXISTS ${CMAKE_CURRENT_SOURCE_DIR}/assets)
+      add_dependencies(${project_target} abcgpack)
+      add_custom_command(
+        TARGET ${project_target}
+        POST_BUILD
+        COMMAND
+          # Pack assets directory into ${project_target}.dir/assets.pack
+          abcgpack ${CMAKE_CURRENT_SOURCE_DIR}/assets
+          ${output_dir}/${project_target}.dir/assets.pack)
+    endif()
+
     add_custom_command(
       TARGET ${project_target}
       POST_BUILD
@@ -99,3 +112,68 @@ function(enable_abcg project_target)
   endif()
 
 endfunction()
+
+# Golden-image test of an application, added if ENABLE_GOLDEN_TESTS is ON.
+# The application replays golden/replay.rec (see --replay) while capturing
+# its frames (see --capture), and abcgdiff compares the frames with the PNG
+# files of golden/. Frames are rendered by Mesa llvmpipe, so the results do
+# not depend on the GPU. A display is still required, e.g. run
+# `xvfb-run ctest` on headless machines. The target ${project_target}_golden
+# replaces the golden images with the frames of the current build.
+function(add_golden_test project_target)
+
+  if(NOT ENABLE_GOLDEN_TESTS OR ${CMAKE_SYSTEM_NAME} MATCHES "Emscripten")
+    return()
+  endif()
+
+  set(golden_dir ${CMAKE_CURRENT_SOURCE_DIR}/golden)
+  set(capture_dir ${CMAKE_CURRENT_BINARY_DIR}/capture)
+  set(recording ${golden_dir}/replay.rec)
+  get_target_property(output_dir ${project_target} RUNTIME_OUTPUT_DIRECTORY)
+  set(executable_dir ${output_dir}/${project_target})
+  set(executable
+      ${executable_dir}/${project_target}${CMAKE_EXECUTABLE_SUFFIX})
+  set(software_renderer LIBGL_ALWAYS_SOFTWARE=1 GALLIUM_DRIVER=llvmpipe)
+
+  # Frames of a previous run must not be compared
+  add_test(NAME ${project_target}.clean
+           COMMAND ${CMAKE_COMMAND} -E remove_directory ${capture_dir})
+
+  add_test(
+    NAME ${project_target}.render
+    COMMAND ${executable} --replay ${recording} --capture ${capture_dir}
+    WORKING_DIRECTORY ${executable_dir})
+
+  add_test(NAME ${project_target}.compare
+           COMMAND abcgdiff ${golden_dir} ${capture_dir} --diff
+                   ${CMAKE_CURRENT_BINARY_DIR}/diff)
+
+  set_tests_properties(${project_target}.clean
+                       PROPERTIES FIXTURES_SETUP ${project_target}.clean)
+  set_tests_properties(
+    ${project_target}.render
+    PROPERTIES FIXTURES_REQUIRED ${project_target}.clean
+               FIXTURES_SETUP ${project_target}.frames
+               ENVIRONMENT "${software_renderer}")
+  set_tests_properties(${project_target}.compare
+                       PROPERTIES FIXTURES_REQUIRED ${project_target}.frames)
+
+  # Without golden images, abcgdiff would compare nothing and pass
+  file(GLOB golden_images ${golden_dir}/*.png)
+  if(NOT golden_images)
+    message(WARNING "No golden images in ${golden_dir}. Build the target "
+                    "${project_target}_golden to create them.")
+    set_tests_properties(${project_target}.compare PROPERTIES DISABLED TRUE)
+  endif()
+
+  add_custom_target(
+    ${project_target}_golden
+    COMMAND ${CMAKE_COMMAND} -E remove_directory ${capture_dir}
+    COMMAND ${CMAKE_COMMAND} -E env ${software_renderer} ${executable}
+            --replay ${recording} --capture ${capture_dir}
+    COMMAND ${CMAKE_COMMAND} -E copy_directory ${capture_dir} ${golden_dir}
+    WORKING_DIRECTORY ${executable_dir}
+    DEPENDS ${project_target}
+    COMMENT "Updating the golden images of ${project_target}")
+
+endfunction()
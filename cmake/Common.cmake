@@ -109,5 +109,13 @@ if(ENABLE_CONAN AND NOT ${CMAKE_SYSTEM_NAME} MATCHES "Emscripten")
   target_link_libraries(${OPTIONS_TARGET} INTERFACE ${CONAN_LIBS})
 endif()
 
+# Asset pack files
+option(ENABLE_ASSET_PACK "Pack the assets of each application into a pack file"
+       OFF)
+
+# Golden-image tests
+option(ENABLE_GOLDEN_TESTS
+       "Add CTest tests that compare rendered frames with golden images" OFF)
+
 # ABCg for users
 include(${CMAKE_CURRENT_LIST_DIR}/ABCg.cmake)
@@ -12,7 +12,8 @@ int main(int argc, char **argv) {
     auto window{std::make_unique<OpenGLWindow>()};
     window->setOpenGLSettings({.profile = abcg::OpenGLProfile::Core,
                                .majorVersion = 4,
-                               .minorVersion = 1});
+                               .minorVersion = 1,
+                               .renderOnDemand = true});
     window->setWindowSettings(
         {.width = 600, .height = 600, .title = "Hello, World!"});
 